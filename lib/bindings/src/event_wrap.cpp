@@ -1,4 +1,5 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 
 #include "util/TDEventTypes.hpp"
 #include "Model/TowerLogic.hpp"
@@ -26,6 +27,14 @@ public:
 }
 void wrap_events(py::module &pymod) {
     using backend_t = TowerLogic;
+	//the command batches are handed over as structured numpy arrays of this dtype (see
+	//FrontStub::spawn_command_batch), so the layout has to match tower_command
+	PYBIND11_NUMPY_DTYPE(UserTowerEvents::tower_command, kind, arg, tier, row, col, target_row, target_col);
+	pymod.attr("tower_command_dtype") = py::dtype::of<UserTowerEvents::tower_command>();
+	pymod.attr("COMMAND_BUILD") = static_cast<uint32_t>(UserTowerEvents::tower_command::Kind::Build);
+	pymod.attr("COMMAND_MODIFY") = static_cast<uint32_t>(UserTowerEvents::tower_command::Kind::Modify);
+	pymod.attr("COMMAND_TARGET") = static_cast<uint32_t>(UserTowerEvents::tower_command::Kind::Target);
+
 	//TODO: this is a pure virtual class, so I need to handle it differently. See
 	//https://pybind11.readthedocs.io/en/master/advanced/classes.html
 	py::class_<UserTowerEvents::tower_event<backend_t>, UserTowerEvents::PyTowerEvent<backend_t>>(pymod, "tower_event")
@@ -1,28 +1,276 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <cstddef>
+#include <mutex>
 
 #include "util/TowerProperties.hpp"
 #include "Model/TowerDefense.hpp"
 #include "Model/TowerLogic.hpp"
+#include "Model/VecTowerDefense.hpp"
 #include "shared/StubFrontend.hpp"
 
 namespace py = pybind11;
 
+using GameServer = TowerDefense<FrontStub, TowerLogic>;
+using VecGameServer = VecTowerDefense<TowerLogic>;
+
+//NOTE: the enum columns are handed over as their underlying ints
+static_assert(sizeof(Elements) == sizeof(int32_t), "unexpected Elements size");
+static_assert(sizeof(CharacterModels::ModelIDs) == sizeof(int32_t), "unexpected ModelIDs size");
+
+//a numpy copy of the backend's column. NOTE: a view straight over the column would dangle as
+//soon as the column reallocates (i.e. when mobs spawn, or attacks are made), so the columns get
+//copied -- they're only a few KB, and the copy is taken while the game can't be stepped
+template <typename ElemT, typename ColumnT>
+py::array column_array(const ColumnT& column) {
+	static_assert(sizeof(typename ColumnT::value_type) == sizeof(ElemT), "column element size mismatch");
+	return py::array_t<ElemT>(static_cast<py::ssize_t>(column.size()), reinterpret_cast<const ElemT*>(column.data()));
+}
+
+//the create_mob events as numpy sees them (i.e. with the model ID as its underlying int)
+struct mob_build_record {
+	int32_t model_id;
+	uint32_t m_id;
+	float m_map_offsets[3];
+};
+static_assert(sizeof(mob_build_record) == sizeof(RenderEvents::create_mob) &&
+		offsetof(mob_build_record, m_id) == offsetof(RenderEvents::create_mob, m_id) &&
+		offsetof(mob_build_record, m_map_offsets) == offsetof(RenderEvents::create_mob, m_map_offsets),
+		"mob_build_record has to match create_mob");
+
+//NOTE: the frame gets reused by the next take_frames, so the events are copied out
+template <typename RecordT, typename EventT>
+py::array event_array(const std::vector<EventT>& events) {
+	return py::array_t<RecordT>(static_cast<py::ssize_t>(events.size()), reinterpret_cast<const RecordT*>(events.data()));
+}
+
+py::dict frame_to_dict(const RenderFrame& frames) {
+	py::dict frame_events;
+	frame_events["tick"] = frames.tick;
+	frame_events["timestamp"] = frames.timestamp;
+
+	py::list tower_builds;
+	for (const auto& evt : frames.tower_builds) {
+		py::dict tower_build;
+		tower_build["id"] = evt.t_ID;
+		tower_build["name_id"] = evt.t_name_id;
+		tower_build["map_offsets"] = py::make_tuple(evt.t_map_offsets[0], evt.t_map_offsets[1]);
+		tower_builds.append(tower_build);
+	}
+	frame_events["tower_builds"] = tower_builds;
+
+	frame_events["attack_builds"] = event_array<RenderEvents::create_attack>(frames.attack_builds);
+	frame_events["attack_paths"] = event_array<RenderEvents::attack_path>(frames.attack_paths);
+	frame_events["attack_removes"] = event_array<RenderEvents::remove_attack>(frames.attack_removes);
+	frame_events["mob_builds"] = event_array<mob_build_record>(frames.mob_builds);
+	frame_events["mob_paths"] = event_array<RenderEvents::mob_path>(frames.mob_paths);
+	frame_events["mob_removes"] = event_array<RenderEvents::remove_mob>(frames.mob_removes);
+	//NOTE: a mob path's waypoints are waypoints[waypoint_offset : waypoint_offset + num_waypoints]
+	frame_events["waypoints"] = event_array<RenderEvents::waypoint>(frames.waypoints);
+
+	py::list state_transitions;
+	for (const auto& evt : frames.state_transitions) {
+		state_transitions.append(py::make_tuple(static_cast<int>(evt.old_state), static_cast<int>(evt.new_state)));
+	}
+	frame_events["state_transitions"] = state_transitions;
+	return frame_events;
+}
+
+//throws if the gameloop thread is running or the game is being stepped (i.e. run_ticks from another
+//python thread, which releases the GIL). The returned lock holds off any stepping until it's released
+std::unique_lock<std::mutex> check_not_running(const GameServer& td) {
+	return td.lock_game_state();
+}
+
 
 
 void wrap_gameserver(py::module &pymod) {
+	pymod.attr("SNAPSHOT_VERSION") = Snapshot::SNAPSHOT_VERSION;
+
+	PYBIND11_NUMPY_DTYPE(RenderEvents::create_attack, id, origin_tid, target);
+	PYBIND11_NUMPY_DTYPE(RenderEvents::attack_path, id, origin_tid, start, target, target_mob, speed, start_timestamp, move_interval);
+	PYBIND11_NUMPY_DTYPE(RenderEvents::remove_attack, id);
+	PYBIND11_NUMPY_DTYPE(mob_build_record, model_id, m_id, m_map_offsets);
+	PYBIND11_NUMPY_DTYPE(RenderEvents::mob_path, id, start, speed, start_timestamp, waypoint_offset, num_waypoints);
+	PYBIND11_NUMPY_DTYPE(RenderEvents::remove_mob, id);
+	PYBIND11_NUMPY_DTYPE(RenderEvents::waypoint, col, row);
+
+	py::class_<QueueStats>(pymod, "QueueStats")
+		.def_readonly ("depth", &QueueStats::depth)
+		.def_readonly ("high_water", &QueueStats::high_water)
+		.def_readonly ("num_pushed", &QueueStats::num_pushed)
+		.def_readonly ("num_dropped", &QueueStats::num_dropped)
+		.def_readonly ("num_coalesced", &QueueStats::num_coalesced)
+		.def_readonly ("num_full", &QueueStats::num_full);
+
     py::class_<TowerDefense<FrontStub, TowerLogic>>(pymod, "TowerDefense")
-		.def (py::init<int32_t>())
-		.def ("init_game", &TowerDefense<FrontStub, TowerLogic>::init_game)
-		.def ("start_game", &TowerDefense<FrontStub, TowerLogic>::start_game)
-		.def ("stop_game", &TowerDefense<FrontStub, TowerLogic>::stop_game)
+		//NOTE: a headless game runs on a virtual clock, and is driven with run_ticks / run_until_wave_end
+		.def (py::init([](int32_t seed, bool headless) {
+				std::unique_ptr<GameClock> clock = nullptr;
+				if (headless) {
+					clock = std::unique_ptr<GameClock>(new VirtualClock());
+				}
+				return new TowerDefense<FrontStub, TowerLogic>(seed, std::move(clock));
+			}), py::arg("seed") = -1, py::arg("headless") = false)
+		//NOTE: the GIL is released for anything that can take a while (loading the resources,
+		//joining the gameloop thread, running ticks), s.t. other python threads keep going. The
+		//gameloop thread itself never needs the GIL, unless it's handed a python-derived event
+		.def ("init_game", &TowerDefense<FrontStub, TowerLogic>::init_game, py::call_guard<py::gil_scoped_release>())
+		.def ("start_game", &TowerDefense<FrontStub, TowerLogic>::start_game, py::call_guard<py::gil_scoped_release>())
+		.def ("stop_game", &TowerDefense<FrontStub, TowerLogic>::stop_game, py::call_guard<py::gil_scoped_release>())
+		.def ("run_ticks", &TowerDefense<FrontStub, TowerLogic>::run_ticks, py::call_guard<py::gil_scoped_release>())
+		.def ("run_until_wave_end", &TowerDefense<FrontStub, TowerLogic>::run_until_wave_end,
+				py::arg("max_ticks") = std::numeric_limits<uint64_t>::max(), py::call_guard<py::gil_scoped_release>())
+		//NOTE: the following are safe to call while the gameloop thread is running
+		.def ("is_running", &TowerDefense<FrontStub, TowerLogic>::is_running)
+		.def ("get_timestamp", &TowerDefense<FrontStub, TowerLogic>::get_timestamp)
+		.def ("get_game_state", [](const GameServer& td) { return static_cast<int>(td.get_game_state()); })
+		.def ("get_player_state", &TowerDefense<FrontStub, TowerLogic>::get_player_state, py::call_guard<py::gil_scoped_release>())
+		.def ("get_towerevent_stats", &TowerDefense<FrontStub, TowerLogic>::get_towerevent_stats)
+		.def ("get_frame_stats", &TowerDefense<FrontStub, TowerLogic>::get_frame_stats)
+		//NOTE: the snapshot is handed over as bytes, in the GameSnapshot.hpp format. Only the copy
+		//into the bytes object needs the GIL
+		.def ("get_snapshot", [](const TowerDefense<FrontStub, TowerLogic>& td) {
+				std::vector<uint8_t> snapshot;
+				{
+					py::gil_scoped_release release;
+					snapshot = td.get_snapshot();
+				}
+				return py::bytes(reinterpret_cast<const char*>(snapshot.data()), snapshot.size());
+			})
+		//NOTE: the mob and attack arrays are copies of the backend's state as of the latest tick -- see
+		//column_array. They can't be had while the gameloop thread is running or the game is being
+		//stepped (use get_snapshot instead)
+		.def ("get_mob_arrays", [](GameServer& td) {
+				auto state_lock = check_not_running(td);
+				const MobTable& live_mobs = td.get_td_backend()->get_live_mobs();
+				py::dict mob_arrays;
+				mob_arrays["ids"] = column_array<uint32_t>(live_mobs.ids);
+				mob_arrays["model_ids"] = column_array<int32_t>(live_mobs.model_ids);
+				mob_arrays["pos_col"] = column_array<float>(live_mobs.pos_col);
+				mob_arrays["pos_row"] = column_array<float>(live_mobs.pos_row);
+				mob_arrays["dest_col"] = column_array<float>(live_mobs.dest_col);
+				mob_arrays["dest_row"] = column_array<float>(live_mobs.dest_row);
+				mob_arrays["speed"] = column_array<float>(live_mobs.speed);
+				mob_arrays["health"] = column_array<float>(live_mobs.health);
+				mob_arrays["flat_armor"] = column_array<float>(live_mobs.flat_armor);
+				mob_arrays["percent_armor"] = column_array<float>(live_mobs.percent_armor);
+				mob_arrays["thresh_armor"] = column_array<float>(live_mobs.thresh_armor);
+				mob_arrays["armor_class"] = column_array<int32_t>(live_mobs.armor_class);
+				return mob_arrays;
+			})
+		.def ("get_attack_arrays", [](GameServer& td) {
+				auto state_lock = check_not_running(td);
+				const AttackColumns& attacks = td.get_td_backend()->export_attack_columns();
+				py::dict attack_arrays;
+				attack_arrays["ids"] = column_array<uint32_t>(attacks.ids);
+				attack_arrays["pos_col"] = column_array<float>(attacks.pos_col);
+				attack_arrays["pos_row"] = column_array<float>(attacks.pos_row);
+				attack_arrays["target_col"] = column_array<float>(attacks.target_col);
+				attack_arrays["target_row"] = column_array<float>(attacks.target_row);
+				attack_arrays["move_speed"] = column_array<float>(attacks.move_speed);
+				attack_arrays["target_ids"] = column_array<uint32_t>(attacks.target_ids);
+				attack_arrays["is_homing"] = column_array<uint8_t>(attacks.is_homing);
+				return attack_arrays;
+			})
 		//NOTE: need to have this return policy to prevent python from taking ownership of the returned object pointer 
 		.def ("get_td_frontend", &TowerDefense<FrontStub, TowerLogic>::get_td_frontend, py::return_value_policy::reference_internal)
 		.def ("get_td_backend", &TowerDefense<FrontStub, TowerLogic>::get_td_backend, py::return_value_policy::reference_internal);
 
 	py::class_<FrontStub<TowerLogic>>(pymod, "FrontStub")
-		.def ("spawn_build_tower_event", &FrontStub<TowerLogic>::spawn_build_tower_event)
-		.def ("spawn_modify_tower_event", &FrontStub<TowerLogic>::spawn_modify_tower_event<tower_properties>)
-		.def ("spawn_print_tower_event", &FrontStub<TowerLogic>::spawn_print_tower_event) 
-		.def ("spawn_tower_target_event", &FrontStub<TowerLogic>::spawn_tower_target_event);
-}
+		//NOTE: these take the event queue's lock (or wait for room, with a blocking queue)
+		.def ("spawn_build_tower_event", &FrontStub<TowerLogic>::spawn_build_tower_event, py::call_guard<py::gil_scoped_release>())
+		.def ("spawn_modify_tower_event", &FrontStub<TowerLogic>::spawn_modify_tower_event<tower_properties>, py::call_guard<py::gil_scoped_release>())
+		.def ("spawn_print_tower_event", &FrontStub<TowerLogic>::spawn_print_tower_event, py::call_guard<py::gil_scoped_release>())
+		.def ("spawn_tower_target_event", &FrontStub<TowerLogic>::spawn_tower_target_event, py::call_guard<py::gil_scoped_release>())
+		//commands is a 1D array of tower_command_dtype, the Modify commands' arg indexes into modifiers
+		.def ("spawn_command_batch", [](FrontStub<TowerLogic>& frontend,
+					py::array_t<UserTowerEvents::tower_command, py::array::c_style | py::array::forcecast> commands,
+					py::list modifiers) {
+				if (commands.ndim() != 1) {
+					throw std::invalid_argument("commands must be a 1D array of tower_command_dtype");
+				}
+				std::vector<UserTowerEvents::tower_command> batch_commands(commands.data(), commands.data() + commands.size());
+				std::vector<tower_properties> batch_modifiers;
+				batch_modifiers.reserve(modifiers.size());
+				for (auto modifier : modifiers) {
+					batch_modifiers.push_back(modifier.cast<tower_properties>());
+				}
+				py::gil_scoped_release release;
+				return frontend.spawn_command_batch(std::move(batch_commands), std::move(batch_modifiers));
+			}, py::arg("commands"), py::arg("modifiers") = py::list())
+		//for asyncio: the fd becomes readable once there are frames to take (i.e. loop.add_reader), and
+		//take_frames then hands over all of the published ticks' events in 1 go (or None if there weren't
+		//any). NOTE: the stub's own thread stops consuming the frames once the fd has been asked for
+		.def ("get_frame_fd", &FrontStub<TowerLogic>::get_frame_fd)
+		.def ("take_frames", [](FrontStub<TowerLogic>& frontend) -> py::object {
+				const RenderFrame* frames = nullptr;
+				{
+					py::gil_scoped_release release;
+					frames = frontend.take_frames();
+				}
+				if (frames == nullptr) {
+					return py::none();
+				}
+				return frame_to_dict(*frames);
+			});
 
+	//NOTE: everything is stepped in C++ with the GIL released -- python only sees the stacked
+	//arrays (observations are num_envs x OBSERVATION_SIZE, see VecTowerDefense.hpp)
+	py::class_<VecGameServer>(pymod, "VecTowerDefense")
+		.def (py::init<size_t, int32_t, size_t>(), py::arg("num_envs"), py::arg("seed") = 0,
+				py::arg("num_threads") = std::thread::hardware_concurrency(), py::call_guard<py::gil_scoped_release>())
+		.def_property_readonly_static ("OBSERVATION_SIZE", [](py::object) { return VecGameServer::OBSERVATION_SIZE; })
+		.def_property_readonly_static ("ACTION_SIZE", [](py::object) { return VecGameServer::ACTION_SIZE; })
+		.def_property_readonly_static ("ACTION_NONE", [](py::object) { return static_cast<int>(VecEnv::ActionKind::None); })
+		.def_property_readonly_static ("ACTION_BUILD", [](py::object) { return static_cast<int>(VecEnv::ActionKind::Build); })
+		.def_property_readonly_static ("ACTION_MODIFY", [](py::object) { return static_cast<int>(VecEnv::ActionKind::Modify); })
+		.def ("num_envs", &VecGameServer::num_envs)
+		.def ("reset", [](VecGameServer& vec_td) {
+				py::array_t<float> observations({vec_td.num_envs(), VecGameServer::OBSERVATION_SIZE});
+				float* obs_data = observations.mutable_data();
+				{
+					py::gil_scoped_release release;
+					vec_td.reset(obs_data);
+				}
+				return observations;
+			})
+		//actions is num_envs x actions_per_env x ACTION_SIZE, returns (observations, rewards, dones). The
+		//modify actions' last entry indexes into modifiers, as with spawn_command_batch
+		.def ("step", [](VecGameServer& vec_td, py::array_t<float, py::array::c_style | py::array::forcecast> actions,
+					uint64_t num_ticks, py::list modifiers) {
+				if (actions.ndim() != 3 || static_cast<size_t>(actions.shape(0)) != vec_td.num_envs() ||
+						static_cast<size_t>(actions.shape(2)) != VecGameServer::ACTION_SIZE) {
+					throw std::invalid_argument("actions must be num_envs x actions_per_env x " +
+							std::to_string(VecGameServer::ACTION_SIZE));
+				}
+				const size_t num_envs = vec_td.num_envs();
+				py::array_t<float> observations({num_envs, VecGameServer::OBSERVATION_SIZE});
+				py::array_t<float> rewards(num_envs);
+				py::array_t<bool> dones(num_envs);
+				const float* action_data = actions.data();
+				float* obs_data = observations.mutable_data();
+				float* reward_data = rewards.mutable_data();
+				uint8_t* done_data = reinterpret_cast<uint8_t*>(dones.mutable_data());
+				std::vector<tower_properties> step_modifiers;
+				step_modifiers.reserve(modifiers.size());
+				for (auto modifier : modifiers) {
+					step_modifiers.push_back(modifier.cast<tower_properties>());
+				}
+				{
+					py::gil_scoped_release release;
+					vec_td.step(action_data, actions.shape(1), num_ticks, obs_data, reward_data, done_data,
+							step_modifiers);
+				}
+				return py::make_tuple(observations, rewards, dones);
+			}, py::arg("actions"), py::arg("num_ticks") = 1, py::arg("modifiers") = py::list())
+		.def ("get_snapshot", [](const VecGameServer& vec_td, size_t env_idx) {
+				std::vector<uint8_t> snapshot;
+				{
+					py::gil_scoped_release release;
+					snapshot = vec_td.get_env(env_idx)->get_snapshot();
+				}
+				return py::bytes(reinterpret_cast<const char*>(snapshot.data()), snapshot.size());
+			});
+}
@@ -7,8 +7,13 @@
 #include "util/TowerProperties.hpp"
 #include "util/TDEventTypes.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 #include <type_traits>
+#include <vector>
 
 template <typename BackendType> struct FrontStub {
   using ModifierType = tower_properties;
@@ -18,7 +23,7 @@ template <typename BackendType> struct FrontStub {
       GameInformation<CommonTowerInformation, TDPlayerInformation>;
 
   FrontStub() 
-    : shared_gamestate_info(nullptr), td_event_queue(nullptr) {
+    : shared_gamestate_info(nullptr), td_event_queue(nullptr), game_events(nullptr), frames_taken_over(false) {
       std::thread fake_frontend (&FrontStub::consume_events, this);
 	  fake_frontend.detach();
   }
@@ -36,21 +41,51 @@ template <typename BackendType> struct FrontStub {
   void register_backend_eventqueue(ViewEvents *events) { game_events = events; }
 
 
-  void spawn_build_tower_event(UserTowerEvents::build_tower_event<BackendType> evt) {spawn_event(evt);}
+  //NOTE: these return false if the backend's queue was full, and the event got rejected
+  bool spawn_build_tower_event(UserTowerEvents::build_tower_event<BackendType> evt) {return spawn_event(evt);}
 
   template <typename ModifyT>
-  void spawn_modify_tower_event(UserTowerEvents::modify_tower_event<ModifyT, BackendType> evt) {spawn_event(evt);}
+  bool spawn_modify_tower_event(UserTowerEvents::modify_tower_event<ModifyT, BackendType> evt) {return spawn_event(evt);}
   
-  void spawn_print_tower_event(UserTowerEvents::print_tower_event<BackendType> evt) {spawn_event(evt);}
+  bool spawn_print_tower_event(UserTowerEvents::print_tower_event<BackendType> evt) {return spawn_event(evt);}
   
-  void spawn_tower_target_event(UserTowerEvents::tower_target_event<BackendType> evt) {spawn_event(evt);}
+  bool spawn_tower_target_event(UserTowerEvents::tower_target_event<BackendType> evt) {return spawn_event(evt);}
+
+  //the whole batch goes through the queue as 1 event (i.e. 1 allocation + 1 push, rather than 1 per command)
+  template <typename ModifyT>
+  bool spawn_command_batch(std::vector<UserTowerEvents::tower_command> commands, std::vector<ModifyT> modifiers) {
+	  auto batch_event = std::make_unique<UserTowerEvents::command_batch_event<ModifyT, BackendType>> (std::move(commands), std::move(modifiers));
+	  return td_event_queue->push(std::move(batch_event));
+  }
+
+  //for consuming the backend --> frontend events from an event loop (e.g. asyncio) rather than the
+  //stub's own thread: wait for the fd to be readable, then take_frames. NOTE: the stub thread stops
+  //consuming the frames once this has been called (as there can only be 1 consumer)
+  int get_frame_fd() {
+	  if (!game_events) {
+		  throw std::logic_error("ERROR -- no backend event queue registered");
+	  }
+	  std::lock_guard<std::mutex> lock(consume_mutex);
+	  frames_taken_over = true;
+	  return game_events->get_frame_fd();
+  }
+
+  //returns nullptr if there weren't any events (see ViewEvents::take_frames). NOTE: the events are
+  //only good until the next call
+  const RenderFrame* take_frames() {
+	  if (!game_events) {
+		  throw std::logic_error("ERROR -- no backend event queue registered");
+	  }
+	  std::lock_guard<std::mutex> lock(consume_mutex);
+	  return game_events->take_frames(taken_frames) ? &taken_frames : nullptr;
+  }
 
 private:
 
   template <typename T>
-  void spawn_event(T&& event) {
+  bool spawn_event(T&& event) {
 	  auto fg_to_bg_event = std::make_unique<typename std::remove_reference<T>::type> (event);
-	  td_event_queue->push(std::move(fg_to_bg_event));
+	  return td_event_queue->push(std::move(fg_to_bg_event));
   }
 
   void consume_events() {
@@ -61,7 +96,11 @@ private:
 			//shared_gamestate_info->
 		  }
 
-		  if (game_events) {
+		  if (game_events && !frames_taken_over) {
+			  std::unique_lock<std::mutex> lock(consume_mutex);
+			  if (frames_taken_over) {
+				  continue;
+			  }
 			  /*
 			  while(not td_event_queue->empty()) {
 				  bool got_data = false;
@@ -75,22 +114,32 @@ private:
 			  auto noop_fn = [](auto val){(void)val;};
 			  game_events->apply_towerbuild_events(noop_fn);
 			  game_events->apply_attackbuild_events(noop_fn);
-			  game_events->apply_attackmove_events(noop_fn);
+			  game_events->apply_attackpath_events(noop_fn);
 			  game_events->apply_attackremove_events(noop_fn);
   			  game_events->apply_mobbuild_events(noop_fn);
-			  game_events->apply_mobmove_events(noop_fn);
+			  auto noop_path_fn = [](auto val, auto waypoints){(void)val; (void)waypoints;};
+			  game_events->apply_mobpath_events(noop_path_fn);
 			  game_events->apply_mobremove_events(noop_fn);
 			  game_events->apply_unitinfo_events(noop_fn);
 			  game_events->apply_statetransition_events(noop_fn);
+			  lock.unlock();
+			  //wait for the next frame rather than polling (the timeout is just
+			  //so the shared info still gets looked at every so often)
+			  game_events->wait_for_frames(std::chrono::steady_clock::now() +
+			                               std::chrono::milliseconds(100));
+		  } else {
+			  std::this_thread::sleep_for(std::chrono::milliseconds(16));
 		  }
-
-		  std::this_thread::sleep_for(std::chrono::milliseconds(16));
 	  }
   }
 
   std::shared_ptr<GameInformationType> shared_gamestate_info;
   TowerEventQueueType *td_event_queue;
   ViewEvents *game_events;
+  //the stub thread and take_frames can't both be consuming the frames
+  std::mutex consume_mutex;
+  std::atomic<bool> frames_taken_over;
+  RenderFrame taken_frames;
 };
 
 #endif
@@ -75,6 +75,15 @@ public:
     }
   }
 
+  void remove_towerinfo(tower_key_t tower_id) {
+    std::lock_guard<std::mutex> lock(tower_info_mutx);
+    if (tower_info.erase(tower_id) == 0) {
+      std::string error_str{"ERROR -- ID " + std::to_string(tower_id) +
+                            " doesnt exist"};
+      throw std::logic_error(error_str);
+    }
+  }
+
   tower_info_t get_towerinfo(tower_key_t tower_id) {
     std::lock_guard<std::mutex> lock(tower_info_mutx);
 
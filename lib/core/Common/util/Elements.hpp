@@ -34,6 +34,7 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -86,39 +87,27 @@ inline Elements get_element_type(std::string type_name) {
   }
 }
 
-// holds the damage coefficients for the elements -- key types are: <attacker,
-// defender> will have to tweak these as time goes on. Also seriously consider
-// putting these into a config file...
-const static std::map<std::tuple<Elements, Elements>, double> damage_coeffs{
-    {std::make_tuple(Elements::CHAOS, Elements::CHAOS), 1.0},
-    {std::make_tuple(Elements::CHAOS, Elements::WATER), 1.0},
-    {std::make_tuple(Elements::CHAOS, Elements::AIR), 1.0},
-    {std::make_tuple(Elements::CHAOS, Elements::FIRE), 1.0},
-    {std::make_tuple(Elements::CHAOS, Elements::EARTH), 1.0},
-
-    {std::make_tuple(Elements::WATER, Elements::CHAOS), 1.0},
-    {std::make_tuple(Elements::WATER, Elements::WATER), 1.0},
-    {std::make_tuple(Elements::WATER, Elements::AIR), 0.8},
-    {std::make_tuple(Elements::WATER, Elements::FIRE), 1.2},
-    {std::make_tuple(Elements::WATER, Elements::EARTH), 0.9},
-
-    {std::make_tuple(Elements::AIR, Elements::CHAOS), 1.0},
-    {std::make_tuple(Elements::AIR, Elements::WATER), 1.1},
-    {std::make_tuple(Elements::AIR, Elements::AIR), 1.0},
-    {std::make_tuple(Elements::AIR, Elements::FIRE), 0.8},
-    {std::make_tuple(Elements::AIR, Elements::EARTH), 1.1},
-
-    {std::make_tuple(Elements::FIRE, Elements::CHAOS), 1.0},
-    {std::make_tuple(Elements::FIRE, Elements::WATER), 0.75},
-    {std::make_tuple(Elements::FIRE, Elements::AIR), 1.1},
-    {std::make_tuple(Elements::FIRE, Elements::FIRE), 1.0},
-    {std::make_tuple(Elements::FIRE, Elements::EARTH), 1.2},
-
-    {std::make_tuple(Elements::EARTH, Elements::CHAOS), 1.0},
-    {std::make_tuple(Elements::EARTH, Elements::WATER), 1.0},
-    {std::make_tuple(Elements::EARTH, Elements::AIR), 0.9},
-    {std::make_tuple(Elements::EARTH, Elements::FIRE), 1.1},
-    {std::make_tuple(Elements::EARTH, Elements::EARTH), 1.0}};
+// holds the damage coefficients for the elements, as a flat row-major table
+// -- key types are: <attacker, defender> will have to tweak these as time goes
+// on. Also seriously consider putting these into a config file...
+constexpr int NUM_ELEMENTS = 5;
+constexpr std::array<double, NUM_ELEMENTS * NUM_ELEMENTS> affinity_coeffs{{
+    // CHAOS
+    1.0, 1.0, 1.0, 1.0, 1.0,
+    // WATER
+    1.0, 1.0, 0.8, 1.2, 0.9,
+    // AIR
+    1.0, 1.1, 1.0, 0.8, 1.1,
+    // FIRE
+    1.0, 0.75, 1.1, 1.0, 1.2,
+    // EARTH
+    1.0, 1.0, 0.9, 1.1, 1.0}};
+
+constexpr inline double get_damage_coeff(const Elements attacker,
+                                         const Elements defender) {
+  return affinity_coeffs[static_cast<int>(attacker) * NUM_ELEMENTS +
+                         static_cast<int>(defender)];
+}
 
 } // namespace ElementInfo
 
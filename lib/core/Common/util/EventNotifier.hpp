@@ -0,0 +1,107 @@
+/* EventNotifier.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_UTIL_EVENT_NOTIFIER_HPP
+#define TD_UTIL_EVENT_NOTIFIER_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+/*
+ * A file descriptor that becomes readable whenever notify() is called, for
+ * waking up event loops (i.e. asyncio's add_reader, or select / epoll) that
+ * can't wait on a condition variable. The notifications don't carry any data,
+ * they only say there's something to go look at -- so a consumer drains the fd
+ * first, then takes everything that's pending.
+ *
+ * NOTE: this is an eventfd on linux (where the notifications just add to its
+ * counter), and a non-blocking pipe elsewhere. Either way, notify() never
+ * blocks, and several notifications before the consumer gets to them collapse
+ * into a single wakeup
+ */
+class EventNotifier {
+public:
+  EventNotifier() : read_fd(-1), write_fd(-1) {
+#ifdef __linux__
+    read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    write_fd = read_fd;
+    if (read_fd < 0) {
+      throw std::runtime_error("Couldn't create the eventfd -- " +
+                               std::string(std::strerror(errno)));
+    }
+#else
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+      throw std::runtime_error("Couldn't create the notifier pipe -- " +
+                               std::string(std::strerror(errno)));
+    }
+    read_fd = pipe_fds[0];
+    write_fd = pipe_fds[1];
+    for (int fd : pipe_fds) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+  }
+
+  ~EventNotifier() {
+    if (write_fd != read_fd) {
+      close(write_fd);
+    }
+    close(read_fd);
+  }
+
+  EventNotifier(const EventNotifier &) = delete;
+  EventNotifier &operator=(const EventNotifier &) = delete;
+
+  // the fd to wait on -- it stays owned by the notifier
+  inline int get_fd() const { return read_fd; }
+
+  // NOTE: safe to call from any thread. If the pipe is full, there's already a
+  // wakeup pending, so there's nothing to do
+  void notify() {
+#ifdef __linux__
+    const uint64_t increment = 1;
+    ssize_t num_written = write(write_fd, &increment, sizeof(increment));
+#else
+    const char wakeup = 1;
+    ssize_t num_written = write(write_fd, &wakeup, sizeof(wakeup));
+#endif
+    (void)num_written;
+  }
+
+  // resets the fd to not readable, returns whether there were any notifications
+  bool drain() {
+#ifdef __linux__
+    uint64_t num_notified = 0;
+    return read(read_fd, &num_notified, sizeof(num_notified)) > 0;
+#else
+    char wakeups[64];
+    bool got_wakeup = false;
+    while (read(read_fd, wakeups, sizeof(wakeups)) > 0) {
+      got_wakeup = true;
+    }
+    return got_wakeup;
+#endif
+  }
+
+private:
+  int read_fd;
+  int write_fd;
+};
+
+#endif
@@ -9,11 +9,16 @@
 #ifndef TD_EVENT_QUEUE_HPP
 #define TD_EVENT_QUEUE_HPP
 
+#include "QueueStats.hpp"
+
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <iostream>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <stdio.h>
 #include <thread>
 
@@ -22,8 +27,12 @@
 
 template <typename EventType> class EventQueue {
 public:
-  explicit EventQueue(const size_t max_sz = 500, const int max_wait = 0)
-      : buffer_size(max_sz), timeout_len(max_wait) {}
+  // whether a queued event (1st arg) is made redundant by a newer one (2nd)
+  using CoalesceFn = std::function<bool(const EventType &, const EventType &)>;
+
+  explicit EventQueue(const size_t max_sz = 500, const int max_wait = 0,
+                      const OverflowPolicy overflow = OverflowPolicy::DropOldest)
+      : buffer_size(max_sz), timeout_len(max_wait), policy_(overflow) {}
 
   ~EventQueue() {
     // clean out the frames in the Queue (NOTE: do we need this, since the
@@ -40,10 +49,37 @@ public:
   EventQueue(const EventQueue &) = delete;
   EventQueue &operator=(const EventQueue<EventType> &) = delete;
 
-  void push(std::unique_ptr<EventType> data);
+  // what happens when the queue is full depends on the overflow policy.
+  // Returns false if the pushed event got dropped
+  bool push(std::unique_ptr<EventType> data);
+  // waits (up to) the queue's timeout for an event -- with the default timeout
+  // of 0, this returns right away if the queue is empty
   std::unique_ptr<EventType> pop(bool &got_data);
+  // blocks until there's an event to pop, or until the deadline passes (in
+  // which case got_data is false)
+  template <typename Clock, typename Duration>
+  std::unique_ptr<EventType>
+  wait_pop(bool &got_data,
+           const std::chrono::time_point<Clock, Duration> &deadline);
+  // moves (up to max_events of) the queued events onto the end of the
+  // container, oldest first, all under 1 lock. Returns the #events moved
+  template <typename ContainerT>
+  size_t drain_into(ContainerT &events,
+                    const size_t max_events =
+                        std::numeric_limits<size_t>::max());
   bool empty(void);
 
+  // for the Coalesce overflow policy
+  void set_coalesce_fn(CoalesceFn coalesce_fn) {
+    std::lock_guard<std::mutex> lock(dlock_);
+    coalesce_fn_ = std::move(coalesce_fn);
+  }
+
+  inline OverflowPolicy get_overflow_policy() const { return policy_; }
+
+  // NOTE: doesn't take the lock, so it's fine to poll for monitoring
+  inline QueueStats get_stats() const { return counters_.snapshot(); }
+
   bool has_started() { return queue_started.load(std::memory_order_seq_cst); }
 
   EventQueue(EventQueue &&other) : EventQueue(nullptr) {
@@ -58,6 +94,8 @@ public:
     swap(first.buffer_, second.buffer_);
     swap(first.buffer_size, second.buffer_size);
     swap(first.timeout_len, second.timeout_len);
+    swap(first.policy_, second.policy_);
+    swap(first.coalesce_fn_, second.coalesce_fn_);
     //special handling for atomics
     auto rhs_queue_flag = second.queue_started.load();
     auto lhs_queue_flag = first.queue_started.exchange(rhs_queue_flag);
@@ -65,14 +103,29 @@ public:
   }
 
 private:
-  std::queue<std::unique_ptr<EventType>> buffer_;
+  // NOTE: called with the lock held, after events have been taken off
+  inline void popped_events() {
+    counters_.set_depth(buffer_.size());
+    if (policy_ == OverflowPolicy::Block) {
+      space_cond_.notify_all();
+    }
+  }
+
+  // NOTE: a deque rather than a queue, s.t. the Coalesce policy can get at the
+  // queued events
+  std::deque<std::unique_ptr<EventType>> buffer_;
   mutable std::mutex dlock_;
   std::condition_variable dcond_;
+  // for the producers waiting on the Block policy
+  std::condition_variable space_cond_;
 
   mutable std::mutex cleanup_;
   // maximum buffer size, will circle back around if maximum size reached
   size_t buffer_size;
   int timeout_len;
+  OverflowPolicy policy_;
+  CoalesceFn coalesce_fn_;
+  QueueCounters counters_;
 
   std::atomic<int> num_producers;
   std::atomic<int> num_consumers;
@@ -80,37 +133,66 @@ private:
 };
 
 template <typename EventType>
-void EventQueue<EventType>::push(std::unique_ptr<EventType> data) {
-  std::lock_guard<std::mutex> lock(dlock_);
-  // delete the oldest element to be replaced
+bool EventQueue<EventType>::push(std::unique_ptr<EventType> data) {
+  std::unique_lock<std::mutex> lock(dlock_);
+  // NOTE: the overflows just get counted (see get_stats) -- this can be on the
+  // producer's hot path, so no printing here
   if (buffer_.size() >= buffer_size) {
-    std::cout << "Queue " << typeid(EventType).name() << " Full, Deleting Oldest Frame -- Thread "
-              << std::this_thread::get_id() << std::endl;
-    buffer_.pop();
+    counters_.count_full();
+    switch (policy_) {
+    case OverflowPolicy::DropOldest:
+      buffer_.pop_front();
+      counters_.count_drop();
+      break;
+    case OverflowPolicy::DropNewest:
+      counters_.count_drop();
+      return false;
+    case OverflowPolicy::Block:
+      space_cond_.wait(lock, [this] { return buffer_.size() < buffer_size; });
+      break;
+    case OverflowPolicy::Coalesce: {
+      // replace the newest queued event that the new one supersedes
+      if (coalesce_fn_ && data) {
+        for (auto evt_it = buffer_.rbegin(); evt_it != buffer_.rend();
+             ++evt_it) {
+          if (*evt_it && coalesce_fn_(**evt_it, *data)) {
+            *evt_it = std::move(data);
+            counters_.count_coalesce();
+            return true;
+          }
+        }
+      }
+      counters_.count_drop();
+      return false;
+    }
+    }
   }
 
-  buffer_.push(std::move(data));
+  buffer_.push_back(std::move(data));
+  counters_.count_push(buffer_.size());
   dcond_.notify_one();
+  return true;
 }
 
 template <typename EventType>
 std::unique_ptr<EventType> EventQueue<EventType>::pop(bool &got_data) {
-  std::unique_lock<std::mutex> lock(dlock_);
+  return wait_pop(got_data, std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(timeout_len));
+}
 
-  // to avoid unnecessary timeouts (even if it's short)
-  if (buffer_.empty()) {
-    got_data = false;
-    return nullptr;
-  }
+template <typename EventType>
+template <typename Clock, typename Duration>
+std::unique_ptr<EventType> EventQueue<EventType>::wait_pop(
+    bool &got_data, const std::chrono::time_point<Clock, Duration> &deadline) {
+  std::unique_lock<std::mutex> lock(dlock_);
 
-  // have a bounded wait, such that the thread waits for (up to) the timeout_len
-  // for data
-  if (dcond_.wait_for(lock, std::chrono::milliseconds(timeout_len),
-                      [this] { return !buffer_.empty(); })) {
+  // NOTE: returns right away if there's already data (or the deadline passed)
+  if (dcond_.wait_until(lock, deadline, [this] { return !buffer_.empty(); })) {
     // move the data element from the buffer
     std::unique_ptr<EventType> data = std::move(buffer_.front());
     // delete the (now empty) object at the front of the queue
-    buffer_.pop();
+    buffer_.pop_front();
+    popped_events();
     got_data = true;
     return data;
   } else {
@@ -119,6 +201,23 @@ std::unique_ptr<EventType> EventQueue<EventType>::pop(bool &got_data) {
   }
 }
 
+template <typename EventType>
+template <typename ContainerT>
+size_t EventQueue<EventType>::drain_into(ContainerT &events,
+                                         const size_t max_events) {
+  std::lock_guard<std::mutex> lock(dlock_);
+  size_t num_events = 0;
+  while (!buffer_.empty() && num_events < max_events) {
+    events.push_back(std::move(buffer_.front()));
+    buffer_.pop_front();
+    num_events++;
+  }
+  if (num_events > 0) {
+    popped_events();
+  }
+  return num_events;
+}
+
 template <typename EventType> bool EventQueue<EventType>::empty() {
   std::lock_guard<std::mutex> lock(dlock_);
   return buffer_.empty();
@@ -0,0 +1,441 @@
+/* Logger.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_UTIL_LOGGER_HPP
+#define TD_UTIL_LOGGER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Asynchronous, level-gated logging for the simulation. A log record is an
+ * event name plus a handful of key/value fields -- i.e.
+ *
+ *   TD_LOG(Debug, "mob_died", Logging::kv("mob_id", mob_id));
+ *
+ * which comes out as (logfmt-style)
+ *
+ *   ts=1234567 level=debug thread=0 event=mob_died mob_id=3
+ *
+ * The records are fixed-size, and go into a lock-free ring buffer owned by the
+ * logging thread -- a background writer thread drains all of the rings every so
+ * often and does the formatting and writing, so the hot paths never format,
+ * lock or flush anything.
+ *
+ * Levels below TD_LOG_MIN_LEVEL are compiled out entirely (the fields aren't
+ * even evaluated), the rest are checked against the runtime level with a single
+ * atomic load.
+ *
+ * NOTE: the event names and field keys are kept as pointers, so they have to be
+ * string literals. String values get copied (and truncated to MAX_STRING_LEN)
+ */
+namespace Logging {
+
+enum class Level : uint8_t { Trace = 0, Debug, Info, Warn, Error, Off };
+
+// the #fields a record can have, and the (copied) length of a string value
+static constexpr size_t MAX_FIELDS = 6;
+static constexpr size_t MAX_STRING_LEN = 23;
+// the #records each thread can have waiting on the writer -- more than that and
+// the records get dropped (and counted)
+static constexpr size_t THREAD_BUFFER_SIZE = 4096;
+// how often the writer thread drains the buffers
+static constexpr std::chrono::milliseconds WRITE_INTERVAL{10};
+
+struct Field {
+  enum class Type : uint8_t { Int, UInt, Float, Bool, String };
+
+  const char *key;
+  Type type;
+  union {
+    int64_t int_value;
+    uint64_t uint_value;
+    double float_value;
+    bool bool_value;
+    char string_value[MAX_STRING_LEN + 1];
+  };
+};
+
+template <typename ValueT>
+inline typename std::enable_if<std::is_integral<ValueT>::value &&
+                                   !std::is_same<ValueT, bool>::value,
+                               Field>::type
+kv(const char *key, const ValueT value) {
+  Field field;
+  field.key = key;
+  if (std::is_signed<ValueT>::value) {
+    field.type = Field::Type::Int;
+    field.int_value = static_cast<int64_t>(value);
+  } else {
+    field.type = Field::Type::UInt;
+    field.uint_value = static_cast<uint64_t>(value);
+  }
+  return field;
+}
+
+template <typename ValueT>
+inline typename std::enable_if<std::is_floating_point<ValueT>::value,
+                               Field>::type
+kv(const char *key, const ValueT value) {
+  Field field;
+  field.key = key;
+  field.type = Field::Type::Float;
+  field.float_value = static_cast<double>(value);
+  return field;
+}
+
+inline Field kv(const char *key, const bool value) {
+  Field field;
+  field.key = key;
+  field.type = Field::Type::Bool;
+  field.bool_value = value;
+  return field;
+}
+
+inline Field kv(const char *key, const char *value) {
+  Field field;
+  field.key = key;
+  field.type = Field::Type::String;
+  std::strncpy(field.string_value, value, MAX_STRING_LEN);
+  field.string_value[MAX_STRING_LEN] = '\0';
+  return field;
+}
+
+inline Field kv(const char *key, const std::string &value) {
+  return kv(key, value.c_str());
+}
+
+struct Record {
+  // ns since the logger started
+  uint64_t timestamp;
+  const char *event;
+  Level level;
+  uint8_t num_fields;
+  Field fields[MAX_FIELDS];
+};
+
+/*
+ * A single logging thread's records, on their way to the writer thread. The
+ * logging thread is the only producer and the writer the only consumer, so
+ * this is a SPSC ring (like SPSCEventQueue, but holding the records by value)
+ */
+class ThreadBuffer {
+public:
+  explicit ThreadBuffer(const uint32_t id)
+      : thread_id(id), records(new Record[THREAD_BUFFER_SIZE]), tail(0),
+        head(0), num_dropped(0), closed(false) {}
+
+  ThreadBuffer(const ThreadBuffer &) = delete;
+  ThreadBuffer &operator=(const ThreadBuffer &) = delete;
+
+  // logging thread side -- returns the record to fill in, or nullptr if the
+  // buffer is full. The record goes out with commit
+  inline Record *reserve() {
+    const size_t write_idx = tail.load(std::memory_order_relaxed);
+    if (write_idx - head.load(std::memory_order_acquire) >=
+        THREAD_BUFFER_SIZE) {
+      num_dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &records[write_idx % THREAD_BUFFER_SIZE];
+  }
+  inline void commit() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+  // writer side -- calls record_fn on each of the waiting records, oldest first
+  template <typename RecordFn> size_t drain(RecordFn &record_fn) {
+    const size_t read_idx = head.load(std::memory_order_relaxed);
+    const size_t write_idx = tail.load(std::memory_order_acquire);
+    for (size_t record_idx = read_idx; record_idx < write_idx; record_idx++) {
+      record_fn(records[record_idx % THREAD_BUFFER_SIZE], thread_id);
+    }
+    head.store(write_idx, std::memory_order_release);
+    return write_idx - read_idx;
+  }
+
+  inline bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+  const uint32_t thread_id;
+
+private:
+  std::unique_ptr<Record[]> records;
+  std::atomic<size_t> tail;
+  std::atomic<size_t> head;
+
+public:
+  std::atomic<uint64_t> num_dropped;
+  // set once the logging thread has exited
+  std::atomic<bool> closed;
+};
+
+class Logger {
+public:
+  // NOTE: the writer thread gets started on first use
+  static Logger &get() {
+    static Logger logger;
+    return logger;
+  }
+
+  ~Logger() {
+    {
+      std::lock_guard<std::mutex> lock(writer_mutex);
+      stopping = true;
+    }
+    writer_cv.notify_one();
+    writer_thread.join();
+    flush();
+  }
+
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  inline bool is_enabled(const Level level) const {
+    return level >= min_level.load(std::memory_order_relaxed);
+  }
+  inline void set_level(const Level level) {
+    min_level.store(level, std::memory_order_relaxed);
+  }
+  inline Level get_level() const {
+    return min_level.load(std::memory_order_relaxed);
+  }
+
+  // NOTE: the sink has to outlive the logger, or be swapped back out first
+  void set_sink(std::ostream *log_sink) {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    sink = log_sink;
+  }
+
+  // writes out everything that's been logged so far (from any thread) --
+  // the writer thread does this on its own every WRITE_INTERVAL
+  void flush() {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    {
+      std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+      drain_buffers = thread_buffers;
+    }
+
+    auto format_fn = [this](const Record &record, const uint32_t thread_id) {
+      format_record(record, thread_id);
+    };
+    size_t num_records = 0;
+    for (auto &thread_buffer : drain_buffers) {
+      num_records += thread_buffer->drain(format_fn);
+    }
+    if (num_records > 0) {
+      sink->write(line_buffer.data(),
+                  static_cast<std::streamsize>(line_buffer.size()));
+      sink->flush();
+      line_buffer.clear();
+    }
+
+    // let go of the exited threads' buffers
+    drain_buffers.clear();
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+    thread_buffers.erase(
+        std::remove_if(thread_buffers.begin(), thread_buffers.end(),
+                       [this](const std::shared_ptr<ThreadBuffer> &buffer) {
+                         if (buffer->closed.load() && buffer->empty()) {
+                           num_closed_dropped += buffer->num_dropped.load();
+                           return true;
+                         }
+                         return false;
+                       }),
+        thread_buffers.end());
+  }
+
+  // the records dropped (over all threads) due to the writer falling behind
+  uint64_t get_num_dropped() const {
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+    uint64_t num_dropped = num_closed_dropped;
+    for (const auto &thread_buffer : thread_buffers) {
+      num_dropped += thread_buffer->num_dropped.load(std::memory_order_relaxed);
+    }
+    return num_dropped;
+  }
+
+  inline uint64_t get_timestamp() const {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time)
+            .count());
+  }
+
+  // the calling thread's buffer, made on the thread's first log
+  ThreadBuffer &get_thread_buffer() {
+    thread_local ThreadBufferHandle buffer_handle;
+    if (!buffer_handle.thread_buffer) {
+      std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+      buffer_handle.thread_buffer =
+          std::make_shared<ThreadBuffer>(num_threads++);
+      thread_buffers.push_back(buffer_handle.thread_buffer);
+    }
+    return *buffer_handle.thread_buffer;
+  }
+
+private:
+  // marks the buffer as closed when the thread exits, s.t. the writer can let
+  // go of it once it's drained
+  struct ThreadBufferHandle {
+    ~ThreadBufferHandle() {
+      if (thread_buffer) {
+        thread_buffer->closed.store(true);
+      }
+    }
+    std::shared_ptr<ThreadBuffer> thread_buffer;
+  };
+
+  Logger()
+      : min_level(Level::Info), sink(&std::cout), num_threads(0),
+        num_closed_dropped(0), start_time(std::chrono::steady_clock::now()),
+        stopping(false) {
+    writer_thread = std::thread(&Logger::writer_loop, this);
+  }
+
+  void writer_loop() {
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (!stopping) {
+      writer_cv.wait_for(lock, WRITE_INTERVAL, [this] { return stopping; });
+      lock.unlock();
+      flush();
+      lock.lock();
+    }
+  }
+
+  void format_record(const Record &record, const uint32_t thread_id) {
+    static const char *level_names[] = {"trace", "debug", "info",
+                                        "warn",  "error", "off"};
+    char value_buffer[64];
+    line_buffer += "ts=";
+    line_buffer += std::to_string(record.timestamp);
+    line_buffer += " level=";
+    line_buffer += level_names[static_cast<uint8_t>(record.level)];
+    line_buffer += " thread=";
+    line_buffer += std::to_string(thread_id);
+    line_buffer += " event=";
+    line_buffer += record.event;
+    for (uint8_t field_idx = 0; field_idx < record.num_fields; field_idx++) {
+      const Field &field = record.fields[field_idx];
+      line_buffer += ' ';
+      line_buffer += field.key;
+      line_buffer += '=';
+      switch (field.type) {
+      case Field::Type::Int:
+        line_buffer += std::to_string(field.int_value);
+        break;
+      case Field::Type::UInt:
+        line_buffer += std::to_string(field.uint_value);
+        break;
+      case Field::Type::Float:
+        std::snprintf(value_buffer, sizeof(value_buffer), "%g",
+                      field.float_value);
+        line_buffer += value_buffer;
+        break;
+      case Field::Type::Bool:
+        line_buffer += field.bool_value ? "true" : "false";
+        break;
+      case Field::Type::String:
+        // NOTE: quoted if need be, to keep the line parseable
+        if (std::strpbrk(field.string_value, " =\"") != nullptr) {
+          line_buffer += '"';
+          line_buffer += field.string_value;
+          line_buffer += '"';
+        } else {
+          line_buffer += field.string_value;
+        }
+        break;
+      }
+    }
+    line_buffer += '\n';
+  }
+
+  std::atomic<Level> min_level;
+
+  // only 1 thread drains the buffers at a time (the writer, or a flush call)
+  std::mutex drain_mutex;
+  std::ostream *sink;
+  std::string line_buffer;
+  std::vector<std::shared_ptr<ThreadBuffer>> drain_buffers;
+
+  mutable std::mutex buffers_mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> thread_buffers;
+  uint32_t num_threads;
+  uint64_t num_closed_dropped;
+
+  const std::chrono::steady_clock::time_point start_time;
+
+  std::mutex writer_mutex;
+  std::condition_variable writer_cv;
+  bool stopping;
+  std::thread writer_thread;
+};
+
+inline bool is_enabled(const Level level) {
+  return Logger::get().is_enabled(level);
+}
+
+// NOTE: use TD_LOG rather than calling this directly
+template <typename... FieldTs>
+inline void write(const Level level, const char *event,
+                  const FieldTs &... fields) {
+  static_assert(sizeof...(FieldTs) <= MAX_FIELDS, "Too many log fields");
+  Logger &logger = Logger::get();
+  ThreadBuffer &thread_buffer = logger.get_thread_buffer();
+  Record *record = thread_buffer.reserve();
+  if (record == nullptr) {
+    return;
+  }
+  record->timestamp = logger.get_timestamp();
+  record->event = event;
+  record->level = level;
+  record->num_fields = static_cast<uint8_t>(sizeof...(FieldTs));
+  size_t field_idx = 0;
+  ((record->fields[field_idx++] = fields), ...);
+  (void)field_idx;
+  thread_buffer.commit();
+}
+
+} // namespace Logging
+
+// the lowest level that gets compiled in (0 = Trace ... 5 = Off)
+#ifndef TD_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define TD_LOG_MIN_LEVEL 2
+#else
+#define TD_LOG_MIN_LEVEL 1
+#endif
+#endif
+
+// TD_LOG(level, event, fields...) -- level is one of the Logging::Level names
+#define TD_LOG(level, ...)                                                     \
+  do {                                                                         \
+    if constexpr (static_cast<int>(Logging::Level::level) >=                  \
+                  TD_LOG_MIN_LEVEL) {                                          \
+      if (Logging::is_enabled(Logging::Level::level)) {                        \
+        Logging::write(Logging::Level::level, __VA_ARGS__);                    \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+#endif
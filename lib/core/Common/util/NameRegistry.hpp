@@ -0,0 +1,82 @@
+/* NameRegistry.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_UTIL_NAME_REGISTRY_HPP
+#define TD_UTIL_NAME_REGISTRY_HPP
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Interns the entity names (mobs, towers) -- each name gets a 32-bit ID when
+ * the entity is created, and the simulation, events and lookups all go by the
+ * ID from then on. The names are only needed at the presentation edge (i.e. the
+ * frontend, logging), where they get resolved back from the ID.
+ *
+ * NOTE: the backend interns and the frontend resolves, so both are done under a
+ * lock. Neither happens per-tick for any given entity though, so the lock
+ * should be uncontended. The names are kept in a deque so that the references
+ * handed out by get_name stay valid as more names are interned
+ */
+class NameRegistry {
+public:
+  static constexpr uint32_t INVALID_ID = std::numeric_limits<uint32_t>::max();
+
+  NameRegistry() {}
+  NameRegistry(const NameRegistry &) = delete;
+  NameRegistry &operator=(const NameRegistry &) = delete;
+
+  // returns the name's ID, adding it if it's not already interned
+  uint32_t intern(const std::string &name) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto name_it = name_ids.find(name);
+    if (name_it != name_ids.end()) {
+      return name_it->second;
+    }
+
+    const uint32_t name_id = static_cast<uint32_t>(names.size());
+    if (name_id == INVALID_ID) {
+      throw std::runtime_error("Ran out of entity IDs");
+    }
+    names.push_back(name);
+    name_ids.emplace(name, name_id);
+    return name_id;
+  }
+
+  // returns INVALID_ID if the name hasn't been interned
+  uint32_t find(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto name_it = name_ids.find(name);
+    return name_it != name_ids.end() ? name_it->second : INVALID_ID;
+  }
+
+  const std::string &get_name(const uint32_t name_id) const {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (name_id >= names.size()) {
+      throw std::logic_error("Unknown entity ID " + std::to_string(name_id));
+    }
+    return names[name_id];
+  }
+
+  inline size_t size() const {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return names.size();
+  }
+
+private:
+  mutable std::mutex registry_mutex;
+  std::deque<std::string> names;
+  std::unordered_map<std::string, uint32_t> name_ids;
+};
+
+#endif
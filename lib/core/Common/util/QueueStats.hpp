@@ -0,0 +1,103 @@
+/* QueueStats.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_UTIL_QUEUE_STATS_HPP
+#define TD_UTIL_QUEUE_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// what a full event queue does with the event being pushed
+enum class OverflowPolicy {
+  // make room by dropping the oldest queued event
+  DropOldest,
+  // drop the event being pushed (the producer gets told)
+  DropNewest,
+  // the producer waits for the consumer to make room
+  Block,
+  // the event replaces a queued one that it supersedes (if there's no such
+  // event, it gets dropped as with DropNewest)
+  Coalesce
+};
+
+// a snapshot of an event queue's counters, for monitoring
+struct QueueStats {
+  // #events queued up at the time of the snapshot
+  size_t depth;
+  // the most events that were ever queued up at once
+  size_t high_water;
+  uint64_t num_pushed;
+  // events lost to the queue being full
+  uint64_t num_dropped;
+  // events merged into an already-queued one
+  uint64_t num_coalesced;
+  // pushes that found the queue full (whatever the policy did about it)
+  uint64_t num_full;
+};
+
+/*
+ * The counters behind QueueStats. They're updated by the producers / consumers
+ * as they go, and can be read from any thread without taking the queue's lock
+ *
+ * NOTE: each counter is consistent on its own, but a snapshot taken while the
+ * queue is in use may be a few events off between the counters
+ */
+class QueueCounters {
+public:
+  QueueCounters()
+      : depth(0), high_water(0), num_pushed(0), num_dropped(0),
+        num_coalesced(0), num_full(0) {}
+
+  QueueCounters(const QueueCounters &) = delete;
+  QueueCounters &operator=(const QueueCounters &) = delete;
+
+  // the queue's depth after the push
+  inline void count_push(const size_t queue_depth) {
+    num_pushed.fetch_add(1, std::memory_order_relaxed);
+    set_depth(queue_depth);
+  }
+
+  inline void set_depth(const size_t queue_depth) {
+    depth.store(queue_depth, std::memory_order_relaxed);
+    size_t max_depth = high_water.load(std::memory_order_relaxed);
+    while (queue_depth > max_depth &&
+           !high_water.compare_exchange_weak(max_depth, queue_depth,
+                                             std::memory_order_relaxed)) {
+    }
+  }
+
+  inline void count_drop() {
+    num_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  inline void count_coalesce() {
+    num_coalesced.fetch_add(1, std::memory_order_relaxed);
+  }
+  inline void count_full() { num_full.fetch_add(1, std::memory_order_relaxed); }
+
+  QueueStats snapshot() const {
+    QueueStats stats;
+    stats.depth = depth.load(std::memory_order_relaxed);
+    stats.high_water = high_water.load(std::memory_order_relaxed);
+    stats.num_pushed = num_pushed.load(std::memory_order_relaxed);
+    stats.num_dropped = num_dropped.load(std::memory_order_relaxed);
+    stats.num_coalesced = num_coalesced.load(std::memory_order_relaxed);
+    stats.num_full = num_full.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+private:
+  std::atomic<size_t> depth;
+  std::atomic<size_t> high_water;
+  std::atomic<uint64_t> num_pushed;
+  std::atomic<uint64_t> num_dropped;
+  std::atomic<uint64_t> num_coalesced;
+  std::atomic<uint64_t> num_full;
+};
+
+#endif
@@ -10,36 +10,31 @@
 #define TD_UTIL_RANDOM_UTIL_HPP
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <random>
 #include <vector>
 
 namespace Randomize {
-class TDRandomEngine {
-public:
-    static std::default_random_engine& get()
-    {
-        static TDRandomEngine instance;
-        return instance.eng;
-    }
+// NOTE: each game has its own engine (see TowerLogic::seed_random_engine), s.t.
+// a seeded game rolls the same regardless of what else is running alongside it
+using EngineType = std::default_random_engine;
 
-    TDRandomEngine(TDRandomEngine const&) = delete;
-    void operator=(TDRandomEngine const&) = delete;
-private:
-    TDRandomEngine() {
+// a seed for when the game wasn't given one
+inline uint32_t make_seed() {
 #ifdef RANDOM_SEED_TESTING
-      // kind of unfortunate, but this is how we avoid nondeterminism at testing time
-      eng = std::default_random_engine {RANDOM_SEED_TESTING};
+  // kind of unfortunate, but this is how we avoid nondeterminism at testing time
+  return RANDOM_SEED_TESTING;
 #else
-      std::random_device rdev{};
-      eng = std::default_random_engine {rdev()};
+  std::random_device rdev{};
+  return rdev();
 #endif
-    }
-    std::default_random_engine eng;
-};
+}
 
 class GaussianRoller {
 public:
-  GaussianRoller(const int mean, const int variance) : dist(mean, variance) {}
+  GaussianRoller(EngineType &engine, const int mean, const int variance)
+      : eng(engine), dist(mean, variance) {}
 
   void set_roller(int mean, int variance) {
     std::normal_distribution<>::param_type new_params{
@@ -47,22 +42,26 @@ public:
     dist.param(new_params);
   }
 
-  inline int roll_tower_tier() { return dist(TDRandomEngine::get()); }
+  inline int roll_tower_tier() { return dist(eng); }
 
 private:
+  EngineType &eng;
   std::normal_distribution<> dist;
 };
 
 class UniformRoller {
 public:
-  UniformRoller() {}
+  explicit UniformRoller(EngineType &engine) : eng(engine) {}
 
   // returns values between [0, weight)
   inline double get_roll(const double weight) {
     return std::generate_canonical<double, std::numeric_limits<double>::digits>(
-               TDRandomEngine::get()) *
+               eng) *
            weight;
   }
+
+private:
+  EngineType &eng;
 };
 
 } // namespace Randomize
@@ -0,0 +1,126 @@
+/* SPSCEventQueue.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_SPSC_EVENT_QUEUE_HPP
+#define TD_SPSC_EVENT_QUEUE_HPP
+
+#include "QueueStats.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*
+ * Bounded, lock-free single-producer / single-consumer ring buffer, with the
+ * same push / pop / empty interface as EventQueue. Only 1 thread may push and
+ * only 1 (other) thread may pop -- which holds for the backend --> frontend
+ * event queues, where the game loop is the only producer and the frontend's
+ * render loop the only consumer.
+ *
+ * The producer only writes the tail and the consumer only writes the head, so
+ * neither side needs a lock; each side also caches its last read of the other
+ * side's index, so it only touches the other side's cache line when the queue
+ * looks full (or empty).
+ *
+ * NOTE: unlike EventQueue, a full queue rejects the *newest* event (the one
+ * being pushed), since the producer can't safely pop from the consumer's end.
+ * The event is left with the producer, to hold onto or drop as it sees fit
+ */
+template <typename EventType> class SPSCEventQueue {
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+public:
+  // NOTE: the capacity gets rounded up to a power of 2
+  explicit SPSCEventQueue(const size_t max_sz = 512)
+      : slots(round_up_capacity(max_sz)), index_mask(slots.size() - 1),
+        tail(0), cached_head(0), head(0), cached_tail(0) {}
+
+  SPSCEventQueue(const SPSCEventQueue &) = delete;
+  SPSCEventQueue &operator=(const SPSCEventQueue &) = delete;
+
+  // producer side -- returns false if the queue was full, in which case data
+  // is left as it was
+  bool push(std::unique_ptr<EventType> &&data) {
+    const size_t write_idx = tail.load(std::memory_order_relaxed);
+    if (write_idx - cached_head >= slots.size()) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (write_idx - cached_head >= slots.size()) {
+        counters.count_full();
+        return false;
+      }
+    }
+
+    slots[write_idx & index_mask] = std::move(data);
+    tail.store(write_idx + 1, std::memory_order_release);
+    // NOTE: going by the cached head, so the high-water mark can overshoot a
+    // bit (rather than reading the consumer's index on every push)
+    counters.count_push(write_idx + 1 - cached_head);
+    return true;
+  }
+
+  // consumer side
+  std::unique_ptr<EventType> pop(bool &got_data) {
+    const size_t read_idx = head.load(std::memory_order_relaxed);
+    if (read_idx == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (read_idx == cached_tail) {
+        got_data = false;
+        return nullptr;
+      }
+    }
+
+    std::unique_ptr<EventType> data = std::move(slots[read_idx & index_mask]);
+    head.store(read_idx + 1, std::memory_order_release);
+    got_data = true;
+    return data;
+  }
+
+  // NOTE: only a snapshot if the other side is active
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+  size_t size() const {
+    return tail.load(std::memory_order_acquire) -
+           head.load(std::memory_order_acquire);
+  }
+
+  inline size_t capacity() const { return slots.size(); }
+
+  // NOTE: the counters are all kept by the producer, aside from the depth
+  QueueStats get_stats() const {
+    QueueStats stats = counters.snapshot();
+    stats.depth = size();
+    return stats;
+  }
+
+private:
+  static size_t round_up_capacity(const size_t max_sz) {
+    size_t capacity = 1;
+    while (capacity < max_sz) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  // NOTE: the events left in the queue get cleaned up along with the slots
+  std::vector<std::unique_ptr<EventType>> slots;
+  const size_t index_mask;
+
+  // the producer's cache line...
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+  size_t cached_head;
+  QueueCounters counters;
+  //... and the consumer's
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+  size_t cached_tail;
+};
+
+#endif
@@ -11,6 +11,9 @@
 
 #include "EventQueue.hpp"
 
+#include <cstdint>
+#include <vector>
+
 namespace UserTowerEvents {
 
 template <typename BackendType> struct tower_event {
@@ -127,7 +130,7 @@ struct tower_target_event : public tower_event<BackendType> {
   using tower_event<BackendType>::row_;
 
   void apply(BackendType *td_backend) override {
-    td_backend->tower_target(col_, row_, target_row, target_col);
+    td_backend->tower_target(col_, row_, target_col, target_row);
   }
 
   // the location to target - this may need some work, in case we have say,
@@ -145,6 +148,65 @@ std::ostream& operator<<(std::ostream& stream,
 }
 
 
+// a single command within a command_batch_event. Plain old data, s.t. a whole
+// batch can be handed over as 1 packed array (i.e. from a numpy array)
+struct tower_command {
+  enum class Kind : uint32_t { Build = 0, Modify, Target };
+
+  // NOTE: the factories take (col, row), same as the backend's make_tower etc.
+  static tower_command build(uint32_t tower_ID, int tower_tier, float col,
+                             float row) {
+    return tower_command{static_cast<uint32_t>(Kind::Build), tower_ID, tower_tier,
+                         row, col, -1.0f, -1.0f};
+  }
+  static tower_command modify(uint32_t modifier_idx, float col, float row) {
+    return tower_command{static_cast<uint32_t>(Kind::Modify), modifier_idx, 0,
+                         row, col, -1.0f, -1.0f};
+  }
+  static tower_command target(float col, float row, float t_col, float t_row) {
+    return tower_command{static_cast<uint32_t>(Kind::Target), 0, 0,
+                         row, col, t_row, t_col};
+  }
+
+  // the Kind
+  uint32_t kind;
+  // the tower ID for a build, the index into the batch's modifiers for a
+  // modify
+  uint32_t arg;
+  int32_t tier;
+  float row;
+  float col;
+  float target_row;
+  float target_col;
+};
+
+// a batch of build / modify / target commands, queued up as 1 event (so 1
+// allocation and 1 trip through the event queue for the whole batch) and
+// applied in 1 pass -- see apply_commands in the backend. The modifiers are
+// kept on the side, since they don't fit in a packed command
+template <typename T, typename BackendType>
+struct command_batch_event : public tower_event<BackendType> {
+  command_batch_event() {}
+  command_batch_event(std::vector<tower_command> batch_commands,
+                      std::vector<T> batch_modifiers)
+      : commands(std::move(batch_commands)),
+        modifiers(std::move(batch_modifiers)) {}
+
+  void apply(BackendType *td_backend) override {
+    td_backend->apply_commands(commands, modifiers);
+  }
+
+  std::vector<tower_command> commands;
+  std::vector<T> modifiers;
+};
+template <typename T, typename backendtype>
+std::ostream& operator<<(std::ostream& stream,
+                     const command_batch_event<T, backendtype>& event) {
+    stream << "command_batch_event -- " << event.commands.size() << " commands, "
+           << event.modifiers.size() << " modifiers";
+	return stream;
+}
+
 
 // TODO: decide on, and write the other ones
 
@@ -154,6 +216,10 @@ struct EventQueueType {
   // constructor. Hence no unique_ptr elements using QType =
   // boost::lockfree::spsc_queue<std::shared_ptr<EventType>,
   // boost::lockfree::capacity<SIZE>>;
+  //
+  // SPSCEventQueue does take unique_ptrs, but the user events can come from
+  // more than 1 frontend thread (e.g. the python bindings), so they stay on the
+  // locking queue
 
   using QType = EventQueue<EventType>;
 };
@@ -11,6 +11,7 @@
 
 #include "AttributeModifiers.hpp"
 #include "Elements.hpp"
+#include "Logger.hpp"
 #include "TowerProperties.hpp"
 
 /*
@@ -330,8 +331,9 @@ struct flat_type_damage : stat_attribute_modifier {
   flat_type_damage(parameter_cfg cfg)
       : value(cfg.low_val, cfg.high_val), type(cfg.type),
         scale(cfg.scale_factor) {
-    std::cout << "setting type " << static_cast<int>(type) << " -- flat dmg ["
-              << value.low << ", " << value.high << "]" << std::endl;
+    TD_LOG(Debug, "flat_type_damage",
+           Logging::kv("type", static_cast<int>(type)),
+           Logging::kv("low", value.low), Logging::kv("high", value.high));
   }
 
   flat_type_damage(float low_v, float high_v, Elements type, float scale_factor)
@@ -505,7 +507,7 @@ struct flat_damage_onhit : event_attribute_modifier {
     // tower_properties, but for others... who knows? will be +additional_damage
     // as flat damage in this case
     //
-    std::cout << "will add +" << additional_damage << " damage" << std::endl;
+    TD_LOG(Debug, "added_damage", Logging::kv("damage", additional_damage));
   }
 
   float increment_value;
@@ -570,8 +572,9 @@ struct flat_added_damage : stat_attribute_modifier {
 
   flat_added_damage(parameter_cfg cfg)
       : value(cfg.flat_dmg_amount), type(cfg.type), scale(cfg.scale_factor) {
-    std::cout << "setting type " << static_cast<int>(type) << " -- flat dmg "
-              << value << std::endl;
+    TD_LOG(Debug, "flat_added_damage",
+           Logging::kv("type", static_cast<int>(type)),
+           Logging::kv("damage", value));
   }
 
   flat_added_damage(float amount, Elements type, float scale_factor)
@@ -11,21 +11,48 @@
 
 #include "Model/TowerModel.hpp"
 #include "ModelUtils.hpp"
-#include "util/EventQueue.hpp"
-
+#include "util/EventNotifier.hpp"
+#include "util/NameRegistry.hpp"
+#include "util/QueueStats.hpp"
+#include "util/SPSCEventQueue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 /*********************************************************************
  * the (experimental) backend to frontend events
+ *
+ * NOTE: the entities are referred to by their IDs -- the mob and tower names
+ * can be looked up with ViewEvents::get_entity_name, while the attacks don't
+ * have names (they're identified by their ID and origin tower)
+ *
+ * NOTE: the attack and mob events are kept trivially copyable (no strings or
+ * vectors) -- that way adding them to a frame is just a copy into the frame's
+ * (recycled) storage, and clearing the frame doesn't have anything to free
+ *
+ * NOTE: rather than sending the positions every tick, the mob and attack
+ * movement is sent as a path that the frontend follows on its own -- the
+ * backend only sends a new path when the old one no longer holds (e.g. the
+ * map changed, or the attack's target is gone)
  *********************************************************************/
 
 namespace RenderEvents {
 struct create_tower {
   create_tower(const uint32_t ID, std::shared_ptr<TowerModel> model,
-               const std::string &name, std::vector<float> &&map_offsets)
-      : t_ID(ID), t_model(model), t_name(name),
+               const uint32_t name_id, std::vector<float> &&map_offsets)
+      : t_ID(ID), t_model(model), t_name_id(name_id),
         t_map_offsets(std::move(map_offsets)), t_world_offsets{0.0f, 0.0f,
                                                                0.0f} {
     std::vector<float> dim_avgs(3, 0);
@@ -46,9 +73,9 @@ struct create_tower {
     t_world_offsets[2] = dim_avgs[2] / fractal_ptfactor;
   }
 
-  const uint32_t t_ID;
+  uint32_t t_ID;
   std::shared_ptr<TowerModel> t_model;
-  std::string t_name;
+  uint32_t t_name_id;
   std::vector<float> t_map_offsets;
   std::vector<float> t_world_offsets;
 };
@@ -56,40 +83,47 @@ struct create_tower {
 struct create_attack {
   // create_attack(const std::string& atk_name, const std::vector<float>&
   // location, const std::vector<float>& destination)
-  create_attack(const std::string &atk_name, const uint32_t origin_id,
-                const std::string &origin_tower,
-                const std::vector<float> &destination)
-      : name(atk_name), origin_tid(origin_id), origin_tname(origin_tower),
-        target(destination) {}
-
-  const std::string name;
-  const uint32_t origin_tid;
-  const std::string origin_tname;
-  const std::vector<float> target;
+  create_attack(const uint32_t atk_id, const uint32_t origin_id,
+                const float target_col, const float target_row,
+                const float target_depth)
+      : id(atk_id), origin_tid(origin_id),
+        target{target_col, target_row, target_depth} {}
+
+  uint32_t id;
+  uint32_t origin_tid;
+  float target[3];
 };
 
-// the question is, how much do we move the attack per update? It should reflect
-// the backend state, but then we'd have to translate between front and backend
-// coordinates better.... or that could even be PART of the attack, not part of
-// the move update? --> for now, just make something up
-struct move_attack {
-  move_attack(const std::string &atk_name, const uint32_t origin_id,
-              const std::string &origin_tower,
-              const std::vector<float> &movement, float time_duration)
-      : name(atk_name), origin_tid(origin_id), origin_tname(origin_tower),
-        delta(movement), duration(time_duration) {}
-
-  const std::string name;
-  const uint32_t origin_tid;
-  const std::string origin_tname;
-  const std::vector<float> delta;
-  const float duration;
+// the attack is at the start position at the start of the start_timestamp tick,
+// and moves (at most) speed towards its target on every tick from then on that
+// is a multiple of the move_interval. If it's homing in on a mob, the target is
+// wherever the mob is at the end of that tick (the mobs move first)
+struct attack_path {
+  attack_path(const uint32_t atk_id, const uint32_t origin_id,
+              const float start_col, const float start_row,
+              const float target_col, const float target_row,
+              const uint32_t target_mob_id, const float move_speed,
+              const uint64_t start_ts, const uint32_t interval)
+      : id(atk_id), origin_tid(origin_id), start{start_col, start_row, 0.0f},
+        target{target_col, target_row, 0.0f}, target_mob(target_mob_id),
+        speed(move_speed), start_timestamp(start_ts), move_interval(interval) {
+  }
+
+  uint32_t id;
+  uint32_t origin_tid;
+  float start[3];
+  float target[3];
+  // NameRegistry::INVALID_ID if the attack isn't homing in on a mob
+  uint32_t target_mob;
+  float speed;
+  uint64_t start_timestamp;
+  uint32_t move_interval;
 };
 
 struct remove_attack {
-  remove_attack(const std::string &atk_name) : name(atk_name) {}
+  remove_attack(const uint32_t atk_id) : id(atk_id) {}
 
-  const std::string name;
+  uint32_t id;
 };
 // NOTE: since we also have to animate characters (and possibly anything else),
 // we should probably look at ways to do this in a more generic manner.
@@ -100,29 +134,73 @@ struct remove_attack {
 // number (otherwise we'll have dozens of largely overlapping event types and
 // event queues)
 struct create_mob {
-  create_mob(const CharacterModels::ModelIDs id, const std::string &name,
-             std::vector<float> &&map_offsets)
-      : model_id(id), m_name(name), m_map_offsets(std::move(map_offsets)) {}
-
-  const CharacterModels::ModelIDs model_id;
-  std::string m_name;
-  std::vector<float> m_map_offsets;
+  // NOTE: the offsets are {x, y, z}, i.e. {col, row, depth}
+  create_mob(const CharacterModels::ModelIDs id, const uint32_t mob_id,
+             const float col, const float row, const float depth)
+      : model_id(id), m_id(mob_id), m_map_offsets{col, row, depth} {}
+
+  CharacterModels::ModelIDs model_id;
+  uint32_t m_id;
+  float m_map_offsets[3];
 };
 
-struct move_mob {
-  move_mob(const std::string &mob_name, const std::vector<float> &movement,
-           float time_duration)
-      : name(mob_name), delta(movement), duration(time_duration) {}
+struct waypoint {
+  float col;
+  float row;
+};
 
-  const std::string name;
-  const std::vector<float> delta;
-  const float duration;
+// the mob is at the start position at the start of the start_timestamp tick.
+// On every tick from then on, it moves speed towards its next waypoint -- if
+// it's within reach of the waypoint, it stops there for the rest of the tick
+// and heads for the waypoint after that on the next tick. The mob stays put
+// once it runs out of waypoints. NOTE: the waypoints are stored in the frame
+// (see RenderFrame::waypoints), so the event itself stays fixed-size
+struct mob_path {
+  mob_path(const uint32_t mob_id, const float start_col, const float start_row,
+           const float move_speed, const uint64_t start_ts)
+      : id(mob_id), start{start_col, start_row, 0.0f}, speed(move_speed),
+        start_timestamp(start_ts), waypoint_offset(0), num_waypoints(0) {}
+
+  uint32_t id;
+  float start[3];
+  float speed;
+  uint64_t start_timestamp;
+  // where the path's waypoints are in the frame's waypoint list
+  uint32_t waypoint_offset;
+  uint32_t num_waypoints;
 };
 
+// where the mob following the path is at the start of the given tick.
+// NOTE: this does exactly what the backend does, so it gives the same position
+// as the backend does (as long as the path still holds)
+inline waypoint extrapolate_mob(const mob_path &path,
+                                const waypoint *path_waypoints,
+                                const uint64_t timestamp) {
+  waypoint position{path.start[0], path.start[1]};
+  uint32_t waypoint_idx = 0;
+  for (uint64_t tick = path.start_timestamp;
+       tick < timestamp && waypoint_idx < path.num_waypoints; ++tick) {
+    const waypoint &dest = path_waypoints[waypoint_idx];
+    float nx_factor = dest.col - position.col;
+    float ny_factor = dest.row - position.row;
+    float target_dist =
+        std::sqrt(nx_factor * nx_factor + ny_factor * ny_factor);
+    if (target_dist <= path.speed) {
+      position = dest;
+      waypoint_idx++;
+    } else {
+      float dist_mag = path.speed / target_dist;
+      position.col += nx_factor * dist_mag;
+      position.row += ny_factor * dist_mag;
+    }
+  }
+  return position;
+}
+
 struct remove_mob {
-  remove_mob(const std::string &mob_name) : name(mob_name) {}
+  remove_mob(const uint32_t mob_id) : id(mob_id) {}
 
-  const std::string name;
+  uint32_t id;
 };
 
 // request for information of the selected unit (e.g. mob or tower)
@@ -151,8 +229,256 @@ struct state_transition {
   GAME_STATE old_state;
   GAME_STATE new_state;
 };
+
+static_assert(std::is_trivially_copyable<create_attack>::value &&
+                  std::is_trivially_copyable<attack_path>::value &&
+                  std::is_trivially_copyable<remove_attack>::value &&
+                  std::is_trivially_copyable<create_mob>::value &&
+                  std::is_trivially_copyable<mob_path>::value &&
+                  std::is_trivially_copyable<remove_mob>::value,
+              "the per-tick events should stay trivially copyable");
 } // namespace RenderEvents
 
+/*
+ * All of the backend --> frontend events from a single game tick, grouped by
+ * event type. The backend fills one of these in over the course of a tick and
+ * publishes it in one go at the end of the tick, so the frontend gets all of a
+ * tick's events together (and only has to synchronize once per tick)
+ *
+ * NOTE: the builds, removes and state transitions are lifecycle events -- the
+ * frontend's view of the game is wrong from then on if one goes missing, so
+ * they're never dropped. The paths only describe motion, and a newer path for
+ * the same unit makes the older one moot
+ *
+ * The attack and mob events are coalesced by unit ID as they're added, so a
+ * frame that spans several ticks (i.e. the frontend fell behind) holds at most
+ * 1 of each event per live unit:
+ *  - a newer path replaces the unit's pending path in place
+ *  - a remove cancels the unit's pending path, and its create if that's still
+ *    pending too -- in which case the remove gets dropped as well, since the
+ *    frontend never saw the unit
+ * The cancelled events are only marked as such, and get cleaned out by compact
+ */
+struct RenderFrame {
+  // marks a cancelled event (see compact)
+  static constexpr uint32_t CANCELLED_ID = NameRegistry::INVALID_ID;
+
+  RenderFrame()
+      : tick(0), timestamp(0), open_path_idx(NO_PATH), num_cancelled(0),
+        num_stale_waypoints(0) {}
+
+  inline size_t size() const {
+    return tower_builds.size() + attack_builds.size() + attack_paths.size() +
+           attack_removes.size() + mob_builds.size() + mob_paths.size() +
+           mob_removes.size() + unit_infos.size() + state_transitions.size();
+  }
+  inline bool empty() const { return size() == 0; }
+
+  inline const RenderEvents::waypoint *
+  get_waypoints(const RenderEvents::mob_path &path) const {
+    return waypoints.data() + path.waypoint_offset;
+  }
+
+  //---------------------------------------------------------------------------------------------------------
+  // the coalescing adds
+
+  void add_attack_build(const RenderEvents::create_attack &evt) {
+    attack_build_index[evt.id] = static_cast<uint32_t>(attack_builds.size());
+    attack_builds.push_back(evt);
+  }
+  void add_attack_path(const RenderEvents::attack_path &evt) {
+    auto path_it = attack_path_index.find(evt.id);
+    if (path_it != attack_path_index.end()) {
+      attack_paths[path_it->second] = evt;
+    } else {
+      attack_path_index.emplace(evt.id,
+                                static_cast<uint32_t>(attack_paths.size()));
+      attack_paths.push_back(evt);
+    }
+  }
+  void add_attack_remove(const RenderEvents::remove_attack &evt) {
+    cancel_event(attack_path_index, attack_paths, evt.id);
+    if (!cancel_event(attack_build_index, attack_builds, evt.id)) {
+      attack_removes.push_back(evt);
+    }
+  }
+
+  void add_mob_build(const RenderEvents::create_mob &evt) {
+    mob_build_index[evt.m_id] = static_cast<uint32_t>(mob_builds.size());
+    mob_builds.push_back(evt);
+  }
+  // the path's waypoints are added (in order) with add_mob_waypoint, right
+  // after adding the path
+  void add_mob_path(RenderEvents::mob_path evt) {
+    evt.waypoint_offset = static_cast<uint32_t>(waypoints.size());
+    evt.num_waypoints = 0;
+    auto path_it = mob_path_index.find(evt.id);
+    if (path_it != mob_path_index.end()) {
+      // NOTE: the replaced path's waypoints are left in place until compact
+      num_stale_waypoints += mob_paths[path_it->second].num_waypoints;
+      mob_paths[path_it->second] = evt;
+      open_path_idx = path_it->second;
+    } else {
+      open_path_idx = static_cast<uint32_t>(mob_paths.size());
+      mob_path_index.emplace(evt.id, open_path_idx);
+      mob_paths.push_back(evt);
+    }
+  }
+  void add_mob_waypoint(const RenderEvents::waypoint &path_waypoint) {
+    if (open_path_idx == NO_PATH) {
+      throw std::logic_error("Waypoint added without a mob path");
+    }
+    waypoints.push_back(path_waypoint);
+    mob_paths[open_path_idx].num_waypoints++;
+  }
+  void add_mob_remove(const RenderEvents::remove_mob &evt) {
+    auto path_it = mob_path_index.find(evt.id);
+    if (path_it != mob_path_index.end()) {
+      num_stale_waypoints += mob_paths[path_it->second].num_waypoints;
+      open_path_idx = NO_PATH;
+    }
+    cancel_event(mob_path_index, mob_paths, evt.id);
+    if (!cancel_event(mob_build_index, mob_builds, evt.id)) {
+      mob_removes.push_back(evt);
+    }
+  }
+
+  // cleans out the cancelled events and the replaced paths' waypoints. NOTE:
+  // this moves the events around, so the index gets rebuilt
+  void compact() {
+    if (num_cancelled == 0 && num_stale_waypoints == 0) {
+      return;
+    }
+
+    remove_cancelled(attack_builds);
+    remove_cancelled(attack_paths);
+    remove_cancelled(mob_builds);
+    remove_cancelled(mob_paths);
+    if (num_stale_waypoints > 0) {
+      compacted_waypoints.clear();
+      for (auto &path : mob_paths) {
+        const auto *path_waypoints = get_waypoints(path);
+        path.waypoint_offset =
+            static_cast<uint32_t>(compacted_waypoints.size());
+        compacted_waypoints.insert(compacted_waypoints.end(), path_waypoints,
+                                   path_waypoints + path.num_waypoints);
+      }
+      waypoints.swap(compacted_waypoints);
+    }
+    num_cancelled = 0;
+    num_stale_waypoints = 0;
+
+    reset_index();
+    for (uint32_t evt_idx = 0; evt_idx < attack_builds.size(); evt_idx++) {
+      attack_build_index[attack_builds[evt_idx].id] = evt_idx;
+    }
+    for (uint32_t evt_idx = 0; evt_idx < attack_paths.size(); evt_idx++) {
+      attack_path_index[attack_paths[evt_idx].id] = evt_idx;
+    }
+    for (uint32_t evt_idx = 0; evt_idx < mob_builds.size(); evt_idx++) {
+      mob_build_index[mob_builds[evt_idx].m_id] = evt_idx;
+    }
+    for (uint32_t evt_idx = 0; evt_idx < mob_paths.size(); evt_idx++) {
+      mob_path_index[mob_paths[evt_idx].id] = evt_idx;
+    }
+  }
+
+  // forgets which events are pending, so nothing more gets coalesced with them
+  // -- for when some of the events have been taken out of the frame.
+  // NOTE: compact first if anything was cancelled
+  void reset_index() {
+    attack_build_index.clear();
+    attack_path_index.clear();
+    mob_build_index.clear();
+    mob_path_index.clear();
+    open_path_idx = NO_PATH;
+  }
+
+  // NOTE: keeps the capacity around, s.t. the frames can be recycled
+  void clear() {
+    tick = 0;
+    timestamp = 0;
+    reset_index();
+    num_cancelled = 0;
+    num_stale_waypoints = 0;
+    tower_builds.clear();
+    attack_builds.clear();
+    attack_paths.clear();
+    attack_removes.clear();
+    mob_builds.clear();
+    mob_paths.clear();
+    waypoints.clear();
+    mob_removes.clear();
+    unit_infos.clear();
+    state_transitions.clear();
+  }
+
+  // the game loop iteration the events are from (counts every iteration, unlike
+  // the game timestamp, which only advances during the rounds)
+  uint64_t tick;
+  uint64_t timestamp;
+
+  std::vector<RenderEvents::create_tower> tower_builds;
+
+  std::vector<RenderEvents::create_attack> attack_builds;
+  std::vector<RenderEvents::attack_path> attack_paths;
+  std::vector<RenderEvents::remove_attack> attack_removes;
+
+  std::vector<RenderEvents::create_mob> mob_builds;
+  std::vector<RenderEvents::mob_path> mob_paths;
+  std::vector<RenderEvents::remove_mob> mob_removes;
+  // the mob paths' waypoints, back to back
+  std::vector<RenderEvents::waypoint> waypoints;
+
+  std::vector<RenderEvents::unit_information> unit_infos;
+  std::vector<RenderEvents::state_transition> state_transitions;
+
+private:
+  static constexpr uint32_t NO_PATH = std::numeric_limits<uint32_t>::max();
+  using EventIndex = std::unordered_map<uint32_t, uint32_t>;
+
+  static inline uint32_t &event_id(RenderEvents::create_mob &evt) {
+    return evt.m_id;
+  }
+  template <typename EventType> static inline uint32_t &event_id(EventType &evt) {
+    return evt.id;
+  }
+
+  // returns true if there was a pending event for the unit to cancel
+  template <typename EventType>
+  bool cancel_event(EventIndex &index, std::vector<EventType> &events,
+                    const uint32_t unit_id) {
+    auto evt_it = index.find(unit_id);
+    if (evt_it == index.end()) {
+      return false;
+    }
+    event_id(events[evt_it->second]) = CANCELLED_ID;
+    index.erase(evt_it);
+    num_cancelled++;
+    return true;
+  }
+
+  template <typename EventType>
+  static void remove_cancelled(std::vector<EventType> &events) {
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [](EventType &evt) {
+                                  return event_id(evt) == CANCELLED_ID;
+                                }),
+                 events.end());
+  }
+
+  // unit ID --> where its pending event is
+  EventIndex attack_build_index;
+  EventIndex attack_path_index;
+  EventIndex mob_build_index;
+  EventIndex mob_path_index;
+  // the mob path that add_mob_waypoint adds to
+  uint32_t open_path_idx;
+  uint32_t num_cancelled;
+  uint32_t num_stale_waypoints;
+  std::vector<RenderEvents::waypoint> compacted_waypoints;
+};
+
 /*
  * This class should hold the backend to frontend events -- the gameloop will
  * create this classes object, then register it with the front and backend. Then
@@ -161,17 +487,10 @@ struct state_transition {
  */
 class ViewEvents {
 public:
-  using MakeTowerQueueType = EventQueue<RenderEvents::create_tower>;
-  using MakeAttackQueueType = EventQueue<RenderEvents::create_attack>;
-  using MoveAttackQueueType = EventQueue<RenderEvents::move_attack>;
-  using RemoveAttackQueueType = EventQueue<RenderEvents::remove_attack>;
-
-  using MakeMobQueueType = EventQueue<RenderEvents::create_mob>;
-  using MoveMobQueueType = EventQueue<RenderEvents::move_mob>;
-  using RemoveMobQueueType = EventQueue<RenderEvents::remove_mob>;
-
-  using UnitInfoQueueType = EventQueue<RenderEvents::unit_information>;
-  using StateTransitionQueueType = EventQueue<RenderEvents::state_transition>;
+  // NOTE: the game loop is the only producer and the frontend the only
+  // consumer, so the frames can go through the lock-free SPSC queue. The used
+  // frames go back to the game loop the same way, for reuse
+  using FrameQueueType = SPSCEventQueue<RenderFrame>;
 
   enum class EventTypes {
     MakeTower,
@@ -186,113 +505,231 @@ public:
     StateTransition
   };
 
-  ViewEvents() {
-    maketower_evtqueue =
-        std::unique_ptr<MakeTowerQueueType>(new MakeTowerQueueType());
-    makeattack_evtqueue =
-        std::unique_ptr<MakeAttackQueueType>(new MakeAttackQueueType());
-    moveattack_evtqueue =
-        std::unique_ptr<MoveAttackQueueType>(new MoveAttackQueueType());
-    removeattack_evtqueue =
-        std::unique_ptr<RemoveAttackQueueType>(new RemoveAttackQueueType());
-
-    makemob_evtqueue =
-        std::unique_ptr<MakeMobQueueType>(new MakeMobQueueType());
-    movemob_evtqueue =
-        std::unique_ptr<MoveMobQueueType>(new MoveMobQueueType());
-    removemob_evtqueue =
-        std::unique_ptr<RemoveMobQueueType>(new RemoveMobQueueType());
-
-    unitinfo_evtqueue =
-        std::unique_ptr<UnitInfoQueueType>(new UnitInfoQueueType());
-    statetransition_evtqueue = std::unique_ptr<StateTransitionQueueType>(
-        new StateTransitionQueueType());
+  ViewEvents()
+      : num_ticks(0), num_held_frames(0), entity_names(nullptr),
+        active_notifier(nullptr) {
+    published_frames = std::unique_ptr<FrameQueueType>(new FrameQueueType());
+    released_frames = std::unique_ptr<FrameQueueType>(new FrameQueueType());
+    staging_frame = std::unique_ptr<RenderFrame>(new RenderFrame());
+    pending_frame = std::unique_ptr<RenderFrame>(new RenderFrame());
+  }
+
+  // the backend's name registry, for resolving the entity IDs in the events
+  void register_entity_names(const NameRegistry *names) {
+    entity_names = names;
+  }
+
+  // NOTE: this is for the presentation side (i.e. labels, debug output); the
+  // backend only deals in the IDs
+  const std::string &get_entity_name(const uint32_t entity_id) const {
+    if (entity_names == nullptr) {
+      throw std::logic_error("No entity names registered");
+    }
+    return entity_names->get_name(entity_id);
   }
 
   /////////////////////////////////////////////////////////////////////
+  // backend (game loop) side -- the events go into the current tick's frame
   void add_maketower_event(std::unique_ptr<RenderEvents::create_tower> evt) {
-    maketower_evtqueue->push(std::move(evt));
+    staging_frame->tower_builds.emplace_back(std::move(*evt));
   }
 
   //---------------------------------------------------------------------------------------------------------
 
-  void add_makeatk_event(std::unique_ptr<RenderEvents::create_attack> evt) {
-    makeattack_evtqueue->push(std::move(evt));
+  // NOTE: the attack and mob events are copied straight into the frame, no
+  // need to allocate them first. They're coalesced as they go in (see
+  // RenderFrame), which only really matters if the frame gets held back
+  void add_makeatk_event(const RenderEvents::create_attack &evt) {
+    staging_frame->add_attack_build(evt);
   }
-  void add_moveatk_event(std::unique_ptr<RenderEvents::move_attack> evt) {
-    moveattack_evtqueue->push(std::move(evt));
+  void add_attackpath_event(const RenderEvents::attack_path &evt) {
+    staging_frame->add_attack_path(evt);
   }
-  void add_removeatk_event(std::unique_ptr<RenderEvents::remove_attack> evt) {
-    removeattack_evtqueue->push(std::move(evt));
+  void add_removeatk_event(const RenderEvents::remove_attack &evt) {
+    staging_frame->add_attack_remove(evt);
   }
 
   //---------------------------------------------------------------------------------------------------------
 
-  void add_makemob_event(std::unique_ptr<RenderEvents::create_mob> evt) {
-    makemob_evtqueue->push(std::move(evt));
+  void add_makemob_event(const RenderEvents::create_mob &evt) {
+    staging_frame->add_mob_build(evt);
+  }
+  // the path's waypoints are added (in order) with add_mobpath_waypoint, right
+  // after adding the path
+  void add_mobpath_event(const RenderEvents::mob_path &evt) {
+    staging_frame->add_mob_path(evt);
   }
-  void add_movemob_event(std::unique_ptr<RenderEvents::move_mob> evt) {
-    movemob_evtqueue->push(std::move(evt));
+  void add_mobpath_waypoint(const float col, const float row) {
+    staging_frame->add_mob_waypoint(RenderEvents::waypoint{col, row});
   }
-  void add_removemob_event(std::unique_ptr<RenderEvents::remove_mob> evt) {
-    removemob_evtqueue->push(std::move(evt));
+  void add_removemob_event(const RenderEvents::remove_mob &evt) {
+    staging_frame->add_mob_remove(evt);
   }
 
   void add_unitinfo_event(std::unique_ptr<RenderEvents::unit_information> evt) {
-    unitinfo_evtqueue->push(std::move(evt));
+    staging_frame->unit_infos.emplace_back(std::move(*evt));
   }
 
   void add_statetransition_event(
       std::unique_ptr<RenderEvents::state_transition> evt) {
-    statetransition_evtqueue->push(std::move(evt));
+    staging_frame->state_transitions.emplace_back(std::move(*evt));
+  }
+
+  // hands the tick's events off to the frontend (if there were any), and starts
+  // on the next frame. Returns false if the frontend was too far behind to take
+  // the frame -- in which case the frame is held onto, and the next tick's
+  // events go into it as well (s.t. no lifecycle events get dropped)
+  bool publish_frame(const uint64_t timestamp) {
+    num_ticks++;
+    staging_frame->compact();
+    if (staging_frame->empty()) {
+      return true;
+    }
+
+    staging_frame->tick = num_ticks;
+    staging_frame->timestamp = timestamp;
+    if (!published_frames->push(std::move(staging_frame))) {
+      num_held_frames.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    // NOTE: taking the lock (however briefly) means the frontend can't miss
+    // the wakeup between checking the queue and going to sleep
+    { std::lock_guard<std::mutex> lock(frame_mutex); }
+    frame_cv.notify_one();
+    EventNotifier *notifier = active_notifier.load(std::memory_order_acquire);
+    if (notifier != nullptr) {
+      notifier->notify();
+    }
+
+    // reuse one of the frames that the frontend is done with, if there is one
+    bool got_frame = false;
+    staging_frame = released_frames->pop(got_frame);
+    if (!got_frame) {
+      staging_frame = std::unique_ptr<RenderFrame>(new RenderFrame());
+    }
+    staging_frame->clear();
+    return true;
   }
+
+  // the published frame queue's counters -- the frames that had to be held
+  // back (and merged with the next tick's) count as coalesced. Safe to call
+  // from any thread
+  QueueStats get_frame_stats() const {
+    QueueStats stats = published_frames->get_stats();
+    stats.num_coalesced = num_held_frames.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  //---------------------------------------------------------------------------------------------------------
+  // frontend side -- gets the oldest published frame (or nullptr if there
+  // isn't one). Hand the frame back via release_frame once done with it
+  std::unique_ptr<RenderFrame> pop_frame() {
+    bool got_frame = false;
+    return published_frames->pop(got_frame);
+  }
+
+  // blocks until there's a published frame to pop, or the deadline passes.
+  // Returns true if there's a frame, s.t. the frontend doesn't have to poll
+  template <typename Clock, typename Duration>
+  bool wait_for_frames(
+      const std::chrono::time_point<Clock, Duration> &deadline) {
+    std::unique_lock<std::mutex> lock(frame_mutex);
+    return frame_cv.wait_until(lock, deadline,
+                               [this] { return !published_frames->empty(); });
+  }
+
+  // a fd that becomes readable whenever a frame gets published, for frontends
+  // that run an event loop (i.e. asyncio) rather than a thread of their own --
+  // once it's readable, take_frames gets everything that's been published. The
+  // fd is made on the first call (and stays owned by the ViewEvents)
+  int get_frame_fd() {
+    std::lock_guard<std::mutex> lock(notifier_mutex);
+    if (!frame_notifier) {
+      frame_notifier = std::unique_ptr<EventNotifier>(new EventNotifier());
+      active_notifier.store(frame_notifier.get(), std::memory_order_release);
+      // NOTE: the frames published before there was a notifier still need one
+      if (!published_frames->empty()) {
+        frame_notifier->notify();
+      }
+    }
+    return frame_notifier->get_fd();
+  }
+
+  // takes the events from all of the published frames in one go, coalesced the
+  // same as with the apply_*_events below. Returns false if there weren't any.
+  // NOTE: frames gets swapped with the pending frame rather than copied into,
+  // so pass the same frame in every time to have the storage reused
+  bool take_frames(RenderFrame &frames) {
+    EventNotifier *notifier = active_notifier.load(std::memory_order_acquire);
+    if (notifier != nullptr) {
+      // NOTE: drained before popping, so a frame published in the meantime
+      // leaves the fd readable rather than going unnoticed
+      notifier->drain();
+    }
+    gather_frames();
+    frames.clear();
+    std::swap(frames, *pending_frame);
+    return !frames.empty();
+  }
+
+  void release_frame(std::unique_ptr<RenderFrame> frame) {
+    // NOTE: if the game loop isn't taking them back, just let the frame go
+    released_frames->push(std::move(frame));
+  }
+
   //---------------------------------------------------------------------------------------------------------
+  // NOTE: these are for frontends that handle the events 1 type at a time --
+  // they gather up all of the published frames, and hand over the events of the
+  // given type (oldest first), ignoring which tick they came from
 
   template <typename ViewFcn> void apply_towerbuild_events(ViewFcn &vfcn) {
-    execute_event_type<MakeTowerQueueType, ViewFcn>(maketower_evtqueue.get(),
-                                                    vfcn);
+    execute_event_type(&RenderFrame::tower_builds, vfcn);
   }
 
   //---------------------------------------------------------------------------------------------------------
 
   template <typename ViewFcn> void apply_attackbuild_events(ViewFcn &vfcn) {
-    execute_event_type<MakeAttackQueueType, ViewFcn>(makeattack_evtqueue.get(),
-                                                     vfcn);
+    execute_event_type(&RenderFrame::attack_builds, vfcn);
   }
 
-  template <typename ViewFcn> void apply_attackmove_events(ViewFcn &vfcn) {
-    execute_event_type<MoveAttackQueueType, ViewFcn>(moveattack_evtqueue.get(),
-                                                     vfcn);
+  template <typename ViewFcn> void apply_attackpath_events(ViewFcn &vfcn) {
+    execute_event_type(&RenderFrame::attack_paths, vfcn);
   }
 
   template <typename ViewFcn> void apply_attackremove_events(ViewFcn &vfcn) {
-    execute_event_type<RemoveAttackQueueType, ViewFcn>(
-        removeattack_evtqueue.get(), vfcn);
+    execute_event_type(&RenderFrame::attack_removes, vfcn);
   }
 
   //---------------------------------------------------------------------------------------------------------
 
   template <typename ViewFcn> void apply_mobbuild_events(ViewFcn &vfcn) {
-    execute_event_type<MakeMobQueueType, ViewFcn>(makemob_evtqueue.get(), vfcn);
+    execute_event_type(&RenderFrame::mob_builds, vfcn);
   }
 
-  template <typename ViewFcn> void apply_mobmove_events(ViewFcn &vfcn) {
-    execute_event_type<MoveMobQueueType, ViewFcn>(movemob_evtqueue.get(), vfcn);
+  // NOTE: vfcn also gets a pointer to the path's waypoints, which is only good
+  // for the duration of the call
+  template <typename ViewFcn> void apply_mobpath_events(ViewFcn &vfcn) {
+    gather_frames();
+    for (const auto &path : pending_frame->mob_paths) {
+      vfcn(std::unique_ptr<RenderEvents::mob_path>(
+               new RenderEvents::mob_path(path)),
+           pending_frame->get_waypoints(path));
+    }
+    pending_frame->mob_paths.clear();
+    pending_frame->waypoints.clear();
+    pending_frame->reset_index();
   }
 
   template <typename ViewFcn> void apply_mobremove_events(ViewFcn &vfcn) {
-    execute_event_type<RemoveMobQueueType, ViewFcn>(removemob_evtqueue.get(),
-                                                    vfcn);
+    execute_event_type(&RenderFrame::mob_removes, vfcn);
   }
 
   template <typename ViewFcn> void apply_unitinfo_events(ViewFcn &vfcn) {
-    execute_event_type<UnitInfoQueueType, ViewFcn>(unitinfo_evtqueue.get(),
-                                                   vfcn);
+    execute_event_type(&RenderFrame::unit_infos, vfcn);
   }
 
   template <typename ViewFcn> void apply_statetransition_events(ViewFcn &vfcn) {
-    execute_event_type<StateTransitionQueueType, ViewFcn>(
-        statetransition_evtqueue.get(), vfcn);
+    execute_event_type(&RenderFrame::state_transitions, vfcn);
   }
 
   //---------------------------------------------------------------------------------------------------------
@@ -302,29 +739,90 @@ public:
    * for all N of them. The
    */
 private:
-  // NOTE: this doesn't actually have to be in this class, as it's written
-  template <typename QueueType, typename ViewFcn>
-  void execute_event_type(QueueType *evt_queue, ViewFcn &vfcn) {
-    while (!evt_queue->empty()) {
-      bool got_evt = false;
-      auto render_evt = evt_queue->pop(got_evt);
-      if (got_evt && render_evt) {
-        vfcn(std::move(render_evt));
+  // moves the events from all of the published frames into the pending frame
+  // -- the attack and mob events get coalesced with the ones already pending,
+  // so a frontend that's behind only has to apply the latest of them.
+  // NOTE: a frame's creates are added before its paths, and the paths before
+  // its removes, as that's the order they happen in within a tick
+  void gather_frames() {
+    auto frame = pop_frame();
+    if (!frame) {
+      return;
+    }
+    while (frame) {
+      pending_frame->tick = frame->tick;
+      pending_frame->timestamp = frame->timestamp;
+      append_events(pending_frame->tower_builds, frame->tower_builds);
+      for (const auto &evt : frame->attack_builds) {
+        pending_frame->add_attack_build(evt);
+      }
+      for (const auto &evt : frame->attack_paths) {
+        pending_frame->add_attack_path(evt);
+      }
+      for (const auto &evt : frame->attack_removes) {
+        pending_frame->add_attack_remove(evt);
       }
+      for (const auto &evt : frame->mob_builds) {
+        pending_frame->add_mob_build(evt);
+      }
+      // NOTE: the paths' waypoints move along with them
+      for (const auto &path : frame->mob_paths) {
+        pending_frame->add_mob_path(path);
+        const auto *path_waypoints = frame->get_waypoints(path);
+        for (uint32_t wp_idx = 0; wp_idx < path.num_waypoints; wp_idx++) {
+          pending_frame->add_mob_waypoint(path_waypoints[wp_idx]);
+        }
+      }
+      for (const auto &evt : frame->mob_removes) {
+        pending_frame->add_mob_remove(evt);
+      }
+      append_events(pending_frame->unit_infos, frame->unit_infos);
+      append_events(pending_frame->state_transitions,
+                    frame->state_transitions);
+      release_frame(std::move(frame));
+      frame = pop_frame();
     }
+    pending_frame->compact();
   }
 
-  std::unique_ptr<MakeTowerQueueType> maketower_evtqueue;
-  std::unique_ptr<MakeAttackQueueType> makeattack_evtqueue;
-  std::unique_ptr<MoveAttackQueueType> moveattack_evtqueue;
-  std::unique_ptr<RemoveAttackQueueType> removeattack_evtqueue;
+  template <typename EventType>
+  static void append_events(std::vector<EventType> &events,
+                            std::vector<EventType> &frame_events) {
+    for (auto &render_evt : frame_events) {
+      events.emplace_back(std::move(render_evt));
+    }
+  }
 
-  std::unique_ptr<MakeMobQueueType> makemob_evtqueue;
-  std::unique_ptr<MoveMobQueueType> movemob_evtqueue;
-  std::unique_ptr<RemoveMobQueueType> removemob_evtqueue;
+  template <typename EventType, typename ViewFcn>
+  void execute_event_type(std::vector<EventType> RenderFrame::*frame_events,
+                          ViewFcn &vfcn) {
+    gather_frames();
+    auto &events = (*pending_frame).*frame_events;
+    for (auto &render_evt : events) {
+      vfcn(std::unique_ptr<EventType>(new EventType(std::move(render_evt))));
+    }
+    events.clear();
+    pending_frame->reset_index();
+  }
 
-  std::unique_ptr<UnitInfoQueueType> unitinfo_evtqueue;
-  std::unique_ptr<StateTransitionQueueType> statetransition_evtqueue;
+  // the frame being filled in by the game loop
+  std::unique_ptr<RenderFrame> staging_frame;
+  uint64_t num_ticks;
+  std::atomic<uint64_t> num_held_frames;
+  // game loop --> frontend, and the used frames back again
+  std::unique_ptr<FrameQueueType> published_frames;
+  std::unique_ptr<FrameQueueType> released_frames;
+  // only for waking up the frontend when a frame gets published
+  std::mutex frame_mutex;
+  std::condition_variable frame_cv;
+  // the frontend's events not yet handed over by the apply_* functions
+  std::unique_ptr<RenderFrame> pending_frame;
+  // NOTE: owned by the backend
+  const NameRegistry *entity_names;
+  // see get_frame_fd -- the game loop only ever looks at the active_notifier
+  std::mutex notifier_mutex;
+  std::unique_ptr<EventNotifier> frame_notifier;
+  std::atomic<EventNotifier *> active_notifier;
 };
 
 #endif
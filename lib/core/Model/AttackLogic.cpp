@@ -1,4 +1,5 @@
 #include "AttackLogic.hpp"
+#include "util/Logger.hpp"
 #include "util/RandomUtility.hpp"
 
 #include <algorithm>
@@ -25,8 +26,9 @@ void compute_mitigation(
 
 // merge the per-element damage and get the final, scalar HP deduction amount
 float compute_damage(const tower_properties &props,
-                     const MonsterStats &mob_stats) {
-  auto attack_roller = Randomize::UniformRoller();
+                     const MonsterStats &mob_stats,
+                     Randomize::EngineType &engine) {
+  auto attack_roller = Randomize::UniformRoller(engine);
   std::array<float, tower_property_modifier::NUM_ELEM> damage{};
   const Elements ttype = mob_stats.armor_class;
   bool atk_crit = attack_roller.get_roll(1) < props.modifier.crit_chance_value;
@@ -45,14 +47,8 @@ float compute_damage(const tower_properties &props,
     }
 
     // have the built-in affinity effects
-    const auto atkcoeff_type =
-        std::make_pair(static_cast<Elements>(elem_idx), ttype);
-    const auto dmg_factor_it = ElementInfo::damage_coeffs.find(atkcoeff_type);
-
-    float intrinisic_affinity_multiplier = 0;
-    if (dmg_factor_it != ElementInfo::damage_coeffs.end()) {
-      intrinisic_affinity_multiplier = dmg_factor_it->second;
-    }
+    const float intrinisic_affinity_multiplier =
+        ElementInfo::get_damage_coeff(static_cast<Elements>(elem_idx), ttype);
     // apply the affinity modifier
     float affinity_modifier =
         1 + intrinisic_affinity_multiplier +
@@ -70,58 +66,159 @@ float compute_damage(const tower_properties &props,
   return std::accumulate(damage.begin(), damage.end(), 0);
 }
 
-// TODO: try prototyping how the logic for applying the game mechanics will
-// be...
-void compute_attackhit(const std::list<std::weak_ptr<Monster>> &tile_mobs,
-                       std::unique_ptr<TowerAttackBase> attack) {
-  // TODO: get the mob pointer to attack
-  // TODO: calculate the damage to deal and state changes to apply
-  // TODO: ... ???
-  // TODO: apply state changes to mob and origin tower of attack
-  // TODO: mark attack for removal, if mob is dead, mark for removal
-  // TODO: ... ???
-  // TODO: profit?
-
-  auto origin_tower = attack->get_origin_tower();
-  auto target_mob_id = origin_tower->get_target_id();
-
-  auto mob_it = std::find_if(tile_mobs.begin(), tile_mobs.end(),
-                             [target_mob_id](const std::weak_ptr<Monster> &m) {
-                               if (auto tile_mob = m.lock()) {
-                                 auto tilemob_name = tile_mob->get_name();
-                                 return tilemob_name == target_mob_id;
-                               }
-                               return false;
-                             });
-
-  if (mob_it != tile_mobs.end()) {
-    if (auto target_mob = mob_it->lock()) {
-      auto mob_stats = target_mob->get_attributes();
-      auto atk_attributes = attack->get_attack_attributes();
-      float atk_dmg = compute_damage(atk_attributes, mob_stats);
-      const bool mob_alive = target_mob->recieve_damage(atk_dmg);
-
-      std::cout << "attack " << attack->get_id() << " did " << atk_dmg
-                << " damage"
-                << " to mob " << target_mob->get_name() << std::endl;
-
-      // TODO: generate the status updates
-
-      // TODO: trigger the on-hit events
-
-      // TODO: if the mob died, then handle the funeral proceedings (on-death
-      // events)
-      if (!mob_alive) {
-        // tell the tower that it killed something... not sure what other info
-        // it needs (maybe the mob id? or no?)
-        origin_tower->killed_mob();
-      }
+void DamageBatch::clear() {
+  for (int elem_idx = 0; elem_idx < NUM_ELEM; elem_idx++) {
+    rolled_damage[elem_idx].clear();
+    enhanced_damage[elem_idx].clear();
+    added_damage[elem_idx].clear();
+  }
+  crit_multiplier.clear();
+  affinity_bonus.clear();
+  armor_class.clear();
+  flat_armor.clear();
+  percent_armor.clear();
+  thresh_armor.clear();
+  hit_damage.clear();
+}
+
+size_t DamageBatch::add_hit(const tower_properties &props,
+                            const MonsterStats &mob_stats,
+                            Randomize::EngineType &engine) {
+  // NOTE: the rolls have to be in the same order as in compute_damage -- i.e.
+  // the crit roll, then the per-element damage rolls
+  auto attack_roller = Randomize::UniformRoller(engine);
+  bool atk_crit = attack_roller.get_roll(1) < props.modifier.crit_chance_value;
+  crit_multiplier.push_back(atk_crit ? 1 + props.modifier.crit_multiplier_value
+                                     : 1);
+  for (int elem_idx = 0; elem_idx < NUM_ELEM; elem_idx++) {
+    auto elem_dmg = props.modifier.damage_value[elem_idx];
+    const auto raw_dmg =
+        elem_dmg.low + attack_roller.get_roll(elem_dmg.high - elem_dmg.low);
+    rolled_damage[elem_idx].push_back(raw_dmg);
+    enhanced_damage[elem_idx].push_back(
+        props.modifier.enhanced_damage_value[elem_idx]);
+    added_damage[elem_idx].push_back(
+        props.modifier.added_damage_value[elem_idx]);
+  }
+
+  const int ttype = static_cast<int>(mob_stats.armor_class);
+  affinity_bonus.push_back(props.modifier.enhanced_damage_affinity[ttype]);
+  armor_class.push_back(static_cast<uint8_t>(ttype));
+  flat_armor.push_back(mob_stats.flat_armor);
+  percent_armor.push_back(mob_stats.percent_armor);
+  thresh_armor.push_back(mob_stats.thresh_armor);
+  return crit_multiplier.size() - 1;
+}
+
+// NOTE: this has to do exactly the same float operations (in the same order)
+// as compute_damage and compute_mitigation, s.t. the results are identical.
+// Going element-by-element over all of the hits keeps the loops branch-free and
+// contiguous, so the compiler can vectorize them
+void compute_damage(DamageBatch &hits) {
+  const size_t num_hits = hits.size();
+  hits.damage_totals.assign(num_hits, 0);
+  hits.hit_damage.resize(num_hits);
+
+  const float *crit_multiplier = hits.crit_multiplier.data();
+  const float *affinity_bonus = hits.affinity_bonus.data();
+  const uint8_t *armor_class = hits.armor_class.data();
+  const float *flat_armor = hits.flat_armor.data();
+  const float *percent_armor = hits.percent_armor.data();
+  const float *thresh_armor = hits.thresh_armor.data();
+  int *damage_totals = hits.damage_totals.data();
+
+  for (int elem_idx = 0; elem_idx < DamageBatch::NUM_ELEM; elem_idx++) {
+    // this element's row of the affinity table
+    std::array<float, ElementInfo::NUM_ELEMENTS> affinity_coeffs;
+    for (int armor_idx = 0; armor_idx < ElementInfo::NUM_ELEMENTS;
+         armor_idx++) {
+      affinity_coeffs[armor_idx] =
+          ElementInfo::affinity_coeffs[elem_idx * ElementInfo::NUM_ELEMENTS +
+                                       armor_idx];
+    }
+
+    const float *rolled_damage = hits.rolled_damage[elem_idx].data();
+    const float *enhanced_damage = hits.enhanced_damage[elem_idx].data();
+    const float *added_damage = hits.added_damage[elem_idx].data();
+    for (size_t hit_idx = 0; hit_idx < num_hits; hit_idx++) {
+      float damage = rolled_damage[hit_idx];
+      damage *= (1 + enhanced_damage[hit_idx]);
+      damage *= crit_multiplier[hit_idx];
+      float affinity_modifier = 1 + affinity_coeffs[armor_class[hit_idx]] +
+                                affinity_bonus[hit_idx];
+      damage *= affinity_modifier;
+      damage += added_damage[hit_idx];
+
+      // the mob defense reduction
+      const float thresh = thresh_armor[hit_idx];
+      damage = (thresh > 0 && damage > thresh) ? thresh : damage;
+      damage = (1 - percent_armor[hit_idx]) * (damage - flat_armor[hit_idx]);
+      damage = damage < 0 ? 0 : damage;
+
+      // NOTE: compute_damage sums the elements up as an int, so each partial
+      // sum gets truncated
+      damage_totals[hit_idx] =
+          static_cast<int>(damage_totals[hit_idx] + damage);
     }
-  } else {
-    // NOTE: this shouldn't be possible, but I should check anyways for sanity's
-    // sake
-    std::cout << "ERROR: we collided with a non-existant mob?" << std::endl;
   }
+
+  for (size_t hit_idx = 0; hit_idx < num_hits; hit_idx++) {
+    hits.hit_damage[hit_idx] = damage_totals[hit_idx];
+  }
+}
+
+void AttackHitQueue::clear() {
+  damage.clear();
+  attack_ids.clear();
+  origin_towers.clear();
+  target_mobs.clear();
+}
+
+bool queue_attackhit(AttackHitQueue &hits, const MobTable &live_mobs,
+                     const SpatialGrid<GameMap>::CellRange &tile_mobs,
+                     const TowerAttackBase &attack,
+                     Randomize::EngineType &engine) {
+  const MobHandle target_mob = attack.get_target_handle();
+
+  // the tile mobs are table indices, so the target has to be in the tile at
+  // its current index
+  if (live_mobs.contains(target_mob) &&
+      std::find(tile_mobs.begin(), tile_mobs.end(),
+                live_mobs.index_of(target_mob)) != tile_mobs.end()) {
+    const uint32_t mob_idx = live_mobs.index_of(target_mob);
+    hits.damage.add_hit(attack.get_attack_attributes(),
+                        live_mobs.get_stats(mob_idx), engine);
+    hits.attack_ids.push_back(attack.get_id());
+    hits.origin_towers.push_back(attack.get_origin_tower());
+    hits.target_mobs.push_back(mob_idx);
+    return true;
+  }
+
+  // NOTE: this can happen if the target died (or reached the exit) while the
+  // attack was in-flight
+  TD_LOG(Debug, "attack_missing_target",
+         Logging::kv("attack_id", attack.get_id()));
+  return false;
 }
 
+void resolve_attackhits(AttackHitQueue &hits, MobTable &live_mobs) {
+  compute_damage(hits.damage);
+
+  for (size_t hit_idx = 0; hit_idx < hits.size(); hit_idx++) {
+    const uint32_t mob_idx = hits.target_mobs[hit_idx];
+    const float atk_dmg = hits.damage.hit_damage[hit_idx];
+    const bool mob_alive = live_mobs.recieve_damage(mob_idx, atk_dmg);
 
+    TD_LOG(Debug, "attack_damage",
+           Logging::kv("attack_id", hits.attack_ids[hit_idx]),
+           Logging::kv("mob_id", live_mobs.ids[mob_idx]),
+           Logging::kv("damage", atk_dmg),
+           Logging::kv("health", live_mobs.health[mob_idx]));
+
+    if (!mob_alive) {
+      hits.origin_towers[hit_idx]->killed_mob();
+    }
+  }
+
+  hits.clear();
+}
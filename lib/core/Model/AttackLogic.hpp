@@ -9,11 +9,19 @@
 #ifndef TD_ATTACK_LOGIC_HPP
 #define TD_ATTACK_LOGIC_HPP
 
+#include "GameMap.hpp"
+#include "MobTable.hpp"
 #include "Monster.hpp"
+#include "SpatialGrid.hpp"
 #include "Towers/Tower.hpp"
 #include "Towers/TowerAttack.hpp"
+#include "util/RandomUtility.hpp"
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 // compute the total damage values for an attack on a per-element basis,
 // post-mitigation
@@ -23,11 +31,73 @@ void compute_mitigation(
 
 // merge the per-element damage and get the final, scalar HP deduction amount
 float compute_damage(const tower_properties &props,
-                     const MonsterStats &mob_stats);
+                     const MonsterStats &mob_stats,
+                     Randomize::EngineType &engine);
 
-// TODO: try prototyping how the logic for applying the game mechanics will
-// be...
-void compute_attackhit(const std::list<std::weak_ptr<Monster>> &tile_mobs,
-                       std::unique_ptr<TowerAttackBase> attack);
+// the per-hit inputs for a batch of damage computations, laid out per-element
+// (structure-of-arrays) s.t. the damage kernel is a set of straight loops over
+// the hits. The random rolls are made as the hits are added, so that the rolls
+// happen in the same order as they would with compute_damage
+struct DamageBatch {
+  static constexpr int NUM_ELEM = tower_property_modifier::NUM_ELEM;
+
+  inline size_t size() const { return crit_multiplier.size(); }
+  inline bool empty() const { return crit_multiplier.empty(); }
+  void clear();
+
+  // returns the index of the hit in the batch
+  size_t add_hit(const tower_properties &props, const MonsterStats &mob_stats,
+                 Randomize::EngineType &engine);
+
+  // per-element columns
+  std::array<std::vector<float>, NUM_ELEM> rolled_damage;
+  std::array<std::vector<float>, NUM_ELEM> enhanced_damage;
+  std::array<std::vector<float>, NUM_ELEM> added_damage;
+
+  // per-hit columns -- NOTE: the crit multiplier is 1 for non-crits
+  std::vector<float> crit_multiplier;
+  std::vector<float> affinity_bonus;
+  std::vector<uint8_t> armor_class;
+  std::vector<float> flat_armor;
+  std::vector<float> percent_armor;
+  std::vector<float> thresh_armor;
+
+  // the results: the final, scalar HP deduction per hit
+  std::vector<float> hit_damage;
+  // scratch space for the kernel
+  std::vector<int> damage_totals;
+};
+
+// computes the damage for all the hits in the batch at once, into hit_damage.
+// Gives the same values as compute_damage would have for each of the hits
+void compute_damage(DamageBatch &hits);
+
+// the attacks that hit over a tick, waiting on their damage to be computed
+struct AttackHitQueue {
+  inline size_t size() const { return attack_ids.size(); }
+  inline bool empty() const { return attack_ids.empty(); }
+  void clear();
+
+  DamageBatch damage;
+  // what we still need from the attacks once they're gone
+  std::vector<uint32_t> attack_ids;
+  std::vector<Tower *> origin_towers;
+  // the (dense) MobTable index of each attack's target
+  std::vector<uint32_t> target_mobs;
+};
+
+// the attack hits its target (live) mob if it's among the mobs in the hit
+// tile. Rather than applying the damage right away, the hit is queued up to be
+// resolved with the rest of the tick's hits. Returns false if the target
+// wasn't in the tile. NOTE: the damage is rolled with the (game's) engine here
+bool queue_attackhit(AttackHitQueue &hits, const MobTable &live_mobs,
+                     const SpatialGrid<GameMap>::CellRange &tile_mobs,
+                     const TowerAttackBase &attack,
+                     Randomize::EngineType &engine);
+
+// computes the damage for all of the queued hits, applies it to the mobs (in
+// the order that the hits were queued), and clears the queue. NOTE: the mob
+// indices have to still be valid, i.e. no mobs removed since queueing the hits
+void resolve_attackhits(AttackHitQueue &hits, MobTable &live_mobs);
 
 #endif
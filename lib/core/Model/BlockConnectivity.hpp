@@ -0,0 +1,149 @@
+/* BlockConnectivity.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_BLOCK_CONNECTIVITY_HPP
+#define TD_BLOCK_CONNECTIVITY_HPP
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+
+// answers "would building here cut off the spawn from the destination?" without
+// having to re-run the pathfinding per candidate location.
+//
+// Since the towers always take up whole tower blocks, a free block is entirely
+// walkable, and 2 free blocks are connected iff they share an edge -- so the map
+// connectivity is the same as the connectivity of the (much smaller) graph of
+// free tower blocks. Building on a block cuts the path iff the block is an
+// articulation point of that graph that separates the spawn from the
+// destination, which we get from a single DFS (Tarjan's lowpoint) rooted at the
+// destination block. The DFS is re-run whenever the obstructions change
+template <typename MapT> class BlockConnectivity {
+  using index_coord_t = typename MapT::IndexCoordinate;
+  using tower_coord_t = typename MapT::TowerCoordinate;
+
+  static constexpr int BLOCKS_WIDE = MapT::MAP_WIDTH / MapT::TowerTileWidth;
+  static constexpr int BLOCKS_HIGH = MapT::MAP_HEIGHT / MapT::TowerTileHeight;
+  static constexpr int NUM_BLOCKS = BLOCKS_WIDE * BLOCKS_HIGH;
+  static constexpr int UNVISITED = -1;
+
+public:
+  BlockConnectivity() : spawn_block(0), dest_block(0), connected(false) {
+    cut_blocks.fill(false);
+  }
+
+  void rebuild(const MapT &gmap, const index_coord_t spawn_tile,
+               const index_coord_t dest_tile) {
+    spawn_block = get_block_idx(spawn_tile.col, spawn_tile.row);
+    dest_block = get_block_idx(dest_tile.col, dest_tile.row);
+
+    for (int block_idx = 0; block_idx < NUM_BLOCKS; ++block_idx) {
+      const int col = (block_idx % BLOCKS_WIDE) * MapT::TowerTileWidth;
+      const int row = (block_idx / BLOCKS_WIDE) * MapT::TowerTileHeight;
+      free_blocks[block_idx] = !gmap.is_obstructed(
+          tower_coord_t(std::make_tuple(col, col + MapT::TowerTileWidth),
+                        std::make_tuple(row, row + MapT::TowerTileHeight)));
+    }
+
+    cut_blocks.fill(false);
+    disc_time.fill(UNVISITED);
+    dfs_time = 0;
+    connected = free_blocks[dest_block] && free_blocks[spawn_block];
+    if (!connected) {
+      return;
+    }
+
+    visit_block(dest_block);
+    connected = disc_time[spawn_block] != UNVISITED;
+    // (trivially) building on either end of the path cuts it
+    cut_blocks[spawn_block] = connected;
+    cut_blocks[dest_block] = connected;
+  }
+
+  inline bool is_connected() const { return connected; }
+
+  // true if obstructing the (currently free) tower block would leave no path
+  // from the spawn to the destination. NOTE: if there is no path to begin with,
+  // then building can't make it any worse, so this is false
+  inline bool blocks_path(const tower_coord_t &block) const {
+    return cut_blocks[get_block_idx(std::get<0>(block.col),
+                                    std::get<0>(block.row))];
+  }
+
+private:
+  static inline int get_block_idx(const int tile_col, const int tile_row) {
+    return (tile_row / MapT::TowerTileHeight) * BLOCKS_WIDE +
+           (tile_col / MapT::TowerTileWidth);
+  }
+
+  // NOTE: the graph is tiny (a few dozen blocks), so recursing is fine
+  void visit_block(const int block_idx) {
+    disc_time[block_idx] = dfs_time++;
+    low_time[block_idx] = disc_time[block_idx];
+
+    const int block_col = block_idx % BLOCKS_WIDE;
+    const int block_row = block_idx / BLOCKS_WIDE;
+    const std::array<std::array<int, 2>, 4> neighbors{
+        {{{block_col, block_row - 1}},
+         {{block_col - 1, block_row}},
+         {{block_col + 1, block_row}},
+         {{block_col, block_row + 1}}}};
+
+    for (const auto &neighbor : neighbors) {
+      if (neighbor[0] < 0 || neighbor[0] >= BLOCKS_WIDE || neighbor[1] < 0 ||
+          neighbor[1] >= BLOCKS_HIGH) {
+        continue;
+      }
+      const int neighbor_idx = neighbor[1] * BLOCKS_WIDE + neighbor[0];
+      if (!free_blocks[neighbor_idx]) {
+        continue;
+      }
+
+      if (disc_time[neighbor_idx] == UNVISITED) {
+        visit_block(neighbor_idx);
+        low_time[block_idx] =
+            std::min(low_time[block_idx], low_time[neighbor_idx]);
+
+        // the child's subtree has no way around this block -- if the spawn is
+        // in that subtree, then this block is on every path
+        if (low_time[neighbor_idx] >= disc_time[block_idx] &&
+            in_subtree(spawn_block, neighbor_idx)) {
+          cut_blocks[block_idx] = true;
+        }
+      } else {
+        low_time[block_idx] =
+            std::min(low_time[block_idx], disc_time[neighbor_idx]);
+      }
+    }
+
+    // the last discovery time within this block's subtree
+    subtree_end[block_idx] = dfs_time;
+  }
+
+  // NOTE: only valid for a block whose subtree has been fully visited
+  inline bool in_subtree(const int block_idx, const int root_idx) const {
+    return disc_time[block_idx] != UNVISITED &&
+           disc_time[block_idx] >= disc_time[root_idx] &&
+           disc_time[block_idx] < subtree_end[root_idx];
+  }
+
+  std::array<bool, NUM_BLOCKS> free_blocks;
+  std::array<bool, NUM_BLOCKS> cut_blocks;
+
+  // the DFS state
+  std::array<int, NUM_BLOCKS> disc_time;
+  std::array<int, NUM_BLOCKS> low_time;
+  std::array<int, NUM_BLOCKS> subtree_end;
+  int dfs_time;
+
+  int spawn_block;
+  int dest_block;
+  bool connected;
+};
+
+#endif
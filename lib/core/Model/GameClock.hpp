@@ -0,0 +1,54 @@
+/* GameClock.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_GAME_CLOCK_HPP
+#define TD_GAME_CLOCK_HPP
+
+#include <chrono>
+#include <thread>
+
+/*
+ * The gameloop's notion of time. The gameloop only ever asks the clock what
+ * time it is and to wait until the next tick is due, so the pacing policy can
+ * be swapped out -- the realtime clock paces the game against the wall clock,
+ * while the virtual clock just jumps ahead by however long it was asked to
+ * wait. The latter is what lets a headless game run its ticks back-to-back
+ */
+struct GameClock {
+  using clock_type = std::chrono::high_resolution_clock;
+  using time_pt = std::chrono::time_point<clock_type>;
+
+  virtual ~GameClock() {}
+
+  virtual time_pt now() const = 0;
+  virtual void wait_for(const std::chrono::milliseconds duration) = 0;
+};
+
+struct RealtimeClock : GameClock {
+  time_pt now() const override { return clock_type::now(); }
+
+  void wait_for(const std::chrono::milliseconds duration) override {
+    std::this_thread::sleep_for(duration);
+  }
+};
+
+struct VirtualClock : GameClock {
+  VirtualClock() : current_time() {}
+
+  time_pt now() const override { return current_time; }
+
+  // nothing to wait on, time just moves forward
+  void wait_for(const std::chrono::milliseconds duration) override {
+    current_time += duration;
+  }
+
+private:
+  time_pt current_time;
+};
+
+#endif
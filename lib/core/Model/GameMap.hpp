@@ -10,8 +10,8 @@
 #define TD_GAME_MAP_HPP
 
 #include "MapTile.hpp"
-#include "Monster.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 
@@ -92,6 +92,15 @@ public:
     return IndexCoordinate(tile_col, tile_row);
   }
 
+  // same as the above, but out of bounds locations are clamped to the closest
+  // tile on the map edge
+  IndexCoordinate get_nearest_tile(const Coordinate<float> &location) const {
+    const int tile_row = std::floor(location.row / tile_height);
+    const int tile_col = std::floor(location.col / tile_width);
+    return IndexCoordinate(std::min(std::max(tile_col, 0), MAP_WIDTH - 1),
+                           std::min(std::max(tile_row, 0), MAP_HEIGHT - 1));
+  }
+
   TowerCoordinate get_tower_block(const float col_location,
                                   const float row_location) const {
     // check boundary
@@ -162,57 +171,6 @@ public:
                               tile_height * block_center_row);
   }
 
-  template <typename MobID>
-  void remove_mob(Coordinate<float> tile_coord, const MobID &mob_id) {
-    auto tile_idx = get_bounding_tile(tile_coord);
-    auto target_tile = get_tile(tile_idx);
-
-    auto mob_it = std::find_if(target_tile->resident_mobs.begin(),
-                               target_tile->resident_mobs.end(),
-                               [mob_id](const std::weak_ptr<Monster> &m) {
-                                 // TODO: we might want to use different
-                                 // comparison schemes for identifying a mob
-                                 // (comparing strings is slower than say, ints)
-                                 // will want to move this kind of thing into
-                                 // the Monster class itself
-                                 if (auto target_mob = m.lock()) {
-                                   auto target_name = target_mob->get_name();
-                                   return target_name == mob_id;
-                                 }
-                                 return false;
-                               });
-
-    if (mob_it != target_tile->resident_mobs.end()) {
-      if (auto target_mob = mob_it->lock()) {
-        std::cout << "removing mob " << target_mob->get_name() << " from tile ("
-                  << tile_idx.col << ", " << tile_idx.row << ")" << std::endl;
-      }
-      target_tile->resident_mobs.erase(mob_it);
-
-      std::cout << "Target tile @(" << tile_idx.col << ", " << tile_idx.row
-                << ")"
-                << " has " << target_tile->resident_mobs.size() << " #mobs left"
-                << std::endl;
-    } else {
-      std::cout << "Mob isn't in tile" << std::endl;
-    }
-
-    /*
-    std::remove_if(target_tile->resident_mobs.begin(),
-    target_tile->resident_mobs.end(), [mob_id](const std::weak_ptr<Monster> &m)
-      {
-        //TODO: we might want to use different comparison schemes for
-    identifying a mob (comparing strings is slower than say, ints)
-        //will want to move this kind of thing into the Monster class itself
-        if (auto target_mob = m.lock()) {
-          auto target_name = target_mob->get_name();
-          return target_name == mob_id;
-        }
-        return false;
-      });
-    */
-  }
-
   // would likely have other helper functions --
   // TODO: think of some other helper functions
   // ...
@@ -0,0 +1,375 @@
+/* GameSnapshot.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_GAME_SNAPSHOT_HPP
+#define TD_GAME_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * The binary game state snapshot. The snapshot is 1 contiguous buffer: a fixed
+ * size header, followed by 1 section per entity type. Each section is a packed
+ * array of fixed size records, and the header says where each section starts
+ * and how many records it has -- so everything can be read in place (straight
+ * out of a mmap'd file, or a python bytes object) without any parsing.
+ *
+ * NOTE: the fields are in the host's byte order, and the sections are 8-byte
+ * aligned wrt the start of the buffer. The mob / tower names are the
+ * NameRegistry IDs, same as in the render events
+ *
+ * Bump SNAPSHOT_VERSION whenever any of the records change
+ */
+namespace Snapshot {
+// "DTDS"
+constexpr uint32_t SNAPSHOT_MAGIC = 0x53445444;
+constexpr uint16_t SNAPSHOT_VERSION = 1;
+constexpr size_t SECTION_ALIGNMENT = 8;
+constexpr uint32_t INVALID_ID = std::numeric_limits<uint32_t>::max();
+constexpr int NUM_ELEM = 5;
+
+struct Section {
+  // in bytes, from the start of the buffer
+  uint32_t offset;
+  // in records (bytes for the map section)
+  uint32_t count;
+};
+
+struct Header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;
+  uint32_t total_size;
+  // the GAME_STATE
+  uint32_t game_state;
+  uint64_t timestamp;
+  int32_t num_lives;
+  int32_t num_essence;
+  int32_t num_gold;
+  uint16_t map_width;
+  uint16_t map_height;
+
+  Section towers;
+  Section mobs;
+  Section attacks;
+  Section items;
+  // the map occupancy, 1 bit per tile. The bits are in row-major order,
+  // starting from the low bit of each byte
+  Section map;
+};
+
+struct Tower {
+  uint32_t id;
+  uint32_t name_id;
+  // the tower's slot in the tower grid
+  uint16_t slot_row;
+  uint16_t slot_col;
+  int32_t tier;
+  float col;
+  float row;
+  uint32_t num_kills;
+  uint32_t num_attacks;
+
+  // the base attributes (i.e. without any temporary modifiers)
+  float damage_low[NUM_ELEM];
+  float damage_high[NUM_ELEM];
+  float enhanced_damage[NUM_ELEM];
+  float enhanced_damage_affinity[NUM_ELEM];
+  float added_damage[NUM_ELEM];
+  float armor_pierce_damage;
+  float enhanced_speed;
+  float attack_speed;
+  float attack_range;
+  float crit_chance;
+  float crit_multiplier;
+  uint32_t padding;
+};
+
+struct Mob {
+  uint32_t name_id;
+  uint32_t model_id;
+  float col;
+  float row;
+  float dest_col;
+  float dest_row;
+  float speed;
+  float health;
+  float flat_armor;
+  float percent_armor;
+  float thresh_armor;
+  // the Elements
+  uint32_t armor_class;
+};
+
+struct Attack {
+  uint32_t id;
+  // the slot of the tower that made the attack
+  uint16_t origin_row;
+  uint16_t origin_col;
+  float col;
+  float row;
+  float target_col;
+  float target_row;
+  float move_speed;
+  // the targeted mob's name ID, or INVALID_ID if it's no longer around (or
+  // the attack isn't homing)
+  uint32_t target_name_id;
+  uint32_t is_homing;
+  uint32_t padding;
+};
+
+struct Item {
+  static constexpr size_t MAX_LETTER_LEN = 11;
+
+  uint32_t slot;
+  // NUL-terminated, truncated to MAX_LETTER_LEN
+  char letter[MAX_LETTER_LEN + 1];
+};
+
+// the records get read in place, so they have to stay plain old data (and
+// their sizes are part of the format)
+static_assert(std::is_trivially_copyable<Header>::value &&
+                  std::is_standard_layout<Header>::value && sizeof(Header) == 80,
+              "snapshot header layout changed");
+static_assert(std::is_trivially_copyable<Tower>::value &&
+                  sizeof(Tower) == 160,
+              "snapshot tower layout changed");
+static_assert(std::is_trivially_copyable<Mob>::value && sizeof(Mob) == 48,
+              "snapshot mob layout changed");
+static_assert(std::is_trivially_copyable<Attack>::value &&
+                  sizeof(Attack) == 40,
+              "snapshot attack layout changed");
+static_assert(std::is_trivially_copyable<Item>::value && sizeof(Item) == 16,
+              "snapshot item layout changed");
+
+inline size_t align_section(const size_t num_bytes) {
+  return (num_bytes + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+/*
+ * Lays out a snapshot with the given #records in the buffer. The buffer is
+ * resized to fit (so re-using the same buffer every tick doesn't need to
+ * allocate) and zeroed, and the header's size and section fields are filled
+ * in -- the rest is up to the caller
+ */
+inline Header *layout_snapshot(std::vector<uint8_t> &buffer,
+                               const size_t num_towers, const size_t num_mobs,
+                               const size_t num_attacks, const size_t num_items,
+                               const int map_width, const int map_height) {
+  const size_t num_map_bytes = (map_width * map_height + 7) / 8;
+  size_t total_size = align_section(sizeof(Header));
+
+  auto make_section = [&total_size](const size_t count, const size_t elem_sz) {
+    Section section;
+    section.offset = static_cast<uint32_t>(total_size);
+    section.count = static_cast<uint32_t>(count);
+    total_size += align_section(count * elem_sz);
+    return section;
+  };
+  const Section towers = make_section(num_towers, sizeof(Tower));
+  const Section mobs = make_section(num_mobs, sizeof(Mob));
+  const Section attacks = make_section(num_attacks, sizeof(Attack));
+  const Section items = make_section(num_items, sizeof(Item));
+  const Section map = make_section(num_map_bytes, 1);
+  if (total_size > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Snapshot too large (" +
+                             std::to_string(total_size) + " bytes)");
+  }
+
+  buffer.resize(total_size);
+  std::memset(buffer.data(), 0, buffer.size());
+
+  Header *header = reinterpret_cast<Header *>(buffer.data());
+  header->magic = SNAPSHOT_MAGIC;
+  header->version = SNAPSHOT_VERSION;
+  header->header_size = sizeof(Header);
+  header->total_size = static_cast<uint32_t>(total_size);
+  header->map_width = static_cast<uint16_t>(map_width);
+  header->map_height = static_cast<uint16_t>(map_height);
+  header->towers = towers;
+  header->mobs = mobs;
+  header->attacks = attacks;
+  header->items = items;
+  header->map = map;
+  return header;
+}
+
+template <typename RecordT>
+inline RecordT *get_section(std::vector<uint8_t> &buffer,
+                            const Section &section) {
+  return reinterpret_cast<RecordT *>(buffer.data() + section.offset);
+}
+
+/*
+ * Read-only, zero-copy access to a snapshot buffer. The view doesn't own the
+ * buffer, which has to outlive it
+ */
+class SnapshotView {
+public:
+  // throws if the buffer doesn't hold a (complete) snapshot of this version
+  SnapshotView(const uint8_t *data, const size_t num_bytes) : data(data) {
+    if (num_bytes < sizeof(Header)) {
+      throw std::runtime_error("Snapshot too small (" +
+                               std::to_string(num_bytes) + " bytes)");
+    }
+    if (reinterpret_cast<uintptr_t>(data) % SECTION_ALIGNMENT != 0) {
+      throw std::runtime_error("Snapshot buffer is misaligned");
+    }
+
+    const Header &hdr = header();
+    if (hdr.magic != SNAPSHOT_MAGIC) {
+      throw std::runtime_error("Not a snapshot (bad magic)");
+    }
+    if (hdr.version != SNAPSHOT_VERSION || hdr.header_size != sizeof(Header)) {
+      throw std::runtime_error("Unsupported snapshot version " +
+                               std::to_string(hdr.version));
+    }
+    if (hdr.total_size > num_bytes) {
+      throw std::runtime_error("Snapshot truncated (" +
+                               std::to_string(num_bytes) + " of " +
+                               std::to_string(hdr.total_size) + " bytes)");
+    }
+
+    check_section(hdr.towers, sizeof(Tower));
+    check_section(hdr.mobs, sizeof(Mob));
+    check_section(hdr.attacks, sizeof(Attack));
+    check_section(hdr.items, sizeof(Item));
+    check_section(hdr.map, 1);
+    if (static_cast<size_t>(hdr.map.count) * 8 <
+        static_cast<size_t>(hdr.map_width) * hdr.map_height) {
+      throw std::runtime_error("Snapshot map section too small");
+    }
+  }
+
+  inline const Header &header() const {
+    return *reinterpret_cast<const Header *>(data);
+  }
+
+  inline uint64_t get_timestamp() const { return header().timestamp; }
+
+  inline size_t num_towers() const { return header().towers.count; }
+  inline const Tower *towers() const {
+    return get_records<Tower>(header().towers);
+  }
+
+  inline size_t num_mobs() const { return header().mobs.count; }
+  inline const Mob *mobs() const { return get_records<Mob>(header().mobs); }
+
+  inline size_t num_attacks() const { return header().attacks.count; }
+  inline const Attack *attacks() const {
+    return get_records<Attack>(header().attacks);
+  }
+
+  inline size_t num_items() const { return header().items.count; }
+  inline const Item *items() const { return get_records<Item>(header().items); }
+
+  bool is_obstructed(const int col, const int row) const {
+    const Header &hdr = header();
+    if (col < 0 || row < 0 || col >= hdr.map_width || row >= hdr.map_height) {
+      throw std::logic_error("Snapshot map index [" + std::to_string(col) +
+                             ", " + std::to_string(row) + "] out of bounds");
+    }
+    const size_t tile_idx = static_cast<size_t>(row) * hdr.map_width + col;
+    return (data[hdr.map.offset + tile_idx / 8] >> (tile_idx % 8)) & 1;
+  }
+
+private:
+  void check_section(const Section &section, const size_t elem_sz) const {
+    const size_t section_end =
+        static_cast<size_t>(section.offset) + section.count * elem_sz;
+    if (section.offset % SECTION_ALIGNMENT != 0 ||
+        section.offset < sizeof(Header) ||
+        section_end > header().total_size) {
+      throw std::runtime_error("Snapshot section out of bounds");
+    }
+  }
+
+  template <typename RecordT>
+  inline const RecordT *get_records(const Section &section) const {
+    return reinterpret_cast<const RecordT *>(data + section.offset);
+  }
+
+  const uint8_t *data;
+};
+
+inline void save_snapshot(const std::string &file_path,
+                          const std::vector<uint8_t> &buffer) {
+  std::ofstream snapshot_file(file_path, std::ios::binary | std::ios::trunc);
+  snapshot_file.write(reinterpret_cast<const char *>(buffer.data()),
+                      buffer.size());
+  if (!snapshot_file) {
+    throw std::runtime_error("Failed to write snapshot to " + file_path);
+  }
+}
+
+/*
+ * A snapshot file, mmap'd read-only s.t. it can be read in place
+ */
+class MappedSnapshot {
+public:
+  explicit MappedSnapshot(const std::string &file_path)
+      : mapped_data(nullptr), mapped_size(0) {
+    const int snapshot_fd = ::open(file_path.c_str(), O_RDONLY);
+    if (snapshot_fd < 0) {
+      throw std::runtime_error("Failed to open snapshot " + file_path);
+    }
+
+    struct stat file_info;
+    if (::fstat(snapshot_fd, &file_info) != 0 || file_info.st_size <= 0) {
+      ::close(snapshot_fd);
+      throw std::runtime_error("Failed to read snapshot " + file_path);
+    }
+    mapped_size = static_cast<size_t>(file_info.st_size);
+    void *file_data =
+        ::mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, snapshot_fd, 0);
+    // NOTE: the mapping stays valid after the file is closed
+    ::close(snapshot_fd);
+    if (file_data == MAP_FAILED) {
+      throw std::runtime_error("Failed to map snapshot " + file_path);
+    }
+    mapped_data = static_cast<const uint8_t *>(file_data);
+
+    try {
+      snapshot_view = std::unique_ptr<SnapshotView>(
+          new SnapshotView(mapped_data, mapped_size));
+    } catch (...) {
+      ::munmap(const_cast<uint8_t *>(mapped_data), mapped_size);
+      throw;
+    }
+  }
+
+  ~MappedSnapshot() {
+    ::munmap(const_cast<uint8_t *>(mapped_data), mapped_size);
+  }
+
+  MappedSnapshot(const MappedSnapshot &) = delete;
+  MappedSnapshot &operator=(const MappedSnapshot &) = delete;
+
+  inline const SnapshotView &view() const { return *snapshot_view; }
+
+private:
+  const uint8_t *mapped_data;
+  size_t mapped_size;
+  std::unique_ptr<SnapshotView> snapshot_view;
+};
+} // namespace Snapshot
+
+#endif
@@ -11,12 +11,8 @@
 
 #include "util/Types.hpp"
 
-#include <list>
-#include <memory>
 #include <tuple>
 
-class Monster;
-
 struct MapTile {
   MapTile()
       : idx_location(), tile_coord(), width(0), height(0), tile_center(),
@@ -30,7 +26,6 @@ struct MapTile {
 
   Coordinate<double> tile_center;
 
-  mutable std::list<std::weak_ptr<Monster>> resident_mobs;
   bool occupied;
 };
 
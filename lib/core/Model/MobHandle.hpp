@@ -0,0 +1,39 @@
+/* MobHandle.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_MOB_HANDLE_HPP
+#define TD_MOB_HANDLE_HPP
+
+#include <cstdint>
+#include <limits>
+
+// a stable reference to a mob in the MobTable. The table moves mobs around
+// internally whenever one is removed, so anything outside of the table (towers,
+// attacks, map tiles) should hold onto these rather than indices. A handle to a
+// mob that has since been removed will no longer be contained in the table
+struct MobHandle {
+  static constexpr uint32_t INVALID_SLOT = std::numeric_limits<uint32_t>::max();
+
+  MobHandle() : slot(INVALID_SLOT), generation(0) {}
+  MobHandle(const uint32_t slot_idx, const uint32_t gen)
+      : slot(slot_idx), generation(gen) {}
+
+  inline bool is_valid() const { return slot != INVALID_SLOT; }
+
+  inline bool operator==(const MobHandle &other) const {
+    return slot == other.slot && generation == other.generation;
+  }
+  inline bool operator!=(const MobHandle &other) const {
+    return !(*this == other);
+  }
+
+  uint32_t slot;
+  uint32_t generation;
+};
+
+#endif
@@ -0,0 +1,230 @@
+/* MobTable.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_MOB_TABLE_HPP
+#define TD_MOB_TABLE_HPP
+
+#include "MapTile.hpp"
+#include "MobHandle.hpp"
+#include "ModelUtils.hpp"
+#include "util/Elements.hpp"
+#include "util/MonsterProperties.hpp"
+#include "util/Types.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * The live mobs, stored as a structure-of-arrays -- each mob attribute lives in
+ * its own contiguous column, indexed by the mob's (dense) index. The per-tick
+ * loops only touch the columns they need, and removing a mob swaps the last mob
+ * into its place, so the columns stay densely packed. The dense indices are
+ * only valid until the next removal; hold onto a MobHandle for anything longer.
+ */
+class MobTable {
+public:
+  MobTable() {}
+
+  MobHandle add_mob(const CharacterModels::ModelIDs model_id,
+                    const uint32_t mob_id, const MonsterStats &stats,
+                    const Coordinate<float> &position) {
+    // reuse an old slot if we have one
+    uint32_t slot_idx;
+    if (!free_slots.empty()) {
+      slot_idx = free_slots.back();
+      free_slots.pop_back();
+    } else {
+      slot_idx = static_cast<uint32_t>(slots.size());
+      slots.emplace_back();
+    }
+
+    const uint32_t mob_idx = static_cast<uint32_t>(size());
+    slots[slot_idx].dense_idx = mob_idx;
+
+    pos_col.push_back(position.col);
+    pos_row.push_back(position.row);
+    // mobs stay put until they are given a destination
+    dest_col.push_back(position.col);
+    dest_row.push_back(position.row);
+    speed.push_back(stats.speed);
+    health.push_back(stats.health);
+    flat_armor.push_back(stats.flat_armor);
+    percent_armor.push_back(stats.percent_armor);
+    thresh_armor.push_back(stats.thresh_armor);
+    armor_class.push_back(stats.armor_class);
+    dest_tiles.push_back(nullptr);
+    path_changed.push_back(true);
+
+    ids.push_back(mob_id);
+    model_ids.push_back(model_id);
+    dense_slots.push_back(slot_idx);
+
+    return MobHandle(slot_idx, slots[slot_idx].generation);
+  }
+
+  inline bool contains(const MobHandle mob) const {
+    return mob.slot < slots.size() &&
+           slots[mob.slot].generation == mob.generation &&
+           slots[mob.slot].dense_idx != MobHandle::INVALID_SLOT;
+  }
+
+  // NOTE: assumes that the mob is contained in the table
+  inline uint32_t index_of(const MobHandle mob) const {
+    return slots[mob.slot].dense_idx;
+  }
+
+  inline MobHandle handle_of(const uint32_t mob_idx) const {
+    const uint32_t slot_idx = dense_slots[mob_idx];
+    return MobHandle(slot_idx, slots[slot_idx].generation);
+  }
+
+  // swap-removes the mob; any outstanding handles to it are invalidated
+  void remove(const MobHandle mob) {
+    if (!contains(mob)) {
+      return;
+    }
+
+    const uint32_t mob_idx = index_of(mob);
+    const uint32_t last_idx = static_cast<uint32_t>(size() - 1);
+    if (mob_idx != last_idx) {
+      move_mob(last_idx, mob_idx);
+      slots[dense_slots[mob_idx]].dense_idx = mob_idx;
+    }
+    pop_back();
+
+    slots[mob.slot].dense_idx = MobHandle::INVALID_SLOT;
+    slots[mob.slot].generation++;
+    free_slots.push_back(mob.slot);
+  }
+
+  void clear() {
+    while (!empty()) {
+      remove(handle_of(static_cast<uint32_t>(size() - 1)));
+    }
+  }
+
+  inline size_t size() const { return dense_slots.size(); }
+  inline bool empty() const { return dense_slots.empty(); }
+
+  inline Coordinate<float> get_position(const uint32_t mob_idx) const {
+    return Coordinate<float>(pos_col[mob_idx], pos_row[mob_idx]);
+  }
+
+  inline MonsterStats get_stats(const uint32_t mob_idx) const {
+    return MonsterStats(health[mob_idx], speed[mob_idx], armor_class[mob_idx],
+                        flat_armor[mob_idx], percent_armor[mob_idx],
+                        thresh_armor[mob_idx]);
+  }
+
+  inline bool is_alive(const uint32_t mob_idx) const {
+    return health[mob_idx] > 0;
+  }
+
+  // returns whether the mob survived
+  inline bool recieve_damage(const uint32_t mob_idx, const float atk_dmg) {
+    health[mob_idx] -= atk_dmg;
+    return is_alive(mob_idx);
+  }
+
+  // the mob heads for the center of the tile. NOTE: we don't keep any paths
+  // for the mobs, they just get their next tile from the pathfinder's flow
+  // field whenever they reach a tile center
+  inline void set_destination(const uint32_t mob_idx, const MapTile *tile) {
+    dest_tiles[mob_idx] = tile;
+    dest_col[mob_idx] = tile->tile_center.col;
+    dest_row[mob_idx] = tile->tile_center.row;
+  }
+
+  //------------------------------------------------------------------------
+  // the hot columns, touched every tick
+
+  // normalized positions wrt the map
+  std::vector<float> pos_col;
+  std::vector<float> pos_row;
+  // the position the mob is currently heading towards
+  std::vector<float> dest_col;
+  std::vector<float> dest_row;
+  std::vector<float> speed;
+  std::vector<float> health;
+  std::vector<float> flat_armor;
+  std::vector<float> percent_armor;
+  std::vector<float> thresh_armor;
+  std::vector<Elements> armor_class;
+
+  //------------------------------------------------------------------------
+  // the cold columns, only touched on waypoints / creation / removal
+
+  // the tile the mob is currently heading towards (nullptr if it has none).
+  // NOTE: we don't 'own' these, the game map owns these, we just have pointers
+  // to them (and we know that the game map will outlive any mobs)
+  std::vector<const MapTile *> dest_tiles;
+  // the (interned) mob names, see NameRegistry
+  std::vector<uint32_t> ids;
+  // whether the frontend needs to be sent the mob's path again (i.e. it's a
+  // new mob, or the map changed). NOTE: uint8_t rather than bool, to avoid
+  // the vector<bool> specialization
+  std::vector<uint8_t> path_changed;
+  std::vector<CharacterModels::ModelIDs> model_ids;
+
+private:
+  struct slot_entry {
+    slot_entry() : dense_idx(MobHandle::INVALID_SLOT), generation(0) {}
+
+    uint32_t dense_idx;
+    uint32_t generation;
+  };
+
+  template <typename ColumnT>
+  static inline void move_element(ColumnT &column, const uint32_t src_idx,
+                                  const uint32_t dst_idx) {
+    column[dst_idx] = std::move(column[src_idx]);
+  }
+
+  void move_mob(const uint32_t src_idx, const uint32_t dst_idx) {
+    move_element(pos_col, src_idx, dst_idx);
+    move_element(pos_row, src_idx, dst_idx);
+    move_element(dest_col, src_idx, dst_idx);
+    move_element(dest_row, src_idx, dst_idx);
+    move_element(speed, src_idx, dst_idx);
+    move_element(health, src_idx, dst_idx);
+    move_element(flat_armor, src_idx, dst_idx);
+    move_element(percent_armor, src_idx, dst_idx);
+    move_element(thresh_armor, src_idx, dst_idx);
+    move_element(armor_class, src_idx, dst_idx);
+    move_element(dest_tiles, src_idx, dst_idx);
+    move_element(path_changed, src_idx, dst_idx);
+    move_element(ids, src_idx, dst_idx);
+    move_element(model_ids, src_idx, dst_idx);
+    move_element(dense_slots, src_idx, dst_idx);
+  }
+
+  void pop_back() {
+    pos_col.pop_back();
+    pos_row.pop_back();
+    dest_col.pop_back();
+    dest_row.pop_back();
+    speed.pop_back();
+    health.pop_back();
+    flat_armor.pop_back();
+    percent_armor.pop_back();
+    thresh_armor.pop_back();
+    armor_class.pop_back();
+    dest_tiles.pop_back();
+    path_changed.pop_back();
+    ids.pop_back();
+    model_ids.pop_back();
+    dense_slots.pop_back();
+  }
+
+  // dense index --> slot, and slot --> dense index (+ generation)
+  std::vector<uint32_t> dense_slots;
+  std::vector<slot_entry> slots;
+  std::vector<uint32_t> free_slots;
+};
+
+#endif
@@ -11,16 +11,27 @@
 
 #include <algorithm>
 #include <array>
+#include <functional>
 #include <limits>
 #include <list>
 #include <queue>
+#include <utility>
+#include <vector>
 
-// does a BFS on the map, finds the costs of traversal for any given point to
-// the destination Then from this we can find the optimal path for any of the
-// mobs
+// does a BFS on the map, outwards from the destination, to get the traversal
+// cost from any given point to the destination. This gives a flow field over
+// the whole map -- every reachable tile points to its neighbor that is 1 step
+// closer to the destination, so any mob on any tile can just follow the field
+// rather than needing its own path
+//
+// The flow field is kept up to date incrementally as the map changes -- when a
+// tower block is obstructed, only the tiles whose path ran through the block
+// get recomputed, and when a block is cleared, only the tiles that get closer
+// to the destination are updated
 template <typename MapT> class Pathfinder {
   using map_tile_t = typename MapT::MapTileT;
   using index_coord_t = typename MapT::IndexCoordinate;
+  using region_coord_t = typename MapT::TowerCoordinate;
 
   static constexpr int GRID_WIDTH = MapT::MAP_WIDTH;
   static constexpr int GRID_HEIGHT = MapT::MAP_HEIGHT;
@@ -29,39 +40,27 @@ template <typename MapT> class Pathfinder {
   static const index_coord_t four_neighbor[4];
 
 public:
-  Pathfinder() : dest(nullptr) {}
+  static constexpr int UNREACHABLE = std::numeric_limits<int>::max();
 
-  // returns true if path exists to the dest, false if no path exists
+  Pathfinder() : dest(nullptr) { reset_state(); }
+
+  // returns true if path exists from the spawn to the dest, false if no path
+  // exists
   template <size_t CONN = 4>
   bool operator()(const MapT &gmap, const index_coord_t spawn_tile,
                   const index_coord_t dest_tile) {
     reset_state();
 
-    const map_tile_t *spawn = gmap.get_tile(spawn_tile);
+    dest = gmap.get_tile(dest_tile);
     std::queue<const map_tile_t *> tile_frontier;
-    tile_frontier.push(spawn);
-
-    visited_tiles[spawn_tile.row * GRID_WIDTH + spawn_tile.col] = true;
-    distance_tiles[spawn_tile.row * GRID_WIDTH + spawn_tile.col] = 0;
+    tile_frontier.push(dest);
+    distance_tiles[get_flat_idx(dest)] = 0;
 
-    // TODO: figure out how best to determine if a path exists to the dest -- is
-    // it enough to check if the dest tile's visited_tile flag is set?
-    bool is_valid_path = false;
-    const int dest_idx = dest_tile.row * GRID_WIDTH + dest_tile.col;
-
-    int visit_count = 0;
-    // std::map<map_tile_t, bool> visited_tiles = {{spawn, true}};
     while (!tile_frontier.empty()) {
       auto current_tile = tile_frontier.front();
       tile_frontier.pop();
 
-      const int flat_tile_idx = current_tile->idx_location.row * GRID_WIDTH +
-                                current_tile->idx_location.col;
-      // check if the current tile is the destination tile
-      if (dest_idx == flat_tile_idx) {
-        // TODO: do we want to exit the BFS if we are at the dest?
-        is_valid_path = true;
-      }
+      const int flat_tile_idx = get_flat_idx(current_tile);
       // NOTE: do we want 4-neighbor or 8-neighbor? For now, just do 4 neighbor?
       const int row_idx = current_tile->idx_location.row;
       const int col_idx = current_tile->idx_location.col;
@@ -74,21 +73,16 @@ public:
         if (neighbor_row >= 0 && neighbor_row < GRID_HEIGHT) {
           if (neighbor_col >= 0 && neighbor_col < GRID_WIDTH) {
             if (!gmap.is_obstructed(neighbor_col, neighbor_row)) {
-              auto neighbor_tile = gmap.get_tile(neighbor_col, neighbor_row);
               const int flat_neighbor_idx =
                   neighbor_row * GRID_WIDTH + neighbor_col;
-              if (!visited_tiles[flat_neighbor_idx]) {
-                tile_frontier.push(neighbor_tile);
-                // keep track of the path that's been used to get to the current
-                // point
-                path_tiles[flat_neighbor_idx] = current_tile;
-                //... also keep track of the distance of the tile wrt the spawn
-                // point
+              if (distance_tiles[flat_neighbor_idx] == UNREACHABLE) {
+                tile_frontier.push(gmap.get_tile(neighbor_col, neighbor_row));
+                // the neighbor moves towards the destination via the current
+                // tile...
+                flow_tiles[flat_neighbor_idx] = current_tile;
+                //... and is 1 step further from the destination than it
                 distance_tiles[flat_neighbor_idx] =
                     distance_tiles[flat_tile_idx] + 1;
-
-                visited_tiles[flat_neighbor_idx] = true;
-                visit_count++;
               }
             }
           }
@@ -96,55 +90,215 @@ public:
       }
     }
 
-    if (is_valid_path) {
-      dest = gmap.get_tile(dest_tile);
+    return distance_tiles[spawn_tile.row * GRID_WIDTH + spawn_tile.col] !=
+           UNREACHABLE;
+  }
+
+  // updates the flow field after the region (i.e. a tower block) was
+  // obstructed on the map. NOTE: blocking tiles can only make the distances
+  // longer, and only for the tiles whose path went through the region
+  template <size_t CONN = 4>
+  void obstruct_region(const MapT &gmap, const region_coord_t &region) {
+    // nothing to repair if we haven't computed the field yet
+    if (dest == nullptr) {
+      return;
+    }
+
+    affected_tiles.clear();
+    for_each_region_tile(region, [this](const int flat_idx) {
+      if (distance_tiles[flat_idx] != UNREACHABLE) {
+        invalidate_tile(flat_idx);
+      }
+    });
+
+    // the tiles that flowed through the region (directly or indirectly) are
+    // the ones that lost their path -- they form a subtree of the flow field
+    for (size_t affected_idx = 0; affected_idx < affected_tiles.size();
+         ++affected_idx) {
+      const int flat_idx = affected_tiles[affected_idx];
+      const map_tile_t *tile = gmap.get_tile(flat_idx % GRID_WIDTH,
+                                             flat_idx / GRID_WIDTH);
+      for_each_neighbor<CONN>(flat_idx, [this, tile](const int neighbor_idx) {
+        if (flow_tiles[neighbor_idx] == tile) {
+          invalidate_tile(neighbor_idx);
+        }
+      });
+    }
+
+    // re-attach the subtree to the rest of the field via the tiles bordering
+    // it, then let the distances propagate through it
+    for (const int flat_idx : affected_tiles) {
+      seed_tile<CONN>(gmap, flat_idx);
     }
-    return is_valid_path;
+    propagate<CONN>(gmap);
+  }
+
+  // updates the flow field after the region was cleared (i.e. the tower was
+  // removed). NOTE: clearing tiles can only make the distances shorter
+  template <size_t CONN = 4>
+  void clear_region(const MapT &gmap, const region_coord_t &region) {
+    if (dest == nullptr) {
+      return;
+    }
+
+    for_each_region_tile(region, [this, &gmap](const int flat_idx) {
+      seed_tile<CONN>(gmap, flat_idx);
+    });
+    propagate<CONN>(gmap);
+  }
+
+  inline const map_tile_t *get_destination() const { return dest; }
+
+  // the next tile to move to from the source tile -- is nullptr if the source
+  // is the destination or if the destination can't be reached from it
+  inline const map_tile_t *get_next_tile(const map_tile_t *source_tile) const {
+    return flow_tiles[get_flat_idx(source_tile)];
+  }
+
+  // #steps from the source tile to the destination
+  inline int get_distance(const map_tile_t *source_tile) const {
+    return distance_tiles[get_flat_idx(source_tile)];
   }
 
-  // TODO: give some accessor to get the path from any given point to the
-  // destination -- might need to re-arrange the path_tiles datastructure to
-  // make this a bit easier? -- what should we return it as? a vector, or a
-  // list?
-
-  // makes the path list from the specified source tile to the dest tile
-  // NOTE: this function has some (hidden) dependancy on the above function --
-  // that is, if there is NO valid path, then this function will not have
-  // anything to return other than the source tile. Not really much to do about
-  // this, we rely on the caller to take the appropriate measures if no valid
-  // path exists
-  std::list<const map_tile_t *> get_path(const map_tile_t *source_tile) {
+  inline bool is_reachable(const map_tile_t *source_tile) const {
+    return get_distance(source_tile) != UNREACHABLE;
+  }
+
+  // makes the path list from the specified source tile to the dest tile (both
+  // inclusive) by following the flow field. If there is no valid path, then
+  // this will have nothing other than the source tile
+  std::list<const map_tile_t *> get_path(const map_tile_t *source_tile) const {
     std::list<const map_tile_t *> path;
     // NOTE: add the current tile so that the mob knows its starting point
-    path.push_front(source_tile);
-
-    auto path_node = path_tiles[source_tile->idx_location.row * GRID_WIDTH +
-                                source_tile->idx_location.col];
-    while (path_node && path_node != dest) {
-      // path.push_back(path_node);
-      path.push_front(path_node);
-      // get the index of the node
-      const int path_nodeidx = path_node->idx_location.row * GRID_WIDTH +
-                               path_node->idx_location.col;
-      path_node = path_tiles[path_nodeidx];
+    path.push_back(source_tile);
+
+    auto path_node = get_next_tile(source_tile);
+    while (path_node) {
+      path.push_back(path_node);
+      path_node = get_next_tile(path_node);
     }
 
     return path;
   }
 
 private:
+  static inline int get_flat_idx(const map_tile_t *tile) {
+    return tile->idx_location.row * GRID_WIDTH + tile->idx_location.col;
+  }
+
+  template <typename TileFn>
+  static void for_each_region_tile(const region_coord_t &region,
+                                   TileFn tile_fn) {
+    for (int row = std::get<0>(region.row); row < std::get<1>(region.row);
+         ++row) {
+      for (int col = std::get<0>(region.col); col < std::get<1>(region.col);
+           ++col) {
+        tile_fn(row * GRID_WIDTH + col);
+      }
+    }
+  }
+
+  template <size_t CONN, typename NeighborFn>
+  static void for_each_neighbor(const int flat_idx, NeighborFn neighbor_fn) {
+    const int row_idx = flat_idx / GRID_WIDTH;
+    const int col_idx = flat_idx % GRID_WIDTH;
+    for (size_t neighbor_idx = 0; neighbor_idx < CONN; ++neighbor_idx) {
+      const int neighbor_row = row_idx + four_neighbor[neighbor_idx].row;
+      const int neighbor_col = col_idx + four_neighbor[neighbor_idx].col;
+      if (neighbor_row >= 0 && neighbor_row < GRID_HEIGHT &&
+          neighbor_col >= 0 && neighbor_col < GRID_WIDTH) {
+        neighbor_fn(neighbor_row * GRID_WIDTH + neighbor_col);
+      }
+    }
+  }
+
+  inline void invalidate_tile(const int flat_idx) {
+    distance_tiles[flat_idx] = UNREACHABLE;
+    flow_tiles[flat_idx] = nullptr;
+    affected_tiles.push_back(flat_idx);
+  }
+
+  // points the (unobstructed) tile at its closest neighbor, if that's closer
+  // than what the tile has, and queues it up for propagating to its neighbors
+  template <size_t CONN> void seed_tile(const MapT &gmap, const int flat_idx) {
+    const map_tile_t *tile =
+        gmap.get_tile(flat_idx % GRID_WIDTH, flat_idx / GRID_WIDTH);
+    if (gmap.is_obstructed(tile->idx_location.col, tile->idx_location.row)) {
+      return;
+    }
+
+    if (tile == dest) {
+      distance_tiles[flat_idx] = 0;
+      flow_tiles[flat_idx] = nullptr;
+    } else {
+      for_each_neighbor<CONN>(flat_idx, [this, flat_idx,
+                                         &gmap](const int neighbor_idx) {
+        if (distance_tiles[neighbor_idx] != UNREACHABLE &&
+            distance_tiles[neighbor_idx] + 1 < distance_tiles[flat_idx]) {
+          distance_tiles[flat_idx] = distance_tiles[neighbor_idx] + 1;
+          flow_tiles[flat_idx] = gmap.get_tile(neighbor_idx % GRID_WIDTH,
+                                               neighbor_idx / GRID_WIDTH);
+        }
+      });
+    }
+
+    if (distance_tiles[flat_idx] != UNREACHABLE) {
+      repair_frontier.emplace_back(distance_tiles[flat_idx], flat_idx);
+      std::push_heap(repair_frontier.begin(), repair_frontier.end(),
+                     std::greater<frontier_entry>());
+    }
+  }
+
+  // relaxes the distances outwards from the seeded tiles, closest first. Since
+  // the rest of the field is already correct, this only spreads as far as the
+  // distances actually change
+  template <size_t CONN> void propagate(const MapT &gmap) {
+    while (!repair_frontier.empty()) {
+      std::pop_heap(repair_frontier.begin(), repair_frontier.end(),
+                    std::greater<frontier_entry>());
+      const frontier_entry current = repair_frontier.back();
+      repair_frontier.pop_back();
+
+      const int flat_idx = current.second;
+      // stale entry, the tile got a shorter distance since it was queued
+      if (current.first != distance_tiles[flat_idx]) {
+        continue;
+      }
+
+      const map_tile_t *tile =
+          gmap.get_tile(flat_idx % GRID_WIDTH, flat_idx / GRID_WIDTH);
+      const int neighbor_distance = current.first + 1;
+      for_each_neighbor<CONN>(flat_idx, [&](const int neighbor_idx) {
+        const int neighbor_row = neighbor_idx / GRID_WIDTH;
+        const int neighbor_col = neighbor_idx % GRID_WIDTH;
+        if (!gmap.is_obstructed(neighbor_col, neighbor_row) &&
+            neighbor_distance < distance_tiles[neighbor_idx]) {
+          distance_tiles[neighbor_idx] = neighbor_distance;
+          flow_tiles[neighbor_idx] = tile;
+          repair_frontier.emplace_back(neighbor_distance, neighbor_idx);
+          std::push_heap(repair_frontier.begin(), repair_frontier.end(),
+                         std::greater<frontier_entry>());
+        }
+      });
+    }
+  }
+
   inline void reset_state() {
     // initialize/reset the pathing data structures
-    std::fill(visited_tiles.begin(), visited_tiles.end(), false);
-    std::fill(path_tiles.begin(), path_tiles.end(), nullptr);
-    std::fill(distance_tiles.begin(), distance_tiles.end(),
-              std::numeric_limits<int>::max());
+    std::fill(flow_tiles.begin(), flow_tiles.end(), nullptr);
+    std::fill(distance_tiles.begin(), distance_tiles.end(), UNREACHABLE);
   }
 
-  std::array<bool, GRID_HEIGHT * GRID_WIDTH> visited_tiles;
-  std::array<const map_tile_t *, GRID_HEIGHT * GRID_WIDTH> path_tiles;
+  std::array<const map_tile_t *, GRID_HEIGHT * GRID_WIDTH> flow_tiles;
   std::array<int, GRID_HEIGHT * GRID_WIDTH> distance_tiles;
 
+  // scratch space for the incremental updates (kept around to avoid
+  // re-allocating on every update). The frontier is a min-heap of
+  // (distance, tile index)
+  using frontier_entry = std::pair<int, int>;
+  std::vector<int> affected_tiles;
+  std::vector<frontier_entry> repair_frontier;
+
   const map_tile_t *dest;
 };
 
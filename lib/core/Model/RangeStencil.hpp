@@ -0,0 +1,78 @@
+/* RangeStencil.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_RANGE_STENCIL_HPP
+#define TD_RANGE_STENCIL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// the map tiles around a tower, sorted by (squared) distance from the tower
+// center. Every tower sits centered on its tower block, so the tiles around it
+// look the same from every tower slot -- hence one stencil of tile offsets
+// (relative to the block center) does for all of the towers. Walking the
+// stencil in order visits the tiles closest-first, so the first tile with a
+// mob in it has the closest target, and we can stop as soon as the tiles are
+// out of range
+template <typename MapT> class RangeStencil {
+public:
+  struct stencil_tile {
+    // the tile offset from the tile at the (lower right of the) block center
+    int16_t col_offset;
+    int16_t row_offset;
+    // normalized, squared distance from the block center to the tile center
+    float distance_sq;
+  };
+
+  RangeStencil() {
+    // the tower can be anywhere on the map, so the offsets have to cover the
+    // whole map from any block center
+    const int half_width = MapT::TowerTileWidth / 2;
+    const int half_height = MapT::TowerTileHeight / 2;
+    stencil.reserve(4 * MapT::MAP_WIDTH * MapT::MAP_HEIGHT);
+    for (int row_offset = -MapT::MAP_HEIGHT; row_offset < MapT::MAP_HEIGHT;
+         ++row_offset) {
+      for (int col_offset = -MapT::MAP_WIDTH; col_offset < MapT::MAP_WIDTH;
+           ++col_offset) {
+        // skip the tower's own block, can't have a mob in the tower
+        if (row_offset >= -half_height && row_offset < half_height &&
+            col_offset >= -half_width && col_offset < half_width) {
+          continue;
+        }
+
+        // NOTE: the block center is on the tile corners, hence the 0.5 offset
+        const float col_dist = (col_offset + 0.5f) * MapT::NormFactorWidth;
+        const float row_dist = (row_offset + 0.5f) * MapT::NormFactorHeight;
+        stencil_tile tile;
+        tile.col_offset = static_cast<int16_t>(col_offset);
+        tile.row_offset = static_cast<int16_t>(row_offset);
+        tile.distance_sq = col_dist * col_dist + row_dist * row_dist;
+        stencil.push_back(tile);
+      }
+    }
+
+    // NOTE: stable sort, so the tie-breaking is the same from run to run
+    std::stable_sort(stencil.begin(), stencil.end(),
+                     [](const stencil_tile &lhs, const stencil_tile &rhs) {
+                       return lhs.distance_sq < rhs.distance_sq;
+                     });
+  }
+
+  inline typename std::vector<stencil_tile>::const_iterator begin() const {
+    return stencil.begin();
+  }
+  inline typename std::vector<stencil_tile>::const_iterator end() const {
+    return stencil.end();
+  }
+
+private:
+  std::vector<stencil_tile> stencil;
+};
+
+#endif
@@ -0,0 +1,183 @@
+/* SpatialGrid.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_SPATIAL_GRID_HPP
+#define TD_SPATIAL_GRID_HPP
+
+#include "MobTable.hpp"
+#include "util/Types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Uniform-grid spatial index over the live mobs, with 1 cell per map tile. It's
+ * rebuilt from scratch every tick via a counting sort -- count the mobs per
+ * cell, prefix-sum the counts into cell offsets, then scatter the mob indices
+ * into one contiguous array. So the mobs in a cell are a contiguous range of
+ * (dense) MobTable indices, and no per-cell allocations are needed.
+ *
+ * NOTE: the indices are only valid until the MobTable is next modified (i.e.
+ * mobs added or removed), so the grid has to be rebuilt after that
+ */
+template <typename MapT> class SpatialGrid {
+public:
+  static constexpr int GRID_WIDTH = MapT::MAP_WIDTH;
+  static constexpr int GRID_HEIGHT = MapT::MAP_HEIGHT;
+  static constexpr int NUM_CELLS = GRID_WIDTH * GRID_HEIGHT;
+
+  // the range of mob indices in a cell
+  struct CellRange {
+    CellRange(const uint32_t *first_mob, const uint32_t *last_mob)
+        : first(first_mob), last(last_mob) {}
+
+    inline const uint32_t *begin() const { return first; }
+    inline const uint32_t *end() const { return last; }
+    inline size_t size() const { return last - first; }
+    inline bool empty() const { return first == last; }
+
+    const uint32_t *first;
+    const uint32_t *last;
+  };
+
+  SpatialGrid() { cell_start.fill(0); }
+
+  void rebuild(const MobTable &mobs) {
+    const uint32_t num_mobs = static_cast<uint32_t>(mobs.size());
+    mob_cells.resize(num_mobs);
+    cell_mobs.resize(num_mobs);
+    cell_col.resize(num_mobs);
+    cell_row.resize(num_mobs);
+
+    // count the #mobs per cell...
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+    for (uint32_t mob_idx = 0; mob_idx < num_mobs; ++mob_idx) {
+      const uint32_t cell_idx =
+          get_cell_idx(mobs.pos_col[mob_idx], mobs.pos_row[mob_idx]);
+      mob_cells[mob_idx] = cell_idx;
+      cell_start[cell_idx]++;
+    }
+
+    //... get the end offset of each cell...
+    for (int cell_idx = 1; cell_idx < NUM_CELLS; ++cell_idx) {
+      cell_start[cell_idx] += cell_start[cell_idx - 1];
+    }
+    cell_start[NUM_CELLS] = num_mobs;
+
+    //... and scatter the mobs into their cells. Going in reverse keeps the mobs
+    // in (ascending) index order within a cell, and leaves each cell_start
+    // entry at the start offset of its cell
+    for (uint32_t mob_idx = num_mobs; mob_idx-- > 0;) {
+      const uint32_t entry_idx = --cell_start[mob_cells[mob_idx]];
+      cell_mobs[entry_idx] = mob_idx;
+      cell_col[entry_idx] = mobs.pos_col[mob_idx];
+      cell_row[entry_idx] = mobs.pos_row[mob_idx];
+    }
+  }
+
+  inline size_t size() const { return cell_mobs.size(); }
+
+  // assumes normalized coordinates; out of bounds positions are clamped to the
+  // edge of the map
+  inline Coordinate<int> get_cell(const float col_location,
+                                  const float row_location) const {
+    return Coordinate<int>(to_cell_col(col_location),
+                           to_cell_row(row_location));
+  }
+
+  inline CellRange get_cell_mobs(const int col, const int row) const {
+    const uint32_t cell_idx = row * GRID_WIDTH + col;
+    return CellRange(cell_mobs.data() + cell_start[cell_idx],
+                     cell_mobs.data() + cell_start[cell_idx + 1]);
+  }
+
+  inline CellRange get_cell_mobs(const Coordinate<float> &location) const {
+    auto cell = get_cell(location.col, location.row);
+    return get_cell_mobs(cell.col, cell.row);
+  }
+
+  // appends the mobs within the [min, max] rectangle to mob_indices
+  void query_rect(const Coordinate<float> &min_corner,
+                  const Coordinate<float> &max_corner,
+                  std::vector<uint32_t> &mob_indices) const {
+    for_each_cell_entry(min_corner, max_corner, [&](const uint32_t entry_idx) {
+      if (cell_col[entry_idx] >= min_corner.col &&
+          cell_col[entry_idx] <= max_corner.col &&
+          cell_row[entry_idx] >= min_corner.row &&
+          cell_row[entry_idx] <= max_corner.row) {
+        mob_indices.push_back(cell_mobs[entry_idx]);
+      }
+    });
+  }
+
+  // appends the mobs strictly within radius of the center to mob_indices
+  void query_radius(const Coordinate<float> &center, const float radius,
+                    std::vector<uint32_t> &mob_indices) const {
+    const float radius_sq = radius * radius;
+    const Coordinate<float> min_corner(center.col - radius,
+                                       center.row - radius);
+    const Coordinate<float> max_corner(center.col + radius,
+                                       center.row + radius);
+    for_each_cell_entry(min_corner, max_corner, [&](const uint32_t entry_idx) {
+      const float col_diff = cell_col[entry_idx] - center.col;
+      const float row_diff = cell_row[entry_idx] - center.row;
+      if (col_diff * col_diff + row_diff * row_diff < radius_sq) {
+        mob_indices.push_back(cell_mobs[entry_idx]);
+      }
+    });
+  }
+
+private:
+  inline int to_cell_col(const float col_location) const {
+    const int col = static_cast<int>(std::floor(col_location * GRID_WIDTH));
+    return std::min(std::max(col, 0), GRID_WIDTH - 1);
+  }
+
+  inline int to_cell_row(const float row_location) const {
+    const int row = static_cast<int>(std::floor(row_location * GRID_HEIGHT));
+    return std::min(std::max(row, 0), GRID_HEIGHT - 1);
+  }
+
+  inline uint32_t get_cell_idx(const float col_location,
+                               const float row_location) const {
+    return to_cell_row(row_location) * GRID_WIDTH + to_cell_col(col_location);
+  }
+
+  // visits every entry in the cells overlapped by the rectangle
+  template <typename EntryFn>
+  void for_each_cell_entry(const Coordinate<float> &min_corner,
+                           const Coordinate<float> &max_corner,
+                           EntryFn entry_fn) const {
+    const int min_col = to_cell_col(min_corner.col);
+    const int max_col = to_cell_col(max_corner.col);
+    const int min_row = to_cell_row(min_corner.row);
+    const int max_row = to_cell_row(max_corner.row);
+    for (int row = min_row; row <= max_row; ++row) {
+      // the cells in a row are contiguous, so we can do the whole span at once
+      const uint32_t span_begin = cell_start[row * GRID_WIDTH + min_col];
+      const uint32_t span_end = cell_start[row * GRID_WIDTH + max_col + 1];
+      for (uint32_t entry_idx = span_begin; entry_idx < span_end; ++entry_idx) {
+        entry_fn(entry_idx);
+      }
+    }
+  }
+
+  // cell --> start offset into the entries (the last element is the #mobs)
+  std::array<uint32_t, NUM_CELLS + 1> cell_start;
+  // the entries, sorted by cell: the mob index and its position
+  std::vector<uint32_t> cell_mobs;
+  std::vector<float> cell_col;
+  std::vector<float> cell_row;
+  // mob index --> cell
+  std::vector<uint32_t> mob_cells;
+};
+
+#endif
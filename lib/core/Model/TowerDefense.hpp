@@ -9,19 +9,25 @@
 #ifndef TD_TOWER_DEFENSE_HPP
 #define TD_TOWER_DEFENSE_HPP
 
+#include "GameClock.hpp"
 #include "GameMap.hpp"
 #include "ModelUtils.hpp"
 #include "TowerLogic.hpp"
 #include "shared/Player.hpp"
 #include "shared/common_information.hpp"
+#include "util/Logger.hpp"
+#include "util/RandomUtility.hpp"
 #include "util/TDEventTypes.hpp"
 
 #include <algorithm>
 #include <atomic>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -37,22 +43,31 @@ class TowerDefense {
 
 public:
   // it's possible that we'll move to normalized coordinates?
-  explicit TowerDefense(int32_t seed = -1) {
-    if (seed < 0) {
-      seed = std::time(0);
+  // NOTE: passing in a VirtualClock makes for a headless game -- the gameloop
+  // no longer sleeps between ticks, so it's meant to be driven via run_ticks /
+  // run_until_wave_end rather than start_game
+  explicit TowerDefense(int32_t seed = -1,
+                        std::unique_ptr<GameClock> clock = nullptr)
+      : game_clock(std::move(clock)), current_state(GAME_STATE::PAUSED),
+        continue_gameloop(false) {
+    if (!game_clock) {
+      game_clock = std::unique_ptr<GameClock>(new RealtimeClock());
     }
-    std::srand(seed);
-
     td_view = std::make_unique<ViewType<ModelType>>();
 
-    TDPlayerInformation defaultplayer_state(20, 0, 20);
+    TDPlayerInformation defaultplayer_state = make_default_player_state();
 
     // td_view->draw_maptiles(ModelType::TLIST_WIDTH, ModelType::TLIST_HEIGHT);
     td_backend = std::unique_ptr<ModelType>(new ModelType(defaultplayer_state));
+    // NOTE: otherwise the backend picks a seed of its own
+    if (seed >= 0) {
+      td_backend->seed_random_engine(seed);
+    }
 
     spawn_point = GameMap::IndexCoordinate(GameMap::MAP_WIDTH - 1,
                                            GameMap::MAP_HEIGHT - 1);
     dest_point = GameMap::IndexCoordinate(0, 0);
+    td_backend->set_path_endpoints(spawn_point, dest_point);
     timestamp = 0;
 
     //-----------------------------------------------------------------
@@ -70,19 +85,109 @@ public:
   }
 
   void init_game();
+  // starts a new game with the existing frontend and backend (unlike making a
+  // new TowerDefense, which also sets up the map, tower models, etc) -- the
+  // seed is as per the constructor. NOTE: can't be done while the gameloop
+  // thread is running
+  void reset_game(const int32_t seed = -1);
   void start_game() {
     // should we have a seperate thread for the gameloop? and do we need any
     // other initialization beforehand?
     std::cout << "Starting Gameloop" << std::endl;
 
+    // NOTE: not while the game is being stepped (see run_ticks)
+    std::lock_guard<std::mutex> step_lock(step_mutex);
     continue_gameloop.store(true, std::memory_order_seq_cst);
     gameloop_thread = std::unique_ptr<std::thread>(
         new std::thread(&TowerDefense::gameloop, this));
   }
   void stop_game() {
+    if (!gameloop_thread) {
+      throw std::logic_error("ERROR -- the gameloop thread isn't running");
+    }
     continue_gameloop.store(false, std::memory_order_seq_cst);
     std::cout << "Stopping Gameloop" << std::endl;
     gameloop_thread->join();
+    std::lock_guard<std::mutex> step_lock(step_mutex);
+    gameloop_thread.reset();
+  }
+
+  // drive the gameloop from the calling thread rather than the gameloop thread
+  // -- these return the number of ticks that were run. Mostly useful with a
+  // VirtualClock, where the ticks run as fast as they can be computed. NOTE:
+  // the game can only be stepped by 1 thread at a time, and the game state
+  // can't be read in the meantime (see lock_game_state)
+  uint64_t run_ticks(const uint64_t num_ticks);
+  // runs until the current (or if idle, the next) wave is over, or until
+  // max_ticks have been run
+  uint64_t run_until_wave_end(
+      const uint64_t max_ticks = std::numeric_limits<uint64_t>::max());
+
+  // NOTE: these (and the stats / snapshot accessors below) can be called from
+  // any thread, including while the gameloop thread is running
+  inline GAME_STATE get_game_state() const { return current_state.load(); }
+  inline uint64_t get_timestamp() const { return timestamp.load(); }
+  inline bool is_running() const { return continue_gameloop.load(); }
+  // the player's state as of the end of the latest tick
+  TDPlayerInformation get_player_state() const {
+    return shared_game_info->get_player_state_snapshot();
+  }
+
+  // the event queue counters, for monitoring (safe to poll from any thread)
+  QueueStats get_towerevent_stats() const {
+    if (!td_towerevents) {
+      throw std::logic_error("Game not initialized");
+    }
+    return td_towerevents->get_stats();
+  }
+  QueueStats get_frame_stats() const {
+    return td_backend->get_frontend_eventqueue()->get_frame_stats();
+  }
+
+  // whether a snapshot is taken every tick (the default). Otherwise the
+  // snapshots are only taken on demand, which can't be done while the gameloop
+  // thread is running
+  void set_snapshots_enabled(const bool enabled) { snapshots_enabled = enabled; }
+
+  // a copy of the game state snapshot (see GameSnapshot.hpp) from the end of
+  // the latest tick. NOTE: safe to call from any thread -- but if the snapshot
+  // has to be taken here, then it waits for the game to finish being stepped
+  std::vector<uint8_t> get_snapshot() const {
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mutex);
+      if (!latest_snapshot.empty() && snapshots_enabled) {
+        return latest_snapshot;
+      }
+    }
+
+    // nothing has been run yet (or the snapshots are on demand) -- but if
+    // there's no gameloop thread, then we can take one here. NOTE: we check the
+    // thread rather than is_running(), since the loop is still finishing its
+    // last step for a while after stop_game clears the flag
+    std::lock_guard<std::mutex> step_lock(step_mutex);
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    if ((latest_snapshot.empty() || !snapshots_enabled) && !gameloop_thread) {
+      td_backend->write_snapshot(latest_snapshot, timestamp, current_state);
+    }
+    return latest_snapshot;
+  }
+
+  // keeps the game from being stepped (i.e. by run_ticks on another thread)
+  // for as long as the lock is held, s.t. the game state can be read directly.
+  // Throws rather than waiting if the game is being stepped, or if the
+  // gameloop thread is running
+  std::unique_lock<std::mutex> lock_game_state() const {
+    std::unique_lock<std::mutex> step_lock(step_mutex, std::try_to_lock);
+    if (!step_lock.owns_lock()) {
+      throw std::logic_error("ERROR -- the game state can't be read while the "
+                             "game is being stepped");
+    }
+    // NOTE: the thread is only reset (under the step_mutex) once it's joined
+    if (gameloop_thread) {
+      throw std::logic_error("ERROR -- the game state can't be read while the "
+                             "gameloop thread is running");
+    }
+    return step_lock;
   }
 
   bool add_tower(std::vector<std::vector<uint32_t>> &&polygon_mesh,
@@ -103,14 +208,29 @@ private:
   static constexpr double TIME_PER_ROUND = 1000.0 / 30.0;
   // 15 seconds to build
   static constexpr double TIME_BETWEEN_ROUND = 1000.0 * 15.0;
+  static constexpr size_t TOWER_EVENT_QUEUE_SIZE = 500;
+
+  static TDPlayerInformation make_default_player_state() {
+    return TDPlayerInformation(20, 0, 20);
+  }
 
   void gameloop();
+  // a single iteration of the gameloop, including any state transitions
+  void gameloop_step();
+  // checks that the game can be stepped from the calling thread, and gets the
+  // gameloop going if it's not yet. NOTE: the step_mutex has to be held
+  void prepare_stepping();
+  void enter_gameloop();
   // break out the gameloop stages
   void gloop_preprocessing();
   void gloop_processing();
   void gloop_postprocessing();
 
+  std::unique_ptr<GameClock> game_clock;
   std::unique_ptr<TDState> game_state;
+  // NOTE: only written by whichever thread runs the gameloop, but atomic s.t.
+  // they can be polled from others
+  std::atomic<GAME_STATE> current_state;
 
   // the frontend
   std::unique_ptr<ViewType<ModelType>> td_view;
@@ -125,15 +245,29 @@ private:
 
   std::unique_ptr<std::thread> gameloop_thread;
   std::atomic<bool> continue_gameloop;
+  // held for the whole of a run_ticks / run_until_wave_end, and while the
+  // gameloop thread is started or stopped
+  mutable std::mutex step_mutex;
 
   using TowerEventQueueType = typename ViewType<ModelType>::TowerEventQueueType;
   std::unique_ptr<TowerEventQueueType> td_towerevents;
+  // the events taken from the above on each game loop iteration
+  std::vector<std::unique_ptr<UserTowerEvents::tower_event<ModelType>>>
+      pending_towerevents;
 
   // NOTE: this is where the monsters should spawn at -- this likely(?) won't
   // ever change during the course of the game these are normalized coordinates
   GameMap::IndexCoordinate spawn_point;
   GameMap::IndexCoordinate dest_point;
-  uint64_t timestamp;
+  std::atomic<uint64_t> timestamp;
+
+  // a snapshot is taken at the end of every tick -- it gets written into the
+  // scratch buffer, then swapped with the latest one (s.t. the lock is only
+  // held for the swap, and the buffers keep getting reused)
+  std::vector<uint8_t> snapshot_buffer;
+  mutable std::vector<uint8_t> latest_snapshot;
+  mutable std::mutex snapshot_mutex;
+  std::atomic<bool> snapshots_enabled{true};
 
   //-----------------------------------------------------------------------------------------------
   // Nested state machine types
@@ -143,11 +277,26 @@ private:
 
     virtual ~TDState() {}
 
-    using time_pt = std::chrono::time_point<std::chrono::high_resolution_clock>;
+    using time_pt = GameClock::time_pt;
     virtual void enter_state(GAME_STATE previous_state) = 0;
     virtual GAME_STATE cycle_update(time_pt current_timestamp) = 0;
 
   protected:
+    // enforce the iteration speed to operate at a fixed timestep -- returns the
+    // time the iteration took (in ms)
+    double pace_iteration(time_pt current_timestamp) {
+      auto end_iter_time = td->game_clock->now();
+      double time_elapsed =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              end_iter_time - current_timestamp)
+              .count();
+      if (time_elapsed <= TIME_PER_ROUND) {
+        td->game_clock->wait_for(std::chrono::milliseconds(
+            std::llround(std::floor(TIME_PER_ROUND - time_elapsed))));
+      }
+      return time_elapsed;
+    }
+
     TowerDefense *td;
   };
 
@@ -160,7 +309,7 @@ private:
         return;
       }
 
-      initial_timestamp = std::chrono::high_resolution_clock::now();
+      initial_timestamp = TDState::td->game_clock->now();
     }
 
     GAME_STATE
@@ -172,6 +321,8 @@ private:
                              .count();
 
       TDState::td->gloop_preprocessing();
+      // no need to spin any faster than the in-round updates
+      TDState::pace_iteration(current_timestamp);
 
       if (idle_time > TIME_BETWEEN_ROUND) {
         // TODO: ... do whatever other things needed before transitioning states
@@ -251,17 +402,9 @@ private:
 
       // check if we're too slow, enforce the iteration speed to operate at a
       // fixed timestep
-      auto end_iter_time = std::chrono::high_resolution_clock::now();
-      double time_elapsed =
-          std::chrono::duration_cast<std::chrono::milliseconds>(
-              end_iter_time - current_timestamp)
-              .count();
+      double time_elapsed = TDState::pace_iteration(current_timestamp);
       if (time_elapsed > TIME_PER_ROUND) {
-        std::cout << "Over the per-round target! -- " << time_elapsed << " ms"
-                  << std::endl;
-      } else {
-        std::this_thread::sleep_for(std::chrono::milliseconds(
-            std::llround(std::floor(TIME_PER_ROUND - time_elapsed))));
+        TD_LOG(Warn, "tick_overrun", Logging::kv("elapsed_ms", time_elapsed));
       }
 
       // NOTE: we hope to say that each timestamp is equal to 1 iter (in ms).
@@ -307,9 +450,11 @@ private:
 
 template <template <class> class ViewType, class ModelType>
 void TowerDefense<ViewType, ModelType>::init_game() {
-  // register the tower-event queues, as triggered by user input
-  td_towerevents =
-      std::unique_ptr<TowerEventQueueType>(new TowerEventQueueType());
+  // register the tower-event queues, as triggered by user input -- NOTE: if the
+  // backend falls that far behind, the new commands get rejected (rather than
+  // silently losing older ones), s.t. whoever sent them knows
+  td_towerevents = std::unique_ptr<TowerEventQueueType>(new TowerEventQueueType(
+      TOWER_EVENT_QUEUE_SIZE, 0, OverflowPolicy::DropNewest));
   td_view->register_tower_eventqueue(td_towerevents.get());
 
   // hook up the backend and frontends, so we can send events from backend to
@@ -331,11 +476,81 @@ void TowerDefense<ViewType, ModelType>::init_game() {
 }
 
 template <template <class> class ViewType, class ModelType>
-void TowerDefense<ViewType, ModelType>::gameloop() {
+void TowerDefense<ViewType, ModelType>::reset_game(const int32_t seed) {
+  std::lock_guard<std::mutex> step_lock(step_mutex);
+  if (gameloop_thread) {
+    throw std::logic_error("ERROR -- cannot reset the game while the gameloop "
+                           "thread is running");
+  }
+  if (!td_towerevents) {
+    throw std::logic_error("ERROR -- game has to be initialized (init_game) "
+                           "before it can be reset");
+  }
+
+  // the user events from the last game don't carry over
+  td_towerevents->drain_into(pending_towerevents);
+  pending_towerevents.clear();
+
+  TDPlayerInformation defaultplayer_state = make_default_player_state();
+  td_backend->reset_game(defaultplayer_state);
+  td_backend->seed_random_engine(seed >= 0 ? seed : Randomize::make_seed());
+  shared_game_info->set_player_state_snapshot(std::move(defaultplayer_state));
+
+  timestamp = 0;
+  game_state = std::unique_ptr<TDState>(new PausedState(this));
+  current_state = GAME_STATE::PAUSED;
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    latest_snapshot.clear();
+  }
+  td_backend->enter_idle_state();
+}
+
+template <template <class> class ViewType, class ModelType>
+void TowerDefense<ViewType, ModelType>::enter_gameloop() {
   // start the loop off in idle
   game_state = std::unique_ptr<TDState>(new IdleState(this));
   game_state->enter_state(GAME_STATE::PAUSED);
-  GAME_STATE current_state = GAME_STATE::IDLE;
+  current_state = GAME_STATE::IDLE;
+}
+
+template <template <class> class ViewType, class ModelType>
+void TowerDefense<ViewType, ModelType>::gameloop_step() {
+  auto start_iter_time = game_clock->now();
+  auto next_state = game_state->cycle_update(start_iter_time);
+
+  // TODO: need to have a better state transitioning system
+  if (next_state != current_state) {
+    if (next_state == GAME_STATE::IDLE) {
+      game_state = std::unique_ptr<TDState>(new IdleState(this));
+    }
+
+    if (next_state == GAME_STATE::ACTIVE) {
+      game_state = std::unique_ptr<TDState>(new ActiveState(this));
+    }
+
+    game_state->enter_state(current_state);
+    current_state = next_state;
+  }
+
+  // hand all of this tick's events over to the frontend at once
+  td_backend->get_frontend_eventqueue()->publish_frame(timestamp);
+
+  if (!snapshots_enabled) {
+    return;
+  }
+  td_backend->write_snapshot(snapshot_buffer, timestamp, current_state);
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    latest_snapshot.swap(snapshot_buffer);
+  }
+}
+
+template <template <class> class ViewType, class ModelType>
+void TowerDefense<ViewType, ModelType>::gameloop() {
+  if (current_state == GAME_STATE::PAUSED) {
+    enter_gameloop();
+  }
 
   // TODO: have a timer to keep track of how long it has been in the current
   // state, and transition accordingly at the game state transitions, we need to
@@ -345,45 +560,74 @@ void TowerDefense<ViewType, ModelType>::gameloop() {
   // the main gameloop. checks the frontend and backend, mediates communication
   // between the two applies updates, etc
   while (continue_gameloop.load()) {
-    auto start_iter_time = std::chrono::high_resolution_clock::now();
-    auto next_state = game_state->cycle_update(start_iter_time);
+    gameloop_step();
+    // std::cout << "Game state: " << current_state << std::endl;
+  }
+  std::cout << "Exiting GameLoop" << std::endl;
+}
 
-    // TODO: need to have a better state transitioning system
-    if (next_state != current_state) {
-      if (next_state == GAME_STATE::IDLE) {
-        game_state = std::unique_ptr<TDState>(new IdleState(this));
-      }
+template <template <class> class ViewType, class ModelType>
+void TowerDefense<ViewType, ModelType>::prepare_stepping() {
+  if (gameloop_thread) {
+    throw std::logic_error("ERROR -- cannot step the game while the gameloop "
+                           "thread is running");
+  }
+  if (!td_towerevents) {
+    throw std::logic_error("ERROR -- game has to be initialized (init_game) "
+                           "before it can be stepped");
+  }
 
-      if (next_state == GAME_STATE::ACTIVE) {
-        game_state = std::unique_ptr<TDState>(new ActiveState(this));
-      }
+  if (current_state == GAME_STATE::PAUSED) {
+    enter_gameloop();
+  }
+}
 
-      game_state->enter_state(current_state);
-      current_state = next_state;
-    }
+template <template <class> class ViewType, class ModelType>
+uint64_t
+TowerDefense<ViewType, ModelType>::run_ticks(const uint64_t num_ticks) {
+  std::lock_guard<std::mutex> step_lock(step_mutex);
+  prepare_stepping();
+  for (uint64_t tick = 0; tick < num_ticks; ++tick) {
+    gameloop_step();
+  }
+  return num_ticks;
+}
 
-    // std::cout << "Game state: " << current_state << std::endl;
+template <template <class> class ViewType, class ModelType>
+uint64_t
+TowerDefense<ViewType, ModelType>::run_until_wave_end(const uint64_t max_ticks) {
+  std::lock_guard<std::mutex> step_lock(step_mutex);
+  prepare_stepping();
+  uint64_t num_ticks = 0;
+  // if we're between rounds, wait for the next wave to start...
+  while (current_state != GAME_STATE::ACTIVE && num_ticks < max_ticks) {
+    gameloop_step();
+    num_ticks++;
   }
-  std::cout << "Exiting GameLoop" << std::endl;
+  //... then run it until there's nothing left alive
+  while (current_state == GAME_STATE::ACTIVE && num_ticks < max_ticks) {
+    gameloop_step();
+    num_ticks++;
+  }
+  return num_ticks;
 }
 
 template <template <class> class ViewType, class ModelType>
 void TowerDefense<ViewType, ModelType>::gloop_preprocessing() {
 
-  // handle the dispatching of the user-input tower events
-  std::unique_ptr<UserTowerEvents::tower_event<ModelType>> td_evt(nullptr);
-  while (!td_towerevents->empty()) {
-    bool got_data = false;
-    td_evt = std::move(td_towerevents->pop(got_data));
-
-    std::cout << "Got frontend event, dispatching!" << std::endl;
+  // handle the dispatching of the user-input tower events -- NOTE: we grab all
+  // of the pending events at once, s.t. we only take the queue's lock once
+  td_towerevents->drain_into(pending_towerevents);
+  for (auto &td_evt : pending_towerevents) {
+    TD_LOG(Debug, "dispatch_user_event");
 
     // call the event functor -- since it's a pointer, I opted to use a regular
     // function rather than operator overloading (the syntax looks bad)
-    if (got_data && td_evt) {
+    if (td_evt) {
       td_evt->apply(td_backend.get());
     }
   }
+  pending_towerevents.clear();
 
   // TODO: also check for --
   // 1. tower modifications
@@ -8,14 +8,11 @@
 
 #include "TowerLogic.hpp"
 #include "AttackLogic.hpp"
+#include "util/Logger.hpp"
 
-#include <queue>
+#include <cmath>
 #include <random>
 
-template <typename T> inline T L2dist(T r_diff, T c_diff) {
-  return std::sqrt(r_diff * r_diff + c_diff * c_diff);
-}
-
 bool TowerLogic::make_tower(const uint32_t ID, const int tier,
                             const float x_coord, const float y_coord) {
   // the tower name and everything would have to be specified by the user when
@@ -32,14 +29,21 @@ bool TowerLogic::make_tower(const uint32_t ID, const int tier,
   // get the tile that the (x, y) point falls within
   auto tower_block = map.get_tower_block(x_coord, y_coord);
   if (map.is_obstructed(tower_block)) {
-    std::cout << "Cannot build at [" << x_coord << ", " << y_coord
-              << "] -- is obstructed!" << std::endl;
+    TD_LOG(Warn, "tower_obstructed", Logging::kv("x", x_coord),
+           Logging::kv("y", y_coord));
     // TODO: write an error message (with position information) to the backend
     // error queue (to be read by the gameloop and displayed by the frontend at
     // the specified location)
     return false;
   }
 
+  // the mobs always need a way through, so no walling them in
+  if (path_connectivity.blocks_path(tower_block)) {
+    TD_LOG(Warn, "tower_blocks_path", Logging::kv("x", x_coord),
+           Logging::kv("y", y_coord));
+    return false;
+  }
+
   // we can assume that the location is valid now
   // TODO: need to have other checks, i.e. if the player has enough $$ to build
   // it
@@ -51,8 +55,20 @@ bool TowerLogic::make_tower(const uint32_t ID, const int tier,
   map_offsets[0] = block_offset.col;
   map_offsets[1] = block_offset.row;
 
-  // set the tile to be obstructed
+  // set the tile to be obstructed, and have the mobs path around it
   map.set_obstructed(tower_block, true);
+  path_finder.obstruct_region(map, tower_block);
+
+  // no building on top of the mobs, or closing them off from the rest of the
+  // path either
+  if (strands_live_mobs()) {
+    TD_LOG(Warn, "tower_strands_mobs", Logging::kv("x", x_coord),
+           Logging::kv("y", y_coord));
+    map.set_obstructed(tower_block, false);
+    path_finder.clear_region(map, tower_block);
+    return false;
+  }
+  update_map();
 
   const int tower_row = std::get<0>(tower_block.row) / GameMap::TowerTileHeight;
   const int tower_col = std::get<0>(tower_block.col) / GameMap::TowerTileWidth;
@@ -65,11 +81,12 @@ bool TowerLogic::make_tower(const uint32_t ID, const int tier,
   // TODO: need to refactor t_list to work on TOWER-indices (e.g.
   // [MAP_HEIGHT/TowerTileHeight][MAP_WIDTH/TowerTileWidth] array)
 
+  const uint32_t tower_name_id = entity_names.intern(tower_name);
   t_list[tower_row][tower_col] = TowerGenerator::make_fundamentaltower(
       ID, tier, tower_name, block_offset.row, block_offset.col);
-  std::cout << "Generating Tower: "
-            << "@ [" << block_offset.row << ", " << block_offset.col << "]: \n"
-            << *(t_list[tower_row][tower_col].get()) << std::endl;
+  TD_LOG(Info, "tower_built", Logging::kv("tower", tower_name),
+         Logging::kv("tier", tier), Logging::kv("row", block_offset.row),
+         Logging::kv("col", block_offset.col));
 
   // get the average for each dimension (to get the center point)
   std::vector<float> dim_avgs(3, 0);
@@ -94,7 +111,7 @@ bool TowerLogic::make_tower(const uint32_t ID, const int tier,
   std::unique_ptr<RenderEvents::create_tower> t_evt =
       std::unique_ptr<RenderEvents::create_tower>(
           new RenderEvents::create_tower(
-              ID, t_list[tower_row][tower_col]->get_model(), tower_name,
+              ID, t_list[tower_row][tower_col]->get_model(), tower_name_id,
               std::move(map_offsets)));
   td_frontend_events->add_maketower_event(std::move(t_evt));
 
@@ -106,6 +123,122 @@ bool TowerLogic::make_tower(const uint32_t ID, const int tier,
   return true;
 }
 
+bool TowerLogic::remove_tower(const float x_coord, const float y_coord) {
+  auto tower_block = map.get_tower_block(x_coord, y_coord);
+  const int tower_row = std::get<0>(tower_block.row) / GameMap::TowerTileHeight;
+  const int tower_col = std::get<0>(tower_block.col) / GameMap::TowerTileWidth;
+  // NOTE: the tower block is (-1, -1) if the location is off the map
+  if (std::get<0>(tower_block.row) < 0 || std::get<0>(tower_block.col) < 0 ||
+      t_list[tower_row][tower_col] == nullptr) {
+    TD_LOG(Warn, "no_tower_to_remove", Logging::kv("x", x_coord),
+           Logging::kv("y", y_coord));
+    return false;
+  }
+
+  // the in-flight attacks point back at their tower, so they have to go too
+  Tower *removed_tower = t_list[tower_row][tower_col].get();
+  active_attacks.remove_if([this, removed_tower](const TowerAttackBase &attack) {
+    if (attack.get_origin_tower() != removed_tower) {
+      return false;
+    }
+    td_frontend_events->add_removeatk_event(
+        RenderEvents::remove_attack(attack.get_id()));
+    return true;
+  });
+
+  shared_tower_info->remove_towerinfo(removed_tower->get_id());
+  t_list[tower_row][tower_col].reset();
+
+  // open up the tiles again, the mobs might have a shorter path now
+  map.set_obstructed(tower_block, false);
+  path_finder.clear_region(map, tower_block);
+  update_map();
+  return true;
+}
+
+void TowerLogic::reset_game(const TDPlayerInformation &pstate) {
+  reset_state();
+  attack_hits.clear();
+
+  for (int tower_row = 0; tower_row < TLIST_HEIGHT; ++tower_row) {
+    for (int tower_col = 0; tower_col < TLIST_WIDTH; ++tower_col) {
+      if (t_list[tower_row][tower_col] == nullptr) {
+        continue;
+      }
+      shared_tower_info->remove_towerinfo(
+          t_list[tower_row][tower_col]->get_id());
+      t_list[tower_row][tower_col].reset();
+
+      // NOTE: the tower slots line up with the tower blocks
+      const GameMap::TowerCoordinate tower_block(
+          std::make_tuple(tower_col * GameMap::TowerTileWidth,
+                          (tower_col + 1) * GameMap::TowerTileWidth),
+          std::make_tuple(tower_row * GameMap::TowerTileHeight,
+                          (tower_row + 1) * GameMap::TowerTileHeight));
+      map.set_obstructed(tower_block, false);
+      path_finder.clear_region(map, tower_block);
+    }
+  }
+  update_map();
+
+  player_state = pstate;
+  num_mobs_killed = 0;
+  num_mobs_leaked = 0;
+}
+
+void TowerLogic::update_connectivity() {
+  if (has_path_endpoints) {
+    path_connectivity.rebuild(map, path_spawn, path_dest);
+  }
+}
+
+void TowerLogic::update_map() {
+  // NOTE: the path cuts are kept current regardless, since the next build gets
+  // validated against them -- it's only the rerouting that can wait
+  update_connectivity();
+  if (defer_map_updates) {
+    map_updates_pending = true;
+    return;
+  }
+  map_updates_pending = false;
+  reroute_mobs();
+}
+
+void TowerLogic::reroute_mobs() {
+  // the flow field changed, so the paths that the frontend has for the mobs
+  // might not hold anymore
+  std::fill(live_mobs.path_changed.begin(), live_mobs.path_changed.end(), true);
+
+  // the mobs get their next tile from the flow field as they go, so we only
+  // need to worry about the mobs heading towards a tile that is no longer on
+  // any path
+  for (uint32_t mob_idx = 0; mob_idx < live_mobs.size(); ++mob_idx) {
+    auto dest_tile = live_mobs.dest_tiles[mob_idx];
+    if (dest_tile == nullptr || path_finder.is_reachable(dest_tile)) {
+      continue;
+    }
+
+    // have the mob re-center on its tile, and pick up the field from there
+    auto mob_tile =
+        map.get_tile(map.get_nearest_tile(live_mobs.get_position(mob_idx)));
+    if (path_finder.is_reachable(mob_tile)) {
+      live_mobs.set_destination(mob_idx, mob_tile);
+    }
+    // NOTE: make_tower won't strand a mob, so the tile it's on always is
+  }
+}
+
+bool TowerLogic::strands_live_mobs() const {
+  for (uint32_t mob_idx = 0; mob_idx < live_mobs.size(); ++mob_idx) {
+    auto mob_tile =
+        map.get_tile(map.get_nearest_tile(live_mobs.get_position(mob_idx)));
+    if (!path_finder.is_reachable(mob_tile)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // this one does a wholesale replacement of the target tower, while the other
 // one adds a new modifier to the existing tower properties
 bool TowerLogic::modify_tower(tower_properties props, const float x_coord,
@@ -174,198 +307,142 @@ Tower *TowerLogic::get_tower(const float x_coord, const float y_coord) {
   return t_list[tile_row][tile_col].get();
 }
 
-// TODO: need to finish this to allow for manual targetting
+// manual targetting: the tower locks onto the mob closest to the targetted
+// location, as long as there's one close enough to count as picked out (i.e.
+// within half a tower block). The tower then sticks with it for as long as it
+// stays in range (see get_targets)
 bool TowerLogic::tower_target(const float tower_xcoord, const float tower_ycoord,
                              const float target_xcoord,
                              const float target_ycoord) {
   if (!map.is_obstructed(tower_xcoord, tower_ycoord))
     return false;
+  Tower *tower = get_tower(tower_xcoord, tower_ycoord);
+  if (!tower)
+    return false;
 
-  // TODO: set the tower's current target -- still need to decide how exactly
-  // this should be done (e.g. are we targetting a location or a mob?)
-  // t_list[t_tile.row][t_tile.col]->set_target(target_xcoord, target_ycoord);
+  const float pick_radius = 0.5f / TLIST_WIDTH;
+  float closest_dist_sq = pick_radius * pick_radius;
+  bool found_mob = false;
+  uint32_t closest_idx = 0;
+  for (uint32_t mob_idx = 0; mob_idx < live_mobs.size(); ++mob_idx) {
+    const float col_diff = live_mobs.pos_col[mob_idx] - target_xcoord;
+    const float row_diff = live_mobs.pos_row[mob_idx] - target_ycoord;
+    const float dist_sq = col_diff * col_diff + row_diff * row_diff;
+    if (dist_sq < closest_dist_sq) {
+      closest_dist_sq = dist_sq;
+      closest_idx = mob_idx;
+      found_mob = true;
+    }
+  }
+  if (!found_mob)
+    return false;
 
+  tower->set_target(live_mobs.handle_of(closest_idx));
   return true;
 }
 
 // not sure where this function should actually live -- part of TowerLogic,
 // GameMap, or Tower?
 bool TowerLogic::get_targets(Tower *tower, const int t_col, const int t_row) {
-  // get the tower tile extents, in terms of map tiles. location is [inclusive,
-  // exclusive)
-  int tile_row = t_row * GameMap::TowerTileHeight;
-  int tile_col = t_col * GameMap::TowerTileWidth;
-  // NOTE: centers of tiles have to be normalized
-  /*
-  constexpr double THeight = 1.0 / GameMap::MAP_HEIGHT;
-  constexpr double TWidth = 1.0 / GameMap::MAP_WIDTH;
-  auto tile_center = Coordinate<float>(THeight * (tile_row +
-  GameMap::TowerTileHeight/2.0f), TWidth * (tile_col +
-  GameMap::TowerTileWidth/2.0f));
-  */
-  auto tile_center = tower->get_position();
+  auto tower_center = tower->get_position();
+  // NOTE: we compare squared distances throughout, no need for the sqrt
+  const float range_sq = tower->get_attack_range() * tower->get_attack_range();
 
   // check if the cached target is still valid
-  auto prev_target = tower->get_target();
-  if (prev_target != nullptr) {
-    auto mob_pos = prev_target->get_position();
-    auto t_dist =
-        L2dist(mob_pos.row - tile_center.row, mob_pos.col - tile_center.col);
-
-    // TODO: this is part of a hack currently in place to manage the monster
-    // lifetimes (we move the monster out of bounds when its dead to get the
-    // tower to release its reference count on the monster. Hopefully I'll come
-    // up with a better system soon)
-    bool mob_inbounds = mob_pos.row >= 0.0f && mob_pos.row <= 1.0f &&
-                        mob_pos.col >= 0.0f && mob_pos.col <= 1.0f;
+  // NOTE: the handle of a mob that has since been removed will no longer be
+  // in the live mob table
+  auto prev_target = tower->get_target_handle();
+  if (live_mobs.contains(prev_target)) {
+    const uint32_t mob_idx = live_mobs.index_of(prev_target);
+    const float col_diff = live_mobs.pos_col[mob_idx] - tower_center.col;
+    const float row_diff = live_mobs.pos_row[mob_idx] - tower_center.row;
 
     // if old target is still in range, nothing else to do
-    if (tower->in_range(t_dist) && mob_inbounds) {
+    if (col_diff * col_diff + row_diff * row_diff < range_sq) {
       return true;
-    } else {
-      tower->reset_target();
     }
   }
+  tower->reset_target();
 
-  using cmp_type = MapTile *;
-  // takes the L2 distance of the tiles
-  auto L2cmp = [tile_center](const cmp_type &lhs, const cmp_type &rhs) {
-    float lhs_dist = L2dist<float>(lhs->tile_center.row - tile_center.row,
-                                   lhs->tile_center.col - tile_center.col);
-    float rhs_dist = L2dist<float>(rhs->tile_center.row - tile_center.row,
-                                   rhs->tile_center.col - tile_center.col);
-    return lhs_dist < rhs_dist;
-  };
-
-  std::priority_queue<cmp_type, std::vector<cmp_type>, decltype(L2cmp)>
-      bfs_tiles(L2cmp);
-
-  // add the the tower block tiles to the visited list (can't have a mob in the
-  // tower... hopefully...)
-  std::map<std::pair<int, int>, bool> visited_tiles;
-  for (int row = tile_row; row < tile_row + GameMap::TowerTileHeight; ++row)
-    for (int col = tile_col; col < tile_col + GameMap::TowerTileWidth; ++col)
-      visited_tiles.emplace(std::make_pair(row, col), true);
-
-  // add the outer perimeter of the tower blocks to the queue
-  int target_idx_low = tile_row - 1;
-  int target_idx_high = tile_row + GameMap::TowerTileHeight;
-  for (int col = tile_col - 1; col < tile_col + GameMap::TowerTileWidth + 1;
-       ++col) {
-    if (col >= 0 && col < GameMap::MAP_WIDTH) {
-      if (target_idx_low >= 0) {
-        bfs_tiles.push(map.get_tile(col, target_idx_low));
-        visited_tiles.emplace(std::make_pair(target_idx_low, col), true);
-      }
-
-      if (target_idx_high < GameMap::MAP_HEIGHT) {
-        bfs_tiles.push(map.get_tile(col, target_idx_high));
-        visited_tiles.emplace(std::make_pair(target_idx_high, col), true);
-      }
-    }
+  if (mob_grid.size() == 0) {
+    return false;
   }
 
-  target_idx_low = tile_col - 1;
-  target_idx_high = tile_col + GameMap::TowerTileWidth;
-  // reduce iteration count by 1 on both sides to avoid duplicates
-  for (int row = tile_row; row < tile_row + GameMap::TowerTileHeight; ++row) {
-    if (row >= 0 && row < GameMap::MAP_HEIGHT) {
-      if (target_idx_low >= 0) {
-        bfs_tiles.push(map.get_tile(target_idx_low, row));
-        visited_tiles.emplace(std::make_pair(row, target_idx_low), true);
-      }
-
-      if (target_idx_high < GameMap::MAP_WIDTH) {
-        bfs_tiles.push(map.get_tile(target_idx_high, row));
-        visited_tiles.emplace(std::make_pair(row, target_idx_high), true);
-      }
+  // walk the tiles around the tower, closest first -- the first in range mob
+  // we come across is the closest one (give or take how far the mob is from
+  // its tile center). NOTE: a mob can be up to half a tile diagonal off its
+  // tile center, so we keep going until the tiles can't hold anything in range
+  const float tile_slack = static_cast<float>(
+      0.5 * std::hypot(GameMap::NormFactorWidth, GameMap::NormFactorHeight));
+  const float reach = tower->get_attack_range() + tile_slack;
+  const float reach_sq = reach * reach;
+  const int center_col =
+      t_col * GameMap::TowerTileWidth + GameMap::TowerTileWidth / 2;
+  const int center_row =
+      t_row * GameMap::TowerTileHeight + GameMap::TowerTileHeight / 2;
+  for (const auto &stencil_tile : target_stencil) {
+    // nothing else is in range
+    if (stencil_tile.distance_sq >= reach_sq) {
+      break;
     }
-  }
 
-  while (!bfs_tiles.empty()) {
-    auto target_tile = bfs_tiles.top();
-    bfs_tiles.pop();
-
-    // found a tile with mobs. Need to select the closest one to target
-    if (!target_tile->resident_mobs.empty()) {
-      auto t_dist = L2dist(target_tile->tile_center.row - tile_center.row,
-                           target_tile->tile_center.col - tile_center.col);
-      std::cout << "Suitable tile @ [" << target_tile->idx_location.row << ", "
-                << target_tile->idx_location.col << "] -- has "
-                << target_tile->resident_mobs.size() << " #resident mobs @ "
-                << t_dist << " units away" << std::endl;
-
-      // TODO: for now we just take an arbitrary mob within the tile -- we loop
-      // over the mobs in the tile until we find a valid one (i.e. it's possible
-      // for the mob pointer to have been invalidated prior to this.. I think?)
-      auto target_mob_it = target_tile->resident_mobs.begin();
-      while (target_mob_it != target_tile->resident_mobs.end()) {
-        if (auto target_mob = target_mob_it->lock()) {
-          tower->set_target(target_mob);
-          return true;
-        }
-        target_mob_it++;
-      }
+    const int tile_col = center_col + stencil_tile.col_offset;
+    const int tile_row = center_row + stencil_tile.row_offset;
+    if (tile_row < 0 || tile_row >= GameMap::MAP_HEIGHT || tile_col < 0 ||
+        tile_col >= GameMap::MAP_WIDTH) {
+      continue;
     }
 
-    // add the 8 neighbors of the current tile (if in range)
-    for (int n_row = target_tile->idx_location.row - 1;
-         n_row <= target_tile->idx_location.row + 1; ++n_row) {
-      for (int n_col = target_tile->idx_location.col - 1;
-           n_col <= target_tile->idx_location.col + 1; ++n_col) {
-        // boundary checks -- can't exceed map dimensions
-        if (n_row < 0 || n_row >= GameMap::MAP_HEIGHT || n_col < 0 ||
-            n_col >= GameMap::MAP_WIDTH)
-          continue;
-
-        // dont examine tiles that have already been seen
-        auto tile_it = visited_tiles.find(std::make_pair(n_row, n_col));
-        if (tile_it != visited_tiles.end())
-          continue;
-
-        // boundary checks -- see if the targets are within range.
-        // TODO: decide on a better/more precise distance measure. We are just
-        // comparing the middle of the tiles, which isn't as accurate as it
-        // could be. i.e. we could compare from the edge of the tower, or
-        // compare to the actual mobs IN the tile (i.e. we'll have mobs resident
-        // on the
-        // tile, but they might be further than the tile mid-point and hence out
-        // of range)
-        auto t_dist = L2dist(
-            map.get_tile(n_col, n_row)->tile_center.row - tile_center.row,
-            map.get_tile(n_col, n_row)->tile_center.col - tile_center.col);
-        if (!tower->in_range(t_dist))
-          continue;
-
-        bfs_tiles.push(map.get_tile(n_col, n_row));
-        visited_tiles.emplace(std::make_pair(n_row, n_col), true);
+    // TODO: for now we just take the first mob within the tile that's in range
+    for (const uint32_t mob_idx : mob_grid.get_cell_mobs(tile_col, tile_row)) {
+      const float col_diff = live_mobs.pos_col[mob_idx] - tower_center.col;
+      const float row_diff = live_mobs.pos_row[mob_idx] - tower_center.row;
+      if (col_diff * col_diff + row_diff * row_diff < range_sq) {
+        tower->set_target(live_mobs.handle_of(mob_idx));
+        return true;
       }
     }
   }
 
   // nothing was in range, tower has no target
-  tower->reset_target();
   return false;
 }
 
 bool TowerLogic::find_paths(const GameMap::IndexCoordinate spawn_idx,
                             const GameMap::IndexCoordinate dest_idx) {
-  // run the path-finding for the (entire) game maps' current state
-  bool has_valid_path = path_finder(map, spawn_idx, dest_idx);
+  const bool endpoints_changed =
+      !has_path_endpoints || path_spawn.col != spawn_idx.col ||
+      path_spawn.row != spawn_idx.row || path_dest.col != dest_idx.col ||
+      path_dest.row != dest_idx.row;
+  if (endpoints_changed) {
+    set_path_endpoints(spawn_idx, dest_idx);
+  }
 
-  if (has_valid_path) {
-    //@HERE: need to loop through the mobs to get their path lists
-    // TODO: figure out how the mob organization should be -- will we have the
-    // mobs belong to the tiles, or to the central list (live_mobs)?
+  // run the path-finding for the (entire) game maps' current state. NOTE: the
+  // flow field is kept up to date as towers are built and removed, so we only
+  // need to compute it from scratch when the destination changes
+  const bool has_field =
+      path_finder.get_destination() == map.get_tile(dest_idx);
+  bool has_valid_path =
+      has_field ? path_finder.is_reachable(map.get_tile(spawn_idx))
+                : path_finder(map, spawn_idx, dest_idx);
 
-    for (auto mob_it : live_mobs) {
+  if (has_valid_path) {
+    // the mobs don't need their own paths, they just follow the flow field
+    // from whichever tile they're on -- so all we need is to get them onto a
+    // tile first
+    auto spawn_tile = map.get_tile(spawn_idx);
+    for (uint32_t mob_idx = 0; mob_idx < live_mobs.size(); ++mob_idx) {
       // get the mob's tile index coordinate
-      auto mob_pos = mob_it->get_position();
-      auto mob_tile = map.get_tile(mob_pos.col, mob_pos.row);
-      // get the mob path list...
-      // auto mob_path = path_finder.get_path(mob_tile);
-      //... and set the mob path
-      mob_it->set_path(path_finder.get_path(mob_tile));
+      auto mob_tile =
+          map.get_tile(map.get_nearest_tile(live_mobs.get_position(mob_idx)));
+      // NOTE: the spawn offsets can put the mob on an obstructed tile, in which
+      // case it goes back to the spawn tile
+      if (!path_finder.is_reachable(mob_tile)) {
+        mob_tile = spawn_tile;
+      }
+      live_mobs.set_destination(mob_idx, mob_tile);
+      live_mobs.path_changed[mob_idx] = true;
     }
   }
 
@@ -374,191 +451,251 @@ bool TowerLogic::find_paths(const GameMap::IndexCoordinate spawn_idx,
 
 void TowerLogic::cycle_update_attacks(const uint64_t onset_timestamp) {
   // cycle through the attacks and remove the finished ones
-  auto attack_it = active_attacks.begin();
-  while (attack_it != active_attacks.end()) {
+  active_attacks.remove_if([this](const TowerAttackBase &attack) {
     // get rid of attacks that are out of bounds (e.g. if they missed)
-    if (!(*attack_it)->in_bounds()) {
+    if (!attack.in_bounds()) {
       // signal the frontend to remove the attack
-      std::unique_ptr<RenderEvents::remove_attack> t_evt =
-          std::unique_ptr<RenderEvents::remove_attack>(
-              new RenderEvents::remove_attack((*attack_it)->get_id()));
-      td_frontend_events->add_removeatk_event(std::move(t_evt));
+      td_frontend_events->add_removeatk_event(
+          RenderEvents::remove_attack(attack.get_id()));
 
       // remove the attack internally
-      attack_it = active_attacks.erase(attack_it);
-      continue;
+      return true;
     }
 
-	//TODO: is there a way to detect here if the target is dead / gone?
+    // TODO: is there a way to detect here if the target is dead / gone?
 
     // what other things to check? --> collisions, timers (e.g. if the attack
     // explodes after N seconds), etc.
-    if ((*attack_it)->hit_target()) {
-      // std::cout << "Attack " << (*attack_it)->get_id() << " hit target!" <<
-      // std::endl;
-
-      // call the logic for the tower attack hitting the mob -- if there's
-      // multiple mobs in a tile, how do we choose which one it hits? if it has
-      // a pre-defined target, then the attack should hit that target. if it
-      // hits a tile with mob(s), but where it's target is not among them...
-      // then we have a stranger case (not sure what to do then)
-      auto hit_tile =
-          map.get_tile(map.get_bounding_tile((*attack_it)->get_position()));
-      auto resident_mobs = hit_tile->resident_mobs;
-      if (hit_tile->resident_mobs.size() > 0) {
-        // if only 1 mob, then that's the target. What do we do if there's more
-        // than 1?
-        std::cout << "hit tile had " << hit_tile->resident_mobs.size()
-                  << " #mobs" << std::endl;
-
-        // apply the attack modifiers for this turn -- NOTE: we only need to
-        // APPLY them if the attack hits, but we need to decrement the lifespan
-        // of the statuses regardless
-
-        // NOTE: we assume here that the attack object isn't needed after it
-        // hits its target
-        // TODO: introduce a mechanism for attacks to spawn new attacks (i.e. if
-        // we have a piercing attack, or one that does a fan-of-knives type
-        // on-hit effect)
-
-        // we would trigger the attack on-hit animation here...
-        //... but instead, signal the frontend to remove the attack
-        std::unique_ptr<RenderEvents::remove_attack> t_evt =
-            std::unique_ptr<RenderEvents::remove_attack>(
-                new RenderEvents::remove_attack((*attack_it)->get_id()));
-        td_frontend_events->add_removeatk_event(std::move(t_evt));
-
-        compute_attackhit(resident_mobs, std::move(*attack_it));
-
-        // remove the attack internally
-        attack_it = active_attacks.erase(attack_it);
-        continue;
-
-        // TODO: once we have the mob to attack, we need to perform the on-hit
-        // logic. This means calculating the damage dealt to the mob by the
-        // attack, and updating any side-effects (i.e. on-hit effects, status
-        // updates for tower/mob/player, etc)
-        //...
-        //
-      } else {
-        // TODO: we need tp update the Gamemap's tiles when the mob crosses over
-        // the tile boundaries
-        std::cout << "NOTE: target location [" << hit_tile->tile_center.col
-                  << ", " << hit_tile->tile_center.row << "] had no targets"
-                  << std::endl;
-        for (auto mob_it : live_mobs) {
-          auto mob_pos = mob_it->get_position();
-          std::cout << "mob " << mob_it->get_name() << " at [" << mob_pos.col
-                    << ", " << mob_pos.row << "]" << std::endl;
-        }
+    if (!attack.hit_target()) {
+      return false;
+    }
 
-        std::unique_ptr<RenderEvents::remove_attack> t_evt =
-            std::unique_ptr<RenderEvents::remove_attack>(
-                new RenderEvents::remove_attack((*attack_it)->get_id()));
-        td_frontend_events->add_removeatk_event(std::move(t_evt));
-        // remove the attack internally
-        attack_it = active_attacks.erase(attack_it);
-        continue;
+    // call the logic for the tower attack hitting the mob -- if there's
+    // multiple mobs in a tile, how do we choose which one it hits? if it has
+    // a pre-defined target, then the attack should hit that target. if it
+    // hits a tile with mob(s), but where it's target is not among them...
+    // then we have a stranger case (not sure what to do then)
+    auto hit_position = attack.get_position();
+    auto hit_mobs = mob_grid.get_cell_mobs(hit_position);
+    if (hit_mobs.size() > 0) {
+      // if only 1 mob, then that's the target. What do we do if there's more
+      // than 1?
+      TD_LOG(Trace, "attack_hit", Logging::kv("attack_id", attack.get_id()),
+             Logging::kv("num_mobs", hit_mobs.size()));
+
+      // apply the attack modifiers for this turn -- NOTE: we only need to
+      // APPLY them if the attack hits, but we need to decrement the lifespan
+      // of the statuses regardless
+
+      // NOTE: we assume here that the attack object isn't needed after it
+      // hits its target
+      // TODO: introduce a mechanism for attacks to spawn new attacks (i.e. if
+      // we have a piercing attack, or one that does a fan-of-knives type
+      // on-hit effect)
+
+      // we would trigger the attack on-hit animation here...
+      //... but instead, signal the frontend to remove the attack
+      td_frontend_events->add_removeatk_event(
+          RenderEvents::remove_attack(attack.get_id()));
+
+      queue_attackhit(attack_hits, live_mobs, hit_mobs, attack, random_engine);
+    } else {
+      TD_LOG(Debug, "attack_missed", Logging::kv("attack_id", attack.get_id()),
+             Logging::kv("col", hit_position.col),
+             Logging::kv("row", hit_position.row));
+      for (size_t mob_idx = 0; mob_idx < live_mobs.size(); ++mob_idx) {
+        TD_LOG(Trace, "mob_position",
+               Logging::kv("mob_id", live_mobs.ids[mob_idx]),
+               Logging::kv("col", live_mobs.pos_col[mob_idx]),
+               Logging::kv("row", live_mobs.pos_row[mob_idx]));
       }
+
+      td_frontend_events->add_removeatk_event(
+          RenderEvents::remove_attack(attack.get_id()));
     }
 
-    attack_it++;
-  }
+    // remove the attack internally
+    return true;
+  });
+
+  // compute and apply the damage for all of this tick's hits at once
+  resolve_attackhits(attack_hits, live_mobs);
 }
 
 void TowerLogic::cycle_update_towers(const uint64_t onset_timestamp) {
-  // perform the tower updates
+  int num_towers = 0;
   for (int t_row = 0; t_row < TLIST_HEIGHT; ++t_row) {
+    for (int t_col = 0; t_col < TLIST_WIDTH; ++t_col) {
+      num_towers += t_list[t_row][t_col] != nullptr;
+    }
+  }
+  if (num_towers == 0) {
+    return;
+  }
+
+  // perform the tower updates, 1 task per tower row. The towers only touch
+  // their own state and the (read-only) mob state, and the attacks and events
+  // go into per-row buffers -- so it doesn't matter which thread does which row
+  auto update_row = [this, onset_timestamp](const size_t t_row) {
     for (int t_col = 0; t_col < TLIST_WIDTH; ++t_col) {
       if (t_list[t_row][t_col] != nullptr) {
-        // TODO: apply updates and trigger attack if ready and mob in range
-        //...
-        //
-
-        bool debug_trigger = onset_timestamp % 30 == 0;
-
-        // trigger attack if mob in range (ignoring attack speed, user-specified
-        // targetting, and prior targets
-        bool mob_in_range =
-            get_targets(t_list[t_row][t_col].get(), t_col, t_row);
-        if (mob_in_range && debug_trigger) {
-          // spawn attack -- will need to take attack speed into account (maybe
-          // prior to checking the range?)
-
-          const uint32_t origin_tower_id = t_list[t_row][t_col]->get_id();
-          const std::string origin_tower_name =
-              t_list[t_row][t_col]->get_name();
-          const std::string attack_id =
-              origin_tower_name + "_attack_" + std::to_string(onset_timestamp);
-
-          // get the normalized position of the target -- convert to tile
-          // position
-          auto attack_target = t_list[t_row][t_col]->get_target();
-
-          auto mob_pos = attack_target->get_position();
-          const int mob_tile_row =
-              std::floor(mob_pos.row / GameMap::NormFactorHeight);
-          const int mob_tile_col =
-              std::floor(mob_pos.col / GameMap::NormFactorWidth);
-          std::vector<float> target{static_cast<float>(mob_tile_col),
-                                    static_cast<float>(mob_tile_row), 0.0f};
-
-          // make the attack generation event
-          std::unique_ptr<RenderEvents::create_attack> t_evt =
-              std::unique_ptr<RenderEvents::create_attack>(
-                  new RenderEvents::create_attack(attack_id, origin_tower_id,
-                                                  origin_tower_name,
-                                                  std::move(target)));
-          td_frontend_events->add_makeatk_event(std::move(t_evt));
-
-          // what parameters to have? perhaps a name and a timestamp?
-          auto t_attack =
-              t_list[t_row][t_col]->generate_attack(attack_id, onset_timestamp);
-          t_attack->set_target(Coordinate<float>(mob_pos.col, mob_pos.row));
-          active_attacks.emplace_back(std::move(t_attack));
-        }
+        update_tower(t_row, t_col, onset_timestamp, tower_buffers[t_row]);
       }
     }
+  };
+  // NOTE: not worth waking the workers up for just a few towers
+  if (static_cast<size_t>(num_towers) >= parallel_tower_threshold) {
+    tower_workers->run(TLIST_HEIGHT, update_row);
+  } else {
+    for (int t_row = 0; t_row < TLIST_HEIGHT; ++t_row) {
+      update_row(t_row);
+    }
+  }
+
+  // merge the buffers in tower order, which gives the same attack and event
+  // order as updating the towers serially would
+  for (auto &buffer : tower_buffers) {
+    for (const auto &t_evt : buffer.attack_events) {
+      td_frontend_events->add_makeatk_event(t_evt);
+    }
+    for (const auto &t_evt : buffer.attack_paths) {
+      td_frontend_events->add_attackpath_event(t_evt);
+    }
+    buffer.attack_events.clear();
+    buffer.attack_paths.clear();
+    active_attacks.append(buffer.attacks);
   }
 }
 
-void TowerLogic::cycle_update_mobs(const uint64_t onset_timestamp) {
-  auto remove_mob_fcn = [this](std::shared_ptr<Monster> mob) {
-    // spawn a mob removal event
-    std::unique_ptr<RenderEvents::remove_mob> m_evt =
-        std::unique_ptr<RenderEvents::remove_mob>(
-            new RenderEvents::remove_mob(mob->get_name()));
-    this->td_frontend_events->add_removemob_event(std::move(m_evt));
-    // also notify the mob's containing tile (TODO: make this part happen
-    // automatically?)
-    this->map.remove_mob(mob->get_position(), mob->get_name());
-    // TODO: also have to remove the mob from all of the Tower objects holding
-    // it. Need to set up some event notification system
-    mob->set_position(Coordinate<float>(1.1f, 1.1f));
-  };
+void TowerLogic::update_tower(const int t_row, const int t_col,
+                              const uint64_t onset_timestamp,
+                              TowerPhaseBuffer &buffer) {
+  Tower *tower = t_list[t_row][t_col].get();
+  // TODO: apply updates and trigger attack if ready and mob in range
+  //...
+  //
+
+  bool debug_trigger = onset_timestamp % 30 == 0;
+
+  // trigger attack if mob in range (ignoring attack speed, user-specified
+  // targetting, and prior targets
+  bool mob_in_range = get_targets(tower, t_col, t_row);
+  if (mob_in_range && debug_trigger) {
+    // spawn attack -- will need to take attack speed into account (maybe
+    // prior to checking the range?)
+
+    const uint32_t origin_tower_id = tower->get_id();
+    const uint32_t attack_id =
+        make_attack_id(t_row, t_col, tower->count_attack());
+
+    // get the normalized position of the target -- convert to tile
+    // position
+    auto attack_target = tower->get_target_handle();
+
+    auto mob_pos = live_mobs.get_position(live_mobs.index_of(attack_target));
+    const int mob_tile_row = std::floor(mob_pos.row / GameMap::NormFactorHeight);
+    const int mob_tile_col = std::floor(mob_pos.col / GameMap::NormFactorWidth);
+
+    // make the attack generation event
+    buffer.attack_events.emplace_back(attack_id, origin_tower_id,
+                                      static_cast<float>(mob_tile_col),
+                                      static_cast<float>(mob_tile_row), 0.0f);
+
+    // what parameters to have? perhaps a name and a timestamp?
+    auto &t_attack = tower->generate_attack(buffer.attacks, attack_id,
+                                            onset_timestamp, &live_mobs);
+    t_attack.set_target(Coordinate<float>(mob_pos.col, mob_pos.row));
+
+    // the frontend moves the attack along on its own from here
+    auto attack_pos = t_attack.get_position();
+    buffer.attack_paths.emplace_back(
+        attack_id, origin_tower_id, attack_pos.col, attack_pos.row, mob_pos.col,
+        mob_pos.row, live_mobs.ids[live_mobs.index_of(attack_target)],
+        t_attack.get_move_speed(), onset_timestamp, ATTACK_MOVE_INTERVAL);
+  }
+}
+
+void TowerLogic::remove_mob(const uint32_t mob_idx) {
+  // spawn a mob removal event
+  td_frontend_events->add_removemob_event(
+      RenderEvents::remove_mob(live_mobs.ids[mob_idx]));
+
+  // NOTE: the towers and attacks only hold handles to the mob, which will no
+  // longer be valid after this
+  live_mobs.remove(live_mobs.handle_of(mob_idx));
+}
 
+void TowerLogic::send_mob_path(const uint32_t mob_idx,
+                               const uint64_t start_timestamp) {
+  td_frontend_events->add_mobpath_event(RenderEvents::mob_path(
+      live_mobs.ids[mob_idx], live_mobs.pos_col[mob_idx],
+      live_mobs.pos_row[mob_idx], live_mobs.speed[mob_idx], start_timestamp));
+
+  // the mob heads for its destination tile, then follows the flow field from
+  // there (until it reaches the destination, or gets stuck)
+  const MapTile *path_tile = live_mobs.dest_tiles[mob_idx];
+  while (path_tile != nullptr) {
+    td_frontend_events->add_mobpath_waypoint(path_tile->tile_center.col,
+                                             path_tile->tile_center.row);
+    path_tile = path_tile == path_finder.get_destination()
+                    ? nullptr
+                    : path_finder.get_next_tile(path_tile);
+  }
+}
+
+void TowerLogic::cycle_update_mobs(const uint64_t onset_timestamp) {
   // update the monster positions, update the frontend (these are the mobs that
-  // weren't killed in the above attack logic loop)
-  auto mob_it = live_mobs.begin();
-  while (mob_it != live_mobs.end()) {
+  // weren't killed in the above attack logic loop). NOTE: removing a mob swaps
+  // the last mob into its index, so we don't advance the index in that case
+  uint32_t mob_idx = 0;
+  while (mob_idx < live_mobs.size()) {
 
     // check if the mob is dead; if so, remove it
-    if (!(*mob_it)->is_alive()) {
-      std::cout << "NOTE: mob " << (*mob_it)->get_name() << " is dead"
-                << std::endl;
-      remove_mob_fcn(*mob_it);
-      mob_it = live_mobs.erase(mob_it);
+    if (!live_mobs.is_alive(mob_idx)) {
+      TD_LOG(Debug, "mob_died", Logging::kv("mob_id", live_mobs.ids[mob_idx]));
+      remove_mob(mob_idx);
+      num_mobs_killed++;
       continue;
     }
 
-    // get the amount the attack should move. Will probably need some
-    // time-element
-    auto mob_movement_info = (*mob_it)->move_update(onset_timestamp);
+    float nx_factor = live_mobs.dest_col[mob_idx] - live_mobs.pos_col[mob_idx];
+    float ny_factor = live_mobs.dest_row[mob_idx] - live_mobs.pos_row[mob_idx];
+    float target_dist =
+        std::sqrt(nx_factor * nx_factor + ny_factor * ny_factor);
+    const float mob_speed = live_mobs.speed[mob_idx];
+
+    bool hit_destination = false;
+    // check if we reached the current destination
+    if (target_dist <= mob_speed) {
+      live_mobs.pos_col[mob_idx] = live_mobs.dest_col[mob_idx];
+      live_mobs.pos_row[mob_idx] = live_mobs.dest_row[mob_idx];
+
+      // get the next destination from the flow field
+      const MapTile *reached_tile = live_mobs.dest_tiles[mob_idx];
+      if (reached_tile != nullptr) {
+        if (reached_tile == path_finder.get_destination()) {
+          TD_LOG(Debug, "mob_arrived",
+                 Logging::kv("mob_id", live_mobs.ids[mob_idx]));
+          hit_destination = true;
+        } else if (auto next_tile = path_finder.get_next_tile(reached_tile)) {
+          // TODO: move the leftover distance along the new trajectory -- it's
+          // possible that the mob moves very fast, and we cover multiple
+          // destinations in one cycle
+          live_mobs.set_destination(mob_idx, next_tile);
+        }
+        // NOTE: otherwise the mob is walled in, nothing to do but wait
+      }
+    } else {
+      float dist_mag = mob_speed / target_dist;
+      live_mobs.pos_col[mob_idx] += nx_factor * dist_mag;
+      live_mobs.pos_row[mob_idx] += ny_factor * dist_mag;
+    }
+
     // check if the mob is at the destination; if so, remove it and enact the
     // requisite game state changes
-    if (std::get<1>(mob_movement_info)) {
-      remove_mob_fcn(*mob_it);
-      mob_it = live_mobs.erase(mob_it);
+    if (hit_destination) {
+      remove_mob(mob_idx);
+      num_mobs_leaked++;
 
       // reduce the player #lives
       player_state.lose_life();
@@ -566,44 +703,207 @@ void TowerLogic::cycle_update_mobs(const uint64_t onset_timestamp) {
       // TODO: anything else to do here? -- a mob made it to the exit
 
     } else {
-      auto mob_movement = std::get<0>(mob_movement_info);
-      const std::vector<float> movement{mob_movement.col, mob_movement.row,
-                                        0.0f};
-      auto mob_id = (*mob_it)->get_name();
-      auto m_evt = std::unique_ptr<RenderEvents::move_mob>(
-          new RenderEvents::move_mob(mob_id, movement, 150.0f));
-      td_frontend_events->add_movemob_event(std::move(m_evt));
-      mob_it++;
+      // the frontend moves the mob along its path on its own, so we only need
+      // to send it when it changes
+      if (live_mobs.path_changed[mob_idx]) {
+        send_mob_path(mob_idx, onset_timestamp + 1);
+        live_mobs.path_changed[mob_idx] = false;
+      }
+      mob_idx++;
     }
   }
 }
 
 // NOTE: we might want to return a list of generated tower attacks from here?
 void TowerLogic::cycle_update(const uint64_t onset_timestamp) {
+  // the mobs only move in cycle_update_mobs, so the mob tile index built here
+  // is good for the attack collisions and the tower targeting
+  mob_grid.rebuild(live_mobs);
 
   cycle_update_attacks(onset_timestamp);
   cycle_update_towers(onset_timestamp);
   cycle_update_mobs(onset_timestamp);
 
-  // update the attack positions, spawn relevant events for the frontend
-  for (auto attack_it = active_attacks.begin();
-       attack_it != active_attacks.end(); ++attack_it) {
-    // dont need to update the frontent on every cycle (still looks smooth
-    // enough)
-    if (onset_timestamp % 5 == 0) {
-      // get the amount the attack should move
-      auto atk_movement = (*attack_it)->move_update(onset_timestamp);
-      const std::vector<float> movement{atk_movement.col, atk_movement.row,
-                                        0.0f};
-
-      auto attack_id = (*attack_it)->get_id();
-      auto origin_id = (*attack_it)->get_origin_tower()->get_id();
-      auto origin_name = (*attack_it)->get_origin_tower()->get_name();
-
-      auto t_evt = std::unique_ptr<RenderEvents::move_attack>(
-          new RenderEvents::move_attack(attack_id, origin_id, origin_name,
-                                        movement, 150.0f));
-      td_frontend_events->add_moveatk_event(std::move(t_evt));
+  // update the attack positions -- the frontend moves the attacks along on its
+  // own, so we only tell it about the attacks whose target is gone (i.e. that
+  // are no longer homing)
+  if (onset_timestamp % ATTACK_MOVE_INTERVAL == 0) {
+    // NOTE: generic lambda, so each movement policy gets its own loop
+    active_attacks.for_each([this, onset_timestamp](auto &attack) {
+      attack.move_update(onset_timestamp);
+
+      // NOTE: the attack carries on to wherever its target was last
+      auto target_mob = attack.get_target_handle();
+      if (target_mob.is_valid() && !live_mobs.contains(target_mob)) {
+        attack.lose_target();
+        auto attack_pos = attack.get_position();
+        auto target_pos = attack.get_target_position();
+        td_frontend_events->add_attackpath_event(RenderEvents::attack_path(
+            attack.get_id(), attack.get_origin_tower()->get_id(),
+            attack_pos.col, attack_pos.row, target_pos.col, target_pos.row,
+            NameRegistry::INVALID_ID, attack.get_move_speed(),
+            onset_timestamp + 1, ATTACK_MOVE_INTERVAL));
+      }
+    });
+  }
+}
+
+const AttackColumns &TowerLogic::export_attack_columns() {
+  attack_columns.clear();
+  active_attacks.for_each([this](const auto &attack) {
+    using AttackT = typename std::decay<decltype(attack)>::type;
+    const auto attack_pos = attack.get_position();
+    const auto target_pos = attack.get_target_position();
+    attack_columns.ids.push_back(attack.get_id());
+    attack_columns.pos_col.push_back(attack_pos.col);
+    attack_columns.pos_row.push_back(attack_pos.row);
+    attack_columns.target_col.push_back(target_pos.col);
+    attack_columns.target_row.push_back(target_pos.row);
+    attack_columns.move_speed.push_back(attack.get_move_speed());
+
+    const MobHandle target = attack.get_target_handle();
+    attack_columns.target_ids.push_back(
+        live_mobs.contains(target) ? live_mobs.ids[live_mobs.index_of(target)]
+                                   : NameRegistry::INVALID_ID);
+    attack_columns.is_homing.push_back(
+        std::is_same<AttackT, TowerAttack<HomingAttackMovement>>::value);
+  });
+  return attack_columns;
+}
+
+void TowerLogic::write_snapshot(std::vector<uint8_t> &buffer,
+                                const uint64_t timestamp,
+                                const GAME_STATE game_state) const {
+  size_t num_towers = 0;
+  for (int t_row = 0; t_row < TLIST_HEIGHT; t_row++) {
+    for (int t_col = 0; t_col < TLIST_WIDTH; t_col++) {
+      num_towers += t_list[t_row][t_col] ? 1 : 0;
+    }
+  }
+  const auto &inventory = player_state.inventory;
+  const size_t num_items =
+      std::count(inventory.inventory_occupied.begin(),
+                 inventory.inventory_occupied.end(), true);
+
+  Snapshot::Header *header = Snapshot::layout_snapshot(
+      buffer, num_towers, live_mobs.size(), active_attacks.size(), num_items,
+      GameMap::MAP_WIDTH, GameMap::MAP_HEIGHT);
+  header->game_state = static_cast<uint32_t>(game_state);
+  header->timestamp = timestamp;
+  header->num_lives = player_state.num_lives;
+  header->num_essence = player_state.num_essence;
+  header->num_gold = player_state.num_gold;
+
+  // NOTE: the towers are in slot order (row-major)
+  auto snapshot_tower =
+      Snapshot::get_section<Snapshot::Tower>(buffer, header->towers);
+  for (int t_row = 0; t_row < TLIST_HEIGHT; t_row++) {
+    for (int t_col = 0; t_col < TLIST_WIDTH; t_col++) {
+      const Tower *tower = t_list[t_row][t_col].get();
+      if (!tower) {
+        continue;
+      }
+
+      snapshot_tower->id = tower->get_id();
+      snapshot_tower->name_id = entity_names.find(tower->get_name());
+      snapshot_tower->slot_row = static_cast<uint16_t>(t_row);
+      snapshot_tower->slot_col = static_cast<uint16_t>(t_col);
+      snapshot_tower->tier = tower->get_tier_level();
+      const auto tower_pos = tower->get_position();
+      snapshot_tower->col = tower_pos.col;
+      snapshot_tower->row = tower_pos.row;
+      snapshot_tower->num_kills = tower->get_num_kills();
+      snapshot_tower->num_attacks = tower->get_num_attacks();
+
+      const auto &props = tower->get_base_attributes().modifier;
+      for (int elem_idx = 0; elem_idx < Snapshot::NUM_ELEM; elem_idx++) {
+        snapshot_tower->damage_low[elem_idx] =
+            props.damage_value[elem_idx].low;
+        snapshot_tower->damage_high[elem_idx] =
+            props.damage_value[elem_idx].high;
+        snapshot_tower->enhanced_damage[elem_idx] =
+            props.enhanced_damage_value[elem_idx];
+        snapshot_tower->enhanced_damage_affinity[elem_idx] =
+            props.enhanced_damage_affinity[elem_idx];
+        snapshot_tower->added_damage[elem_idx] =
+            props.added_damage_value[elem_idx];
+      }
+      snapshot_tower->armor_pierce_damage = props.armor_pierce_damage;
+      snapshot_tower->enhanced_speed = props.enhanced_speed_value;
+      snapshot_tower->attack_speed = props.attack_speed_value;
+      snapshot_tower->attack_range = props.attack_range_value;
+      snapshot_tower->crit_chance = props.crit_chance_value;
+      snapshot_tower->crit_multiplier = props.crit_multiplier_value;
+      snapshot_tower++;
+    }
+  }
+
+  // NOTE: the mobs are in the MobTable's (dense) order
+  auto snapshot_mobs =
+      Snapshot::get_section<Snapshot::Mob>(buffer, header->mobs);
+  for (uint32_t mob_idx = 0; mob_idx < live_mobs.size(); mob_idx++) {
+    Snapshot::Mob &mob = snapshot_mobs[mob_idx];
+    mob.name_id = live_mobs.ids[mob_idx];
+    mob.model_id = static_cast<uint32_t>(live_mobs.model_ids[mob_idx]);
+    mob.col = live_mobs.pos_col[mob_idx];
+    mob.row = live_mobs.pos_row[mob_idx];
+    mob.dest_col = live_mobs.dest_col[mob_idx];
+    mob.dest_row = live_mobs.dest_row[mob_idx];
+    mob.speed = live_mobs.speed[mob_idx];
+    mob.health = live_mobs.health[mob_idx];
+    mob.flat_armor = live_mobs.flat_armor[mob_idx];
+    mob.percent_armor = live_mobs.percent_armor[mob_idx];
+    mob.thresh_armor = live_mobs.thresh_armor[mob_idx];
+    mob.armor_class = static_cast<uint32_t>(live_mobs.armor_class[mob_idx]);
+  }
+
+  auto snapshot_attack =
+      Snapshot::get_section<Snapshot::Attack>(buffer, header->attacks);
+  active_attacks.for_each([this, &snapshot_attack](const auto &attack) {
+    using AttackT = typename std::decay<decltype(attack)>::type;
+    // the origin tower might have been removed since, so we go by the attack ID
+    // (which has the tower's slot) rather than the tower pointer
+    const uint32_t tower_slot = attack.get_id() >> ATTACK_COUNT_BITS;
+    snapshot_attack->id = attack.get_id();
+    snapshot_attack->origin_row = static_cast<uint16_t>(tower_slot / TLIST_WIDTH);
+    snapshot_attack->origin_col = static_cast<uint16_t>(tower_slot % TLIST_WIDTH);
+    const auto attack_pos = attack.get_position();
+    const auto target_pos = attack.get_target_position();
+    snapshot_attack->col = attack_pos.col;
+    snapshot_attack->row = attack_pos.row;
+    snapshot_attack->target_col = target_pos.col;
+    snapshot_attack->target_row = target_pos.row;
+    snapshot_attack->move_speed = attack.get_move_speed();
+    snapshot_attack->is_homing =
+        std::is_same<AttackT, TowerAttack<HomingAttackMovement>>::value;
+
+    const MobHandle target = attack.get_target_handle();
+    snapshot_attack->target_name_id =
+        live_mobs.contains(target) ? live_mobs.ids[live_mobs.index_of(target)]
+                                   : Snapshot::INVALID_ID;
+    snapshot_attack++;
+  });
+
+  auto snapshot_item =
+      Snapshot::get_section<Snapshot::Item>(buffer, header->items);
+  for (int slot_idx = 0; slot_idx < PlayerInventory::NUM_INVENTORY_SLOTS;
+       slot_idx++) {
+    if (!inventory.inventory_occupied[slot_idx]) {
+      continue;
+    }
+    const std::string &letter = inventory.inventory_data[slot_idx].letter;
+    snapshot_item->slot = static_cast<uint32_t>(slot_idx);
+    letter.copy(snapshot_item->letter, Snapshot::Item::MAX_LETTER_LEN);
+    snapshot_item++;
+  }
+
+  uint8_t *map_bits = buffer.data() + header->map.offset;
+  for (int row_idx = 0; row_idx < GameMap::MAP_HEIGHT; row_idx++) {
+    for (int col_idx = 0; col_idx < GameMap::MAP_WIDTH; col_idx++) {
+      if (map.is_obstructed(col_idx, row_idx)) {
+        const size_t tile_idx = row_idx * GameMap::MAP_WIDTH + col_idx;
+        map_bits[tile_idx / 8] |= static_cast<uint8_t>(1u << (tile_idx % 8));
+      }
     }
   }
 }
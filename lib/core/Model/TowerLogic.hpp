@@ -9,18 +9,30 @@
 #ifndef TD_TOWER_LOGIC_HPP
 #define TD_TOWER_LOGIC_HPP
 
+#include "AttackLogic.hpp"
+#include "BlockConnectivity.hpp"
 #include "GameMap.hpp"
+#include "GameSnapshot.hpp"
+#include "MobTable.hpp"
 #include "Monster.hpp"
 #include "Pathfinder.hpp"
+#include "RangeStencil.hpp"
+#include "SpatialGrid.hpp"
 #include "TowerModel.hpp"
+#include "WorkerPool.hpp"
 #include "Towers/Tower.hpp"
 #include "Towers/TowerAttack.hpp"
 #include "Events/ViewEventTypes.hpp"
 #include "shared/Player.hpp"
 #include "shared/common_information.hpp"
+#include "util/Logger.hpp"
+#include "util/NameRegistry.hpp"
+#include "util/RandomUtility.hpp"
 #include "util/TDEventTypes.hpp"
 #include "util/Types.hpp"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <list>
 #include <memory>
@@ -41,10 +53,15 @@ public:
       GameMap::MAP_WIDTH / GameMap::TowerTileHeight;
 
   // TODO: need to move the player initial state setting to elsewhere
-  explicit TowerLogic(TDPlayerInformation default_pstate)
-      : player_state(default_pstate) {
+  // NOTE: num_tower_threads is as per set_num_tower_threads
+  explicit TowerLogic(TDPlayerInformation default_pstate,
+                      const size_t num_tower_threads = 1)
+      : has_path_endpoints(false), player_state(default_pstate) {
     // anything else to initialize goes here...
     td_frontend_events = std::unique_ptr<ViewEvents>(new ViewEvents());
+    td_frontend_events->register_entity_names(&entity_names);
+    set_num_tower_threads(num_tower_threads);
+    random_engine.seed(Randomize::make_seed());
 
     /*
     //NOTE: THE FOLLOWING IS FOR TESTING
@@ -57,10 +74,48 @@ public:
     */
   }
 
+  // the damage rolls all come from the game's own engine, s.t. a seeded game
+  // plays out the same regardless of what else is running alongside it
+  void seed_random_engine(const uint32_t seed) { random_engine.seed(seed); }
+  Randomize::EngineType &get_random_engine() { return random_engine; }
+
+  // the towers are only updated in parallel when there's at least this many of
+  // them (0 to always go parallel) -- the results are the same either way
+  void set_parallel_tower_threshold(const size_t num_towers) {
+    parallel_tower_threshold = num_towers;
+  }
+
+  // the #threads for the tower phase, including the game loop thread. NOTE:
+  // defaults to just the game loop thread, i.e. there's no worker pool
+  void set_num_tower_threads(const size_t num_threads) {
+    tower_workers = std::unique_ptr<WorkerPool>(
+        new WorkerPool(std::max<size_t>(num_threads, 1) - 1));
+  }
+
   bool is_obstructed(const int col_coord, const int row_coord) const {
     return map.is_obstructed(col_coord, row_coord);
   }
 
+  // sets where the mobs path from and to, for the build validation
+  void set_path_endpoints(const GameMap::IndexCoordinate spawn_idx,
+                          const GameMap::IndexCoordinate dest_idx) {
+    path_spawn = spawn_idx;
+    path_dest = dest_idx;
+    has_path_endpoints = true;
+    path_connectivity.rebuild(map, path_spawn, path_dest);
+  }
+
+  // true if building a tower at the location would cut off every path from
+  // the spawn to the destination. NOTE: this is cheap enough to call for every
+  // hovered location (it's just a lookup)
+  bool blocks_path(const float x_coord, const float y_coord) const {
+    auto tower_block = map.get_tower_block(x_coord, y_coord);
+    if (std::get<0>(tower_block.row) < 0 || std::get<0>(tower_block.col) < 0) {
+      return false;
+    }
+    return path_connectivity.blocks_path(tower_block);
+  }
+
   void register_shared_info(
       std::shared_ptr<
           GameInformation<CommonTowerInformation, TDPlayerInformation>>
@@ -93,9 +148,6 @@ public:
     const float mob_row = mobtile_center.row + spawn_offset.row;
     const float mob_col = mobtile_center.col + spawn_offset.col;
 
-    // should be {x, y, z} --> hence at creation it's {col, row, z}
-    std::vector<float> map_offsets{mob_col, mob_row, 0};
-
     // TODO: use the mob_id to dispatch the appropriate monster creation (will
     // need some factory for this)
     const std::string mob_fpath{TDHelpers::get_basepath() +
@@ -103,21 +155,16 @@ public:
     std::vector<std::shared_ptr<Monster>> mobs =
         parse_monster(mob_fpath, mob_name, 1);
     for (auto& mob : mobs) {
-        mob->set_position(Coordinate<float>(mob_col, mob_row));
-
-        // NOTE: should we have the mobs duplicated like this? --> probably not,
-        // makes no sense to maintain 2 lists of mobs for TowerLogic and the tiles.
-        // If anything, we should have 1 list, and have the other reference said
-        // list
-        mtile->resident_mobs.push_back(mob);
-        live_mobs.push_back(mob);
+        // the name is only needed by the frontend, we go by the ID from here on
+        const uint32_t mob_name_id = entity_names.intern(mob->get_name());
+        live_mobs.add_mob(mob_id, mob_name_id, mob->get_attributes(),
+                          Coordinate<float>(mob_col, mob_row));
         // TODO: anything else we need to do here?
 
-        // notify the frontend that a mob has been made
-        std::unique_ptr<RenderEvents::create_mob> m_evt =
-            std::unique_ptr<RenderEvents::create_mob>(new RenderEvents::create_mob(
-                mob_id, mob->get_name(), std::move(map_offsets)));
-        td_frontend_events->add_makemob_event(std::move(m_evt));
+        // notify the frontend that a mob has been made -- NOTE: the offsets
+        // should be {x, y, z} --> hence at creation it's {col, row, z}
+        td_frontend_events->add_makemob_event(RenderEvents::create_mob(
+            mob_id, mob_name_id, mob_col, mob_row, 0.0f));
     }
   }
 
@@ -125,6 +172,47 @@ public:
   bool make_tower(const uint32_t ID, const int tier, const float x_coord,
                   const float y_coord);
 
+  /*
+   * applies a batch of commands (see command_batch_event) in 1 pass, returns
+   * how many of them went through. The mob rerouting that building needs is
+   * done once for the whole batch, rather than after every tower. NOTE: the
+   * path cuts are still updated after every build, s.t. the builds within a
+   * batch can't wall off the mobs between them either
+   */
+  template <typename ModifierT>
+  size_t apply_commands(const std::vector<UserTowerEvents::tower_command> &commands,
+                        const std::vector<ModifierT> &modifiers) {
+    using CommandKind = UserTowerEvents::tower_command::Kind;
+    size_t num_applied = 0;
+    defer_map_updates = true;
+    for (const auto &command : commands) {
+      bool applied = false;
+      switch (static_cast<CommandKind>(command.kind)) {
+      case CommandKind::Build:
+        applied = make_tower(command.arg, command.tier, command.col, command.row);
+        break;
+      case CommandKind::Modify:
+        applied = command.arg < modifiers.size() &&
+                  modify_tower(modifiers[command.arg], command.col, command.row);
+        break;
+      case CommandKind::Target:
+        applied = tower_target(command.col, command.row, command.target_col,
+                               command.target_row);
+        break;
+      default:
+        TD_LOG(Warn, "unknown_command", Logging::kv("kind", command.kind));
+        break;
+      }
+      num_applied += applied ? 1 : 0;
+    }
+    defer_map_updates = false;
+    if (map_updates_pending) {
+      map_updates_pending = false;
+      reroute_mobs();
+    }
+    return num_applied;
+  }
+
   bool modify_tower(tower_properties props, const float x_coord,
                     const float y_coord);
   bool modify_tower(tower_property_modifier modifier, const float x_coord,
@@ -142,18 +230,36 @@ public:
 
   void cycle_update(const uint64_t onset_timestamp);
 
+  // writes the current game state into the buffer, in the GameSnapshot format.
+  // NOTE: the buffer is overwritten, but its capacity gets reused -- so keep
+  // passing in the same buffer to avoid allocating on every snapshot
+  void write_snapshot(std::vector<uint8_t> &buffer, const uint64_t timestamp,
+                      const GAME_STATE game_state) const;
+
   inline int get_num_live_mobs() const { return live_mobs.size(); }
+  inline const MobTable &get_live_mobs() const { return live_mobs; }
+  // flattens the in-flight attacks into columns. NOTE: the columns are reused,
+  // so they're only good until the next call (or the next cycle)
+  const AttackColumns &export_attack_columns();
+  inline const NameRegistry &get_entity_names() const { return entity_names; }
 
   // for the end of the round -- clean all the state (i.e. live mobs, status
   // effects, map tile mobs, etc)
   void reset_state() {
     if (live_mobs.size() > 0) {
-      std::cout << "mobs still around?" << std::endl;
+      TD_LOG(Warn, "mobs_left_over", Logging::kv("num_mobs", live_mobs.size()));
     }
     live_mobs.clear();
+    mob_grid.rebuild(live_mobs);
     active_attacks.clear();
   }
 
+  // back to the start of a new game -- clears out the towers and the round
+  // state, and gives the player the given state. The tower models, names and
+  // path endpoints are kept, s.t. the game doesn't have to be rebuilt. NOTE:
+  // the frontend isn't told about the removed towers (it's for headless games)
+  void reset_game(const TDPlayerInformation &pstate);
+
   // NOTE: this is called when moving from active to idle state
   void enter_idle_state() {
     reset_state();
@@ -235,6 +341,26 @@ public:
   }
 
   inline TDPlayerInformation get_player_state() const { return player_state; }
+  // NOTE: unlike get_player_state, doesn't copy the inventory
+  inline const TDPlayerInformation &get_player_info() const {
+    return player_state;
+  }
+
+  // how many mobs have been killed / made it to the destination so far
+  inline uint64_t get_num_mobs_killed() const { return num_mobs_killed; }
+  inline uint64_t get_num_mobs_leaked() const { return num_mobs_leaked; }
+
+  // writes the tier of the tower in each slot (0 if there's none) into the
+  // TLIST_HEIGHT x TLIST_WIDTH (row-major) output
+  template <typename OutputT> void get_tower_tiers(OutputT *tower_tiers) const {
+    for (int t_row = 0; t_row < TLIST_HEIGHT; t_row++) {
+      for (int t_col = 0; t_col < TLIST_WIDTH; t_col++) {
+        const Tower *tower = t_list[t_row][t_col].get();
+        tower_tiers[t_row * TLIST_WIDTH + t_col] =
+            tower ? static_cast<OutputT>(tower->get_tier_level()) : OutputT(0);
+      }
+    }
+  }
 
   // again, we assume the map dimensions and tile dimensions to be even
   // multiples
@@ -244,9 +370,61 @@ public:
       GameMap::MAP_WIDTH / GameMap::TowerTileWidth;
 
 private:
+  // for poking at the internals from the tests
+  friend struct TowerLogicTestAccess;
+
+  // removes the tower at the given location and opens its tiles back up, s.t.
+  // the mobs path through them again. TODO: this is the start of selling the
+  // towers, but there's no refund (the towers don't cost anything yet) and the
+  // frontend doesn't get told to remove the tower model -- so for now it's
+  // only used by the tests
+  bool remove_tower(const float x_coord, const float y_coord);
+
   void cycle_update_attacks(const uint64_t onset_timestamp);
   void cycle_update_towers(const uint64_t onset_timestamp);
+  // what a tower update produces -- buffered, s.t. the towers can be updated in
+  // parallel and still have their outputs merged in a fixed order
+  struct TowerPhaseBuffer {
+    AttackPool attacks;
+    std::vector<RenderEvents::create_attack> attack_events;
+    std::vector<RenderEvents::attack_path> attack_paths;
+  };
+  // targeting and attack generation for the tower at the slot
+  void update_tower(const int t_row, const int t_col,
+                    const uint64_t onset_timestamp, TowerPhaseBuffer &buffer);
   void cycle_update_mobs(const uint64_t onset_timestamp);
+  // removes the mob at the (dense) index, notifies the frontend
+  void remove_mob(const uint32_t mob_idx);
+  // sends the frontend the path that the mob at the (dense) index will follow,
+  // starting from the given tick
+  void send_mob_path(const uint32_t mob_idx, const uint64_t start_timestamp);
+  // points any mobs that lost their path (i.e. after the map changed) back
+  // onto the flow field
+  void reroute_mobs();
+  // whether any of the live mobs are on a tile with no way to the exit (i.e.
+  // one that was just built over or cut off)
+  bool strands_live_mobs() const;
+  // re-derives the path cut information after the obstructions changed
+  void update_connectivity();
+  // the above 2, after a tower was built / removed (unless the rerouting is
+  // deferred to the end of a command batch)
+  void update_map();
+
+  // the attacks are identified by their tower's slot and how many attacks the
+  // tower has made, which doesn't depend on the order that the towers are
+  // updated in. NOTE: the attack count wraps around after 2^26 attacks, but
+  // the tower's older attacks are long gone by then
+  static constexpr uint32_t ATTACK_COUNT_BITS = 26;
+  // the attacks only move every this many ticks
+  static constexpr uint64_t ATTACK_MOVE_INTERVAL = 5;
+  static_assert(TLIST_HEIGHT * TLIST_WIDTH <= (1 << (32 - ATTACK_COUNT_BITS)),
+                "too many tower slots for the attack IDs");
+  static inline uint32_t make_attack_id(const int t_row, const int t_col,
+                                        const uint32_t attack_count) {
+    const uint32_t tower_slot = t_row * TLIST_WIDTH + t_col;
+    return (tower_slot << ATTACK_COUNT_BITS) |
+           (attack_count & ((1u << ATTACK_COUNT_BITS) - 1));
+  }
 
   // handles tower auto-targeting: attacks closest (L2 distance) mob
   bool get_targets(Tower *tower, const int t_col, const int t_row);
@@ -257,6 +435,11 @@ private:
   std::map<std::string, TowerModel> tower_models;
 
   Pathfinder<GameMap> path_finder;
+  // which tower blocks are on every path, for validating tower placements
+  BlockConnectivity<GameMap> path_connectivity;
+  GameMap::IndexCoordinate path_spawn;
+  GameMap::IndexCoordinate path_dest;
+  bool has_path_endpoints;
 
   std::unique_ptr<Tower> t_list[TLIST_HEIGHT][TLIST_WIDTH];
   std::unique_ptr<ViewEvents> td_frontend_events;
@@ -264,9 +447,33 @@ private:
       shared_tower_info;
   TDPlayerInformation player_state;
 
+  // the mob and tower names, interned s.t. everything else can use the IDs
+  NameRegistry entity_names;
   // the set of monsters still among the living
-  std::list<std::shared_ptr<Monster>> live_mobs;
-  std::list<std::unique_ptr<TowerAttackBase>> active_attacks;
+  MobTable live_mobs;
+  // which mobs are in which map tile -- rebuilt at the start of every cycle
+  SpatialGrid<GameMap> mob_grid;
+  // the tiles around a tower slot, closest first (for the targeting)
+  RangeStencil<GameMap> target_stencil;
+  // the in-flight attacks
+  AttackPool active_attacks;
+  // the tower phase's per-row outputs, and the threads to run it on
+  std::array<TowerPhaseBuffer, TLIST_HEIGHT> tower_buffers;
+  std::unique_ptr<WorkerPool> tower_workers;
+  // the minimum #towers for the tower phase to be run in parallel
+  size_t parallel_tower_threshold = 16;
+  // the attacks that hit their targets this cycle, to have their damage
+  // resolved together
+  AttackHitQueue attack_hits;
+  // see seed_random_engine
+  Randomize::EngineType random_engine;
+  uint64_t num_mobs_killed = 0;
+  // set while a command batch is being applied, see update_map
+  bool defer_map_updates = false;
+  bool map_updates_pending = false;
+  uint64_t num_mobs_leaked = 0;
+  // the exported attack state, see export_attack_columns
+  AttackColumns attack_columns;
 };
 
 #endif
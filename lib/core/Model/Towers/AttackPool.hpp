@@ -0,0 +1,182 @@
+/* AttackPool.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_ATTACK_POOL_HPP
+#define TD_ATTACK_POOL_HPP
+
+#include "TowerAttack.hpp"
+
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/*
+ * The in-flight attacks' state, flattened into 1 contiguous column per
+ * attribute (in the pool's iteration order). The pool itself holds the attacks
+ * by value in per-policy arrays, so this is what gets handed out when the
+ * attack state has to be read in bulk (i.e. by the python bindings)
+ */
+struct AttackColumns {
+  void clear() {
+    ids.clear();
+    pos_col.clear();
+    pos_row.clear();
+    target_col.clear();
+    target_row.clear();
+    move_speed.clear();
+    target_ids.clear();
+    is_homing.clear();
+  }
+
+  inline size_t size() const { return ids.size(); }
+
+  std::vector<uint32_t> ids;
+  std::vector<float> pos_col;
+  std::vector<float> pos_row;
+  std::vector<float> target_col;
+  std::vector<float> target_row;
+  std::vector<float> move_speed;
+  // the targeted mob's name ID (NameRegistry::INVALID_ID if the target is
+  // gone)
+  std::vector<uint32_t> target_ids;
+  // NOTE: uint8_t rather than bool, to avoid the vector<bool> specialization
+  std::vector<uint8_t> is_homing;
+};
+
+/*
+ * The in-flight attacks, held by value in 1 contiguous array per movement
+ * policy. The attacks are visited a whole policy array at a time, so the
+ * movement updates are statically dispatched (TowerAttack is final), and the
+ * arrays keep their capacity between waves so spawning an attack doesn't need
+ * a heap allocation of its own.
+ *
+ * NOTE: removal swaps the last attack of the policy into the removed slot, so
+ * the attack order is not stable, and references to the attacks are only good
+ * until the pool is next modified
+ */
+class AttackPool {
+  template <typename MovementT>
+  using attack_array = std::vector<TowerAttack<MovementT>>;
+
+public:
+  template <typename MovementT>
+  TowerAttack<MovementT> &add_attack(TowerAttackParams &&attack_params,
+                                     MovementT &&movement) {
+    auto &attacks = get_attacks<MovementT>();
+    attacks.emplace_back(std::move(attack_params), std::move(movement));
+    return attacks.back();
+  }
+
+  template <typename MovementT> inline attack_array<MovementT> &get_attacks() {
+    return std::get<attack_array<MovementT>>(policy_attacks);
+  }
+
+  template <typename MovementT>
+  inline const attack_array<MovementT> &get_attacks() const {
+    return std::get<attack_array<MovementT>>(policy_attacks);
+  }
+
+  inline size_t size() const {
+    size_t num_attacks = 0;
+    std::apply(
+        [&num_attacks](const auto &... attacks) {
+          ((num_attacks += attacks.size()), ...);
+        },
+        policy_attacks);
+    return num_attacks;
+  }
+
+  inline bool empty() const { return size() == 0; }
+
+  // NOTE: keeps the capacity around for the next wave
+  void clear() {
+    std::apply([](auto &... attacks) { (attacks.clear(), ...); },
+               policy_attacks);
+  }
+
+  // moves all of the other pool's attacks onto the end of this pool's (keeping
+  // their order within each policy), leaving the other pool empty
+  void append(AttackPool &other) {
+    append_policies(other, std::make_index_sequence<std::tuple_size<
+                               decltype(policy_attacks)>::value>{});
+  }
+
+  // calls attack_fn on every attack, one policy at a time. attack_fn gets the
+  // concrete TowerAttack type, so it should be a generic lambda
+  template <typename AttackFn> void for_each(AttackFn attack_fn) {
+    std::apply(
+        [&attack_fn](auto &... attacks) {
+          (for_each_attack(attacks, attack_fn), ...);
+        },
+        policy_attacks);
+  }
+
+  template <typename AttackFn> void for_each(AttackFn attack_fn) const {
+    std::apply(
+        [&attack_fn](const auto &... attacks) {
+          (for_each_attack(attacks, attack_fn), ...);
+        },
+        policy_attacks);
+  }
+
+  // calls remove_fn on every attack, removing those that it returns true for
+  template <typename RemoveFn> void remove_if(RemoveFn remove_fn) {
+    std::apply(
+        [&remove_fn](auto &... attacks) {
+          (remove_attacks(attacks, remove_fn), ...);
+        },
+        policy_attacks);
+  }
+
+private:
+  template <size_t... PolicyIdx>
+  void append_policies(AttackPool &other, std::index_sequence<PolicyIdx...>) {
+    (append_attacks(std::get<PolicyIdx>(policy_attacks),
+                    std::get<PolicyIdx>(other.policy_attacks)),
+     ...);
+  }
+
+  template <typename AttackArrayT>
+  static void append_attacks(AttackArrayT &attacks, AttackArrayT &other) {
+    attacks.insert(attacks.end(), std::make_move_iterator(other.begin()),
+                   std::make_move_iterator(other.end()));
+    // NOTE: keeps the capacity around
+    other.clear();
+  }
+
+  template <typename AttackArrayT, typename AttackFn>
+  static void for_each_attack(AttackArrayT &attacks, AttackFn &attack_fn) {
+    for (auto &attack : attacks) {
+      attack_fn(attack);
+    }
+  }
+
+  template <typename AttackArrayT, typename RemoveFn>
+  static void remove_attacks(AttackArrayT &attacks, RemoveFn &remove_fn) {
+    // NOTE: the last attack gets swapped into the removed slot, so we don't
+    // advance in that case
+    size_t attack_idx = 0;
+    while (attack_idx < attacks.size()) {
+      if (remove_fn(attacks[attack_idx])) {
+        if (attack_idx != attacks.size() - 1) {
+          attacks[attack_idx] = std::move(attacks.back());
+        }
+        attacks.pop_back();
+      } else {
+        attack_idx++;
+      }
+    }
+  }
+
+  std::tuple<attack_array<FixedAttackMovement>,
+             attack_array<HomingAttackMovement>>
+      policy_attacks;
+};
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "TowerCombiner.hpp"
 #include "ModifierConfigParser.hpp"
+#include "util/Logger.hpp"
 
 #include <chrono>
 #include <fstream>
@@ -66,7 +67,7 @@ void load_dictionary(dict_t &dict, const std::string &dictionary_file) {
     dict.emplace(std::make_pair(dict_line, nullptr));
   }
 
-  std::cout << "loaded word dict " << dict.size() << std::endl;
+  TD_LOG(Info, "loaded_dictionary", Logging::kv("num_words", dict.size()));
 }
 
 // computes a word's score based on the scrabble score
@@ -106,8 +107,7 @@ TowerCombiner::make_wordcombination(const std::string &word) const {
   // NOTE: the caller really should check this beforehand, but just have this
   // here for insurance
   if (!check_combination(word)) {
-    std::cout << "ERROR -- word " << word << " not a valid word combo"
-              << std::endl;
+    TD_LOG(Warn, "invalid_combination", Logging::kv("word", word));
     return props;
   }
 
@@ -119,11 +119,12 @@ TowerCombiner::make_wordcombination(const std::string &word) const {
   for (auto word_unit : word) {
     auto modifier_key_it = character_attribute_map.find(word_unit);
     if (modifier_key_it != character_attribute_map.end()) {
-      std::cout << "character " << word_unit << " --> " << std::hex
-                << modifier_key_it->second << std::dec << std::endl;
       auto attribmodifier =
           attribute_fac->create_product(modifier_key_it->second, word_score);
-      std::cout << typeid(*attribmodifier).name() << std::endl;
+      TD_LOG(Trace, "combination_modifier",
+             Logging::kv("character", std::string(1, word_unit)),
+             Logging::kv("modifier_key", modifier_key_it->second),
+             Logging::kv("modifier", typeid(*attribmodifier).name()));
 
       // aggregate the modifier values so we can apply them in a well-ordered
       // manner
@@ -132,7 +133,8 @@ TowerCombiner::make_wordcombination(const std::string &word) const {
   }
 
   props.apply_property_modifier(std::move(stats_modifier));
-  std::cout << "word " << word << " -- properties: " << props << std::endl;
+  TD_LOG(Debug, "made_combination", Logging::kv("word", word),
+         Logging::kv("score", word_score));
 
   return props;
 }
@@ -150,12 +152,9 @@ bool TowerCombiner::check_combination(const std::string &word) const {
   auto lookup_duration = std::chrono::duration_cast<std::chrono::microseconds>(
                              end_timestamp - start_timestamp)
                              .count();
-  std::cout << "dict lookup: " << lookup_duration << " us" << std::endl;
-  if (word_lookup_found) {
-    std::cout << "found " << dict_it->first << std::endl;
-  } else {
-    std::cout << "couldn't find " << word << std::endl;
-  }
+  TD_LOG(Debug, "dictionary_lookup", Logging::kv("word", word),
+         Logging::kv("found", word_lookup_found),
+         Logging::kv("lookup_us", lookup_duration));
 
   return word_lookup_found;
 }
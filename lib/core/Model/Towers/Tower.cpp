@@ -9,6 +9,7 @@
 #include "Tower.hpp"
 
 //#include "StatusEffects.hpp"
+#include "util/Logger.hpp"
 #include "util/RandomUtility.hpp"
 
 #include <iomanip>
@@ -63,19 +64,15 @@ tower_properties Tower::compute_attack_damage() const {
  * or on-death effects). Or rather, maybe we should just have a callback functor
  * that'll be called by the attack object that's a Tower member method?
  */
-std::unique_ptr<TowerAttackBase>
-Tower::generate_attack(const std::string &attack_id, const uint64_t timestamp) {
-  // NOTE: we assume that the tower has a target if it is generating attacks
-  // (NOTE: will not work if we allow say, an 'attack ground' option for splash
-  // towers)
-  const auto mob_id = get_target()->get_name();
+TowerAttackParams Tower::make_attack_params(const uint32_t attack_id,
+                                            const uint64_t timestamp) {
   // reset the (per-cycle) attack atttributes
   attack_attributes = compute_attack_damage();
-  std::cout << "Tower (temporary) properties " << attack_attributes
-            << std::endl;
+  TD_LOG(Trace, "attack_params", Logging::kv("tower", get_name()),
+         Logging::kv("attack_id", attack_id));
 
   // set the attack parameters
-  TowerAttackParams params(attack_attributes, this, attack_id, mob_id);
+  TowerAttackParams params(attack_attributes, this, attack_id);
   // distance the attack can move per round (normalized)
   params.move_speed = 0.15;
 
@@ -83,19 +80,29 @@ Tower::generate_attack(const std::string &attack_id, const uint64_t timestamp) {
   params.origin_timestamp = timestamp;
   // starting location
   params.origin_position = position;
+  return params;
+}
+
+TowerAttackBase &Tower::generate_attack(AttackPool &attacks,
+                                        const uint32_t attack_id,
+                                        const uint64_t timestamp,
+                                        const MobTable *live_mobs) {
+  // NOTE: we assume that the tower has a (live) target if it is generating
+  // attacks (NOTE: will not work if we allow say, an 'attack ground' option for
+  // splash towers)
+  auto params = make_attack_params(attack_id, timestamp);
+  params.target_mob = current_target_handle;
 
   // attack movement type -- homing updates the attack movement wrt a target,
   // while non-homing has an initial destination and moves towards it
   bool has_homing = true;
   // TODO: make a proper factory for generating the appropriate TowerAttacks
   if (has_homing) {
-    return std::unique_ptr<TowerAttackBase>(
-        new TowerAttack<HomingAttackMovement>(
-            std::move(params), HomingAttackMovement(current_target)));
+    return attacks.add_attack(
+        std::move(params),
+        HomingAttackMovement(live_mobs, current_target_handle));
   } else {
-    return std::unique_ptr<TowerAttackBase>(
-        new TowerAttack<FixedAttackMovement>(std::move(params),
-                                             FixedAttackMovement()));
+    return attacks.add_attack(std::move(params), FixedAttackMovement());
   }
 }
 
@@ -212,12 +219,11 @@ void Tower::generate_statuseffects()
         for (auto effect_it : status_effects) {
             if (effect_id == effect_it.id) {
                 new_effect = false;
-                std::cout << "NOTE: stacking effect " << (int)effect_id << " from D: " << effect_it.metadata.life_ticks << std::endl;
-             
                 //TODO: this is more or less a placeholder for the 'real' merging (see the 1-up TODO comment)
                 effect_it.metadata.life_ticks += effect_duration;
                 
-                std::cout << "... to D: " << effect_it.metadata.life_ticks << std::endl;
+                TD_LOG(Debug, "stacked_effect", Logging::kv("effect_id", static_cast<int>(effect_id)),
+                        Logging::kv("life_ticks", effect_it.metadata.life_ticks));
             }
         }
 
@@ -244,7 +250,8 @@ bool Tower::add_modifier(tower_generator tower_gen, essence* modifier)
     if(mod_count >= get_tier(tier))
     {
         //TODO: also want to generate an error message for the backend error queue
-        std::cout << "Too many modifiers for the tier!" << std::endl;
+        TD_LOG(Warn, "too_many_modifiers", Logging::kv("tower", get_name()),
+                Logging::kv("num_modifiers", mod_count));
         return false;
     }
 
@@ -280,11 +287,13 @@ bool Tower::add_modifier(tower_generator tower_gen, essence* modifier)
             break;
             */
         default:
-            std::cout << "Problem @ Tower Modification -- " << mod_count << " #essences" << std::endl;
+            TD_LOG(Warn, "bad_modifier_count", Logging::kv("tower", get_name()),
+                    Logging::kv("num_modifiers", mod_count));
     }
 
     attack_attributes = working_properties + base_attributes;
-    std::cout << "Modified Tower: " << attack_attributes << std::endl;
+    TD_LOG(Info, "tower_modified", Logging::kv("tower", get_name()),
+            Logging::kv("num_modifiers", mod_count));
     return true;
 }
 
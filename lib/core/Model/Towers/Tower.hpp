@@ -9,9 +9,12 @@
 #ifndef TD_TOWER_HPP
 #define TD_TOWER_HPP
 
+#include "MobHandle.hpp"
+#include "AttackPool.hpp"
 #include "TowerAttack.hpp"
 #include "TowerModel.hpp"
 #include "util/Elements.hpp"
+#include "util/Logger.hpp"
 #include "util/Types.hpp"
 
 //#include "TowerProperties.hpp"
@@ -62,10 +65,11 @@ public:
         const std::string &name, const int tier_roll, const float row,
         const float col)
       : base_attributes(std::move(attributes)), ID(tID), tower_name(name),
-        position(col, row), current_target(nullptr) {
+        position(col, row) {
     // modifiers.resize(tier_roll);
     // mod_count = 0;
     num_kills = 0;
+    num_attacks = 0;
     tier = static_cast<Tier>(tier_roll);
   }
   virtual ~Tower() {}
@@ -77,9 +81,13 @@ public:
   virtual bool add_modifier(tower_property_modifier &&modifier);
 
   // this is baisically a factory function for generating a given towers'
-  // attacks. Tower subclasses can override to do whatever extra steps they need
-  virtual std::unique_ptr<TowerAttackBase>
-  generate_attack(const std::string &attack_id, const uint64_t timestamp);
+  // attacks on the targeted live mob. Tower subclasses can override to do
+  // whatever extra steps they need. NOTE: the attack is added to the attack
+  // pool, and is only valid until the pool is next modified
+  virtual TowerAttackBase &generate_attack(AttackPool &attacks,
+                                           const uint32_t attack_id,
+                                           const uint64_t timestamp,
+                                           const MobTable *live_mobs);
 
   virtual void set_model(std::shared_ptr<TowerModel> t_model) {
     tower_model = t_model;
@@ -90,8 +98,7 @@ public:
   virtual bool set_properties(tower_properties &&props) {
     base_attributes += props;
     // Q: anything else we need to change? or is this it?
-    std::cout << "NOTE: changed tower " << get_name() << " properties to: \n"
-              << base_attributes << std::endl;
+    TD_LOG(Info, "tower_properties_changed", Logging::kv("tower", get_name()));
 
     // Q: is this return entirely vestigial?
     return true;
@@ -110,24 +117,33 @@ base_attributes += modifier;
   // them)
   virtual void killed_mob() { num_kills += 1; }
 
+  // how many attacks the tower has made so far, counting this one
+  inline uint32_t count_attack() { return ++num_attacks; }
+
   inline bool in_range(const float target_dist) const {
     // return target_dist < attack_attributes.attack_range;
-    return target_dist < base_attributes.modifier.attack_range_value;
+    return target_dist < get_attack_range();
   }
 
-  inline std::shared_ptr<Monster> get_target() const { return current_target; }
-
-  inline std::string get_target_id() const {
-    return current_target->get_name();
+  inline float get_attack_range() const {
+    return base_attributes.modifier.attack_range_value;
   }
 
-  inline void set_target(std::shared_ptr<Monster> &mob) {
-    current_target = mob;
-  }
+  inline MobHandle get_target_handle() const { return current_target_handle; }
 
-  inline void reset_target() { current_target.reset(); }
+  inline void set_target(const MobHandle mob) { current_target_handle = mob; }
+
+  inline void reset_target() {
+    current_target_handle = MobHandle();
+  }
 
   inline uint32_t get_id() const { return ID; }
+  inline int get_tier_level() const { return get_tier(tier); }
+  inline uint32_t get_num_kills() const { return num_kills; }
+  inline uint32_t get_num_attacks() const { return num_attacks; }
+  inline const tower_properties &get_base_attributes() const {
+    return base_attributes;
+  }
 
   // returns the (self-reported) tower infomrnation
   inline CommonTowerInformation get_common_info() const {
@@ -159,6 +175,10 @@ protected:
 
   // void generate_statuseffects();
 
+  // sets up the attack parameters common to all of the attacks
+  TowerAttackParams make_attack_params(const uint32_t attack_id,
+                                       const uint64_t timestamp);
+
   const static int MAX_UPGRADE_LEVEL = 3;
 
   // the baseline, fundamental attributes. These represent the permenent
@@ -193,9 +213,10 @@ protected:
   Coordinate<float> position;
 
   // cache the last found target (as having to do lookups every iteration takes
-  // too long)
-  std::shared_ptr<Monster> current_target;
+  // too long) -- NOTE: it's a handle into the live mobs (see MobTable)
+  MobHandle current_target_handle;
   uint32_t num_kills;
+  uint32_t num_attacks;
 
   std::vector<tower_attribute_modifier *> status_effects;
 #if 0
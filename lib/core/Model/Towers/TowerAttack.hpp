@@ -9,8 +9,10 @@
 #ifndef TD_TOWER_ATTACK_HPP
 #define TD_TOWER_ATTACK_HPP
 
+#include "MobTable.hpp"
 #include "Monster.hpp"
 #include "util/Elements.hpp"
+#include "util/Logger.hpp"
 #include "util/Types.hpp"
 
 #include <cmath>
@@ -42,14 +44,15 @@ struct TowerAttackParams {
   // later, matching it based on the origin_id, which seems needlessly
   // convoluted).
   TowerAttackParams(tower_properties atk_props, Tower *origin,
-                    const std::string &atk_id, const std::string &m_id)
-      : attack_attributes(atk_props), origin_tower(origin), id(atk_id),
-        mob_id(m_id) {}
+                    const uint32_t atk_id)
+      : attack_attributes(atk_props), origin_tower(origin), id(atk_id) {}
 
   tower_properties attack_attributes;
   Tower *origin_tower;
-  const std::string id;
-  const std::string mob_id;
+  // NOTE: not const, s.t. the (pooled) attacks can be moved around
+  uint32_t id;
+  // the targeted mob, if it's one of the live mobs (i.e. in the MobTable)
+  MobHandle target_mob;
 
   double move_speed;
 
@@ -74,6 +77,9 @@ public:
 
   virtual ~TowerAttackBase() {}
 
+  TowerAttackBase(TowerAttackBase &&) = default;
+  TowerAttackBase &operator=(TowerAttackBase &&) = default;
+
   inline Tower *get_origin_tower() const { return params.origin_tower; }
 
   /*
@@ -83,13 +89,15 @@ public:
   }
   */
 
-  inline tower_properties get_attack_attributes() const {
+  inline const tower_properties &get_attack_attributes() const {
     return params.attack_attributes;
   }
 
-  inline std::string get_target_id() const { return params.mob_id; }
+  inline MobHandle get_target_handle() const { return params.target_mob; }
+  // for when the targeted mob is gone
+  inline void lose_target() { params.target_mob = MobHandle(); }
 
-  inline std::string get_id() const { return params.id; }
+  inline uint32_t get_id() const { return params.id; }
 
   // NOTE: it is assumed we are using normalized coordinates
   inline bool in_bounds() const {
@@ -103,7 +111,13 @@ public:
     params.target_position = target;
   }
 
-  bool hit_target() { return has_hit_target; }
+  inline Coordinate<float> get_target_position() const {
+    return params.target_position;
+  }
+
+  inline float get_move_speed() const { return params.move_speed; }
+
+  inline bool hit_target() const { return has_hit_target; }
 
   virtual Coordinate<float> move_update(const uint64_t time) = 0;
 
@@ -123,7 +137,9 @@ protected:
 // NOTE: can have various policies here for governing how the attack behaves.
 // so far, AttackT will be the attack type, i.e. linear, homing, splash, random,
 // etc.
-template <typename AttackT> class TowerAttack : public TowerAttackBase {
+// NOTE: final, s.t. the move_update calls are statically dispatched when the
+// concrete attack type is known (i.e. for the pooled attacks)
+template <typename AttackT> class TowerAttack final : public TowerAttackBase {
 public:
   explicit TowerAttack(TowerAttackParams &&attack_params,
                        AttackT &&towerattack_type)
@@ -163,14 +179,14 @@ struct FixedAttackMovement {
 };
 
 struct HomingAttackMovement {
-  HomingAttackMovement(std::shared_ptr<Monster> &target_mob)
-      : target(target_mob) {}
+  HomingAttackMovement(const MobTable *mobs, const MobHandle target_mob)
+      : live_mobs(mobs), target_handle(target_mob) {}
 
   bool operator()(TowerAttackParams &params,
                   Coordinate<float> &current_position, const uint64_t time) {
-    if (auto atk_target = target.lock()) {
-      auto target_pos = atk_target->get_position();
-      params.target_position = target_pos;
+    if (live_mobs->contains(target_handle)) {
+      params.target_position =
+          live_mobs->get_position(live_mobs->index_of(target_handle));
     } else {
       // TODO: figure out what do we do if the mob is gone / no longer
       // available?
@@ -181,7 +197,7 @@ struct HomingAttackMovement {
       // Not sure what to do in that case actually. Maybe have it detonate at
       // the mob's location of death? (i.e. it becomes a FixedAttackMovement
       // object)
-      std::cout << "NOTE: The attack's mob is gone/reset" << std::endl;
+      TD_LOG(Trace, "attack_target_gone", Logging::kv("attack_id", params.id));
     }
 
     return mover(params, current_position, time);
@@ -191,7 +207,9 @@ struct HomingAttackMovement {
   // to have something more generic than a Monster (i.e. if we had some type
   // like 'Moveable' which governed anything that could be moved around the
   // map).... I guess this will work for now though?
-  std::weak_ptr<Monster> target;
+  // NOTE: the table outlives the attacks (TowerLogic owns both)
+  const MobTable *live_mobs;
+  MobHandle target_handle;
   FixedAttackMovement mover;
 };
 
@@ -9,6 +9,8 @@
 #ifndef TD_MULTI_DISPATCH_HPP
 #define TD_MULTI_DISPATCH_HPP
 
+#include "util/Logger.hpp"
+
 #include <algorithm>
 #include <cassert>
 #include <functional>
@@ -75,23 +77,14 @@ public:
     generate_type_key<sizeof...(concrete_types),
                       concrete_types...>::append_type(type_ids);
 
-    int type_counter = 0;
-    std::for_each(
-        type_ids.begin(), type_ids.end(), [&type_counter](std::type_index idx) {
-          std::string typeidx_name = idx.name();
-          std::cout << "type #" << type_counter++ << ": " << typeidx_name
-                    << " --> hash code: " << idx.hash_code() << std::endl;
-        });
-    dispatch_hash<keys_type> hasher;
-    std::cout << "Overall hash: " << hasher(type_ids) << std::endl;
+    log_type_key(type_ids);
 
     // check if the key already exists (would need to double check the hashing
     // function..)
     auto found_id = callbacks_.find(type_ids);
     if (found_id != callbacks_.end())
-      std::cout << "NOTE: collision in the callbacks map -- this really "
-                   "shouldnt happen"
-                << std::endl;
+      TD_LOG(Warn, "dispatch_collision",
+             Logging::kv("hash", dispatch_hash<keys_type>()(type_ids)));
 
     callbacks_.insert(std::make_pair(type_ids, td_fcn));
   }
@@ -101,23 +94,16 @@ public:
     keys_type type_ids{};
     generate_object_keys(type_ids, types...);
 
-    int type_counter = 0;
-    std::for_each(
-        type_ids.begin(), type_ids.end(), [&type_counter](std::type_index idx) {
-          std::string typeidx_name = idx.name();
-          std::cout << "type #" << type_counter++ << ": " << typeidx_name
-                    << " --> hash code: " << idx.hash_code() << std::endl;
-        });
-    dispatch_hash<keys_type> hasher;
-    std::cout << "Overall hash: " << hasher(type_ids) << std::endl;
+    log_type_key(type_ids);
 
     // check if the key already exists (would need to double check the hashing
     // function..)
     auto found_id = callbacks_.find(type_ids);
     if (found_id != callbacks_.end())
-      return callbacks_[type_ids](types...);
+      return found_id->second(types...);
     else
-      std::cout << "NOTE: no matching function for the given type" << std::endl;
+      TD_LOG(Warn, "dispatch_no_match",
+             Logging::kv("hash", dispatch_hash<keys_type>()(type_ids)));
     return return_t{};
   }
 
@@ -131,6 +117,16 @@ public:
   }
 
 private:
+  void log_type_key(const keys_type &type_ids) const {
+    for (size_t type_idx = 0; type_idx < type_ids.size(); type_idx++) {
+      TD_LOG(Trace, "dispatch_type", Logging::kv("index", type_idx),
+             Logging::kv("type", type_ids[type_idx].name()),
+             Logging::kv("hash", type_ids[type_idx].hash_code()));
+    }
+    TD_LOG(Trace, "dispatch_key",
+           Logging::kv("hash", dispatch_hash<keys_type>()(type_ids)));
+  }
+
   ////////////////////////////////////////////////////////////////
   // generates the type_index lists for the type lists (no objects)
   ////////////////////////////////////////////////////////////////
@@ -0,0 +1,249 @@
+/* VecTowerDefense.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_VEC_TOWER_DEFENSE_HPP
+#define TD_VEC_TOWER_DEFENSE_HPP
+
+#include "GameClock.hpp"
+#include "TowerDefense.hpp"
+#include "TowerLogic.hpp"
+#include "WorkerPool.hpp"
+#include "shared/Player.hpp"
+#include "shared/common_information.hpp"
+#include "util/TDEventTypes.hpp"
+#include "util/TowerProperties.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a frontend that doesn't do anything -- the vectorized games throw away their
+// frontend events themselves (see VecTowerDefense::discard_frames), so there's
+// no need for a thread per game to consume them
+template <typename BackendType> struct HeadlessView {
+  using TowerEventQueueType = typename UserTowerEvents::EventQueueType<
+      UserTowerEvents::tower_event<BackendType>>::QType;
+  using GameInformationType =
+      GameInformation<CommonTowerInformation, TDPlayerInformation>;
+
+  void register_tower_eventqueue(TowerEventQueueType *) {}
+  void register_shared_info(std::shared_ptr<GameInformationType>) {}
+  void register_backend_eventqueue(ViewEvents *) {}
+};
+
+namespace VecEnv {
+// what an action does -- each action is ACTION_SIZE floats:
+// [kind, col, row, arg], with the col / row being normalized map coordinates.
+// The arg is the tier for a build, and the index into the step's modifiers for
+// a modify (as with the command batches' Modify commands)
+enum class ActionKind : int { None = 0, Build = 1, Modify = 2 };
+} // namespace VecEnv
+
+/*
+ * N independent headless games, stepped together -- i.e. for training agents
+ * against the backend. Each game runs on a VirtualClock, and step() spreads the
+ * games over a worker pool, so the games aren't paced to the wall clock and
+ * there's no gameloop thread per game.
+ *
+ * The observations are OBSERVATION_SIZE floats per game:
+ *  [0, NUM_SCALARS): #lives, gold, essence, whether a wave is active, #mobs
+ *  then 1 per tower slot (row-major): the tier of the tower there (0 if none)
+ *  then 1 per tower slot: the #live mobs within the slot's block
+ * The reward is the #mobs killed during the step, less LEAK_PENALTY for each
+ * mob that made it through. A game is done once it's out of lives, at which
+ * point it gets reset (s.t. the observation is of the new game).
+ *
+ * NOTE: each game has its own random engine, seeded from the seed, the game's
+ * index and its #episodes -- so a seeded VecTowerDefense plays out the same
+ * regardless of which worker steps which game
+ */
+template <class ModelType = TowerLogic> class VecTowerDefense {
+public:
+  using GameType = TowerDefense<HeadlessView, ModelType>;
+
+  static constexpr int NUM_SLOTS = ModelType::TLIST_HEIGHT * ModelType::TLIST_WIDTH;
+  static constexpr size_t NUM_SCALARS = 5;
+  static constexpr size_t OBSERVATION_SIZE = NUM_SCALARS + 2 * NUM_SLOTS;
+  static constexpr size_t ACTION_SIZE = 4;
+  static constexpr float LEAK_PENALTY = 1.0f;
+  // the tower tiers are in [1, MAX_TIER]
+  static constexpr int MAX_TIER = 10;
+
+  // NOTE: num_threads includes the calling thread, and defaults to 1 per core
+  VecTowerDefense(const size_t num_envs, const int32_t seed,
+                  const size_t num_threads = std::thread::hardware_concurrency())
+      : base_seed(seed < 0 ? 0 : seed), envs(num_envs),
+        workers(std::max<size_t>(std::min(num_threads, num_envs), 1) - 1) {
+    if (num_envs == 0) {
+      throw std::logic_error("VecTowerDefense needs at least 1 game");
+    }
+    workers.run(envs.size(),
+                [this](const size_t env_idx) { reset_env(env_idx); });
+  }
+
+  VecTowerDefense(const VecTowerDefense &) = delete;
+  VecTowerDefense &operator=(const VecTowerDefense &) = delete;
+
+  inline size_t num_envs() const { return envs.size(); }
+
+  // restarts every game, writes the num_envs x OBSERVATION_SIZE observations
+  void reset(float *observations) {
+    workers.run(envs.size(), [this, observations](const size_t env_idx) {
+      reset_env(env_idx);
+      write_observation(env_idx, observations + env_idx * OBSERVATION_SIZE);
+    });
+  }
+
+  /*
+   * applies the actions (num_envs x actions_per_env x ACTION_SIZE) to the games,
+   * then runs each of them for num_ticks. Writes num_envs observations,
+   * rewards and done flags. The modify actions index into the modifiers,
+   * which are shared by all of the games. NOTE: the actions that can't be
+   * carried out (i.e. building on an occupied block, or one that would wall
+   * off the mobs, or modifying an empty block) are skipped
+   */
+  void step(const float *actions, const size_t actions_per_env,
+            const uint64_t num_ticks, float *observations, float *rewards,
+            uint8_t *dones,
+            const std::vector<tower_properties> &modifiers = {}) {
+    workers.run(envs.size(), [this, actions, actions_per_env, num_ticks,
+                              observations, rewards, dones,
+                              &modifiers](const size_t env_idx) {
+      GameEnv &env = envs[env_idx];
+      const float *env_actions = actions + env_idx * actions_per_env * ACTION_SIZE;
+      for (size_t action_idx = 0; action_idx < actions_per_env; action_idx++) {
+        apply_action(env, env_actions + action_idx * ACTION_SIZE, modifiers);
+      }
+
+      ModelType *backend = env.game->get_td_backend();
+      const uint64_t num_killed = backend->get_num_mobs_killed();
+      const uint64_t num_leaked = backend->get_num_mobs_leaked();
+      env.game->run_ticks(num_ticks);
+      discard_frames(env);
+      rewards[env_idx] =
+          static_cast<float>(backend->get_num_mobs_killed() - num_killed) -
+          LEAK_PENALTY * (backend->get_num_mobs_leaked() - num_leaked);
+
+      dones[env_idx] = backend->get_player_info().num_lives <= 0;
+      if (dones[env_idx]) {
+        reset_env(env_idx);
+      }
+      write_observation(env_idx, observations + env_idx * OBSERVATION_SIZE);
+    });
+  }
+
+  inline GameType *get_env(const size_t env_idx) const {
+    return envs.at(env_idx).game.get();
+  }
+
+private:
+  struct GameEnv {
+    std::unique_ptr<GameType> game;
+    uint64_t num_episodes = 0;
+    // the towers need unique IDs within their game
+    uint32_t next_tower_id = 0;
+  };
+
+  void reset_env(const size_t env_idx) {
+    GameEnv &env = envs[env_idx];
+    const int32_t env_seed = static_cast<int32_t>(
+        (base_seed + env_idx + env.num_episodes * envs.size()) & 0x7fffffff);
+    if (env.game) {
+      env.game->reset_game(env_seed);
+    } else {
+      // NOTE: the games are already spread over the cores, so they don't get
+      // tower threads of their own -- and the snapshots are only taken on
+      // demand
+      env.game = std::unique_ptr<GameType>(new GameType(
+          env_seed, std::unique_ptr<GameClock>(new VirtualClock())));
+      env.game->set_snapshots_enabled(false);
+      env.game->init_game();
+    }
+    env.num_episodes++;
+    env.next_tower_id = 0;
+  }
+
+  void apply_action(GameEnv &env, const float *action,
+                    const std::vector<tower_properties> &modifiers) {
+    ModelType *backend = env.game->get_td_backend();
+    const float col = action[1];
+    const float row = action[2];
+    if (!(col >= 0.0f && col < 1.0f && row >= 0.0f && row < 1.0f)) {
+      return;
+    }
+    switch (static_cast<VecEnv::ActionKind>(std::lround(action[0]))) {
+    case VecEnv::ActionKind::Build: {
+      // NOTE: make_tower checks that the block is free, and that building
+      // there wouldn't wall off the mobs
+      const int tier =
+          std::min<int>(MAX_TIER, std::max<int>(1, std::lround(action[3])));
+      if (backend->make_tower(env.next_tower_id, tier, col, row)) {
+        env.next_tower_id++;
+      }
+      break;
+    }
+    case VecEnv::ActionKind::Modify: {
+      const long modifier_idx = std::lround(action[3]);
+      if (modifier_idx >= 0 &&
+          static_cast<size_t>(modifier_idx) < modifiers.size()) {
+        backend->modify_tower(modifiers[modifier_idx], col, row);
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  // nothing's going to render the games, so their frames just get recycled
+  void discard_frames(GameEnv &env) {
+    ViewEvents *game_events = env.game->get_td_backend()->get_frontend_eventqueue();
+    for (auto frame = game_events->pop_frame(); frame;
+         frame = game_events->pop_frame()) {
+      game_events->release_frame(std::move(frame));
+    }
+  }
+
+  void write_observation(const size_t env_idx, float *observation) const {
+    const GameType *game = envs[env_idx].game.get();
+    const ModelType *backend = game->get_td_backend();
+    const TDPlayerInformation &player = backend->get_player_info();
+    const MobTable &live_mobs = backend->get_live_mobs();
+
+    observation[0] = player.num_lives;
+    observation[1] = player.num_gold;
+    observation[2] = player.num_essence;
+    observation[3] = game->get_game_state() == GAME_STATE::ACTIVE;
+    observation[4] = live_mobs.size();
+
+    float *tower_tiers = observation + NUM_SCALARS;
+    float *mob_counts = tower_tiers + NUM_SLOTS;
+    backend->get_tower_tiers(tower_tiers);
+    std::fill(mob_counts, mob_counts + NUM_SLOTS, 0.0f);
+    for (size_t mob_idx = 0; mob_idx < live_mobs.size(); mob_idx++) {
+      const int slot_row = std::min<int>(
+          ModelType::TLIST_HEIGHT - 1,
+          std::max<int>(0, live_mobs.pos_row[mob_idx] * ModelType::TLIST_HEIGHT));
+      const int slot_col = std::min<int>(
+          ModelType::TLIST_WIDTH - 1,
+          std::max<int>(0, live_mobs.pos_col[mob_idx] * ModelType::TLIST_WIDTH));
+      mob_counts[slot_row * ModelType::TLIST_WIDTH + slot_col] += 1.0f;
+    }
+  }
+
+  const int64_t base_seed;
+  std::vector<GameEnv> envs;
+  WorkerPool workers;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/* WorkerPool.hpp -- part of the DietyTD Model subsystem implementation
+ *
+ * Copyright (C) 2015 Alrik Firl
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TD_WORKER_POOL_HPP
+#define TD_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A fixed set of worker threads for fork-join style parallel loops within a
+ * game cycle. run() hands out the task indices to the workers (and the calling
+ * thread, which helps out) and blocks until all of them are done.
+ *
+ * NOTE: which thread runs which task is up to the scheduler, so the tasks
+ * should write their outputs into per-task (not per-thread) buffers if the
+ * results need to be deterministic
+ */
+class WorkerPool {
+public:
+  explicit WorkerPool(const size_t num_workers)
+      : current_task(nullptr), num_tasks(0), next_task(0), pending_workers(0),
+        generation(0), stopping(false) {
+    workers.reserve(num_workers);
+    for (size_t worker_idx = 0; worker_idx < num_workers; ++worker_idx) {
+      workers.emplace_back(&WorkerPool::worker_loop, this);
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  // the #threads that run() uses, including the calling thread
+  inline size_t num_threads() const { return workers.size() + 1; }
+
+  // calls task_fn(task_idx) for each task_idx in [0, task_count), returns once
+  // all of the tasks are done. NOTE: not re-entrant
+  template <typename TaskFn> void run(const size_t task_count, TaskFn task_fn) {
+    if (workers.empty() || task_count <= 1) {
+      for (size_t task_idx = 0; task_idx < task_count; ++task_idx) {
+        task_fn(task_idx);
+      }
+      return;
+    }
+
+    const std::function<void(size_t)> task(std::ref(task_fn));
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      current_task = &task;
+      num_tasks = task_count;
+      next_task = 0;
+      pending_workers = workers.size();
+      generation++;
+    }
+    work_cv.notify_all();
+
+    run_tasks(task);
+
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    done_cv.wait(lock, [this]() { return pending_workers == 0; });
+    current_task = nullptr;
+  }
+
+private:
+  void worker_loop() {
+    uint64_t last_generation = 0;
+    while (true) {
+      const std::function<void(size_t)> *task = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        work_cv.wait(lock, [this, last_generation]() {
+          return stopping || generation != last_generation;
+        });
+        if (stopping) {
+          return;
+        }
+        last_generation = generation;
+        task = current_task;
+      }
+
+      run_tasks(*task);
+
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      if (--pending_workers == 0) {
+        done_cv.notify_one();
+      }
+    }
+  }
+
+  inline void run_tasks(const std::function<void(size_t)> &task) {
+    size_t task_idx;
+    while ((task_idx = next_task.fetch_add(1)) < num_tasks) {
+      task(task_idx);
+    }
+  }
+
+  std::vector<std::thread> workers;
+
+  std::mutex pool_mutex;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+
+  // the current run's state -- NOTE: the workers only read these after being
+  // woken up (i.e. under the mutex), so only the task counter needs to be atomic
+  const std::function<void(size_t)> *current_task;
+  size_t num_tasks;
+  std::atomic<size_t> next_task;
+  size_t pending_workers;
+  uint64_t generation;
+  bool stopping;
+};
+
+#endif
@@ -1,22 +1,62 @@
 #include "gtest/gtest.h"
 
 #include "Model/AttackLogic.hpp"
+#include "Model/Towers/AttackPool.hpp"
+#include "Model/BlockConnectivity.hpp"
+#include "Model/MobTable.hpp"
+#include "Model/Pathfinder.hpp"
+#include "Model/RangeStencil.hpp"
+#include "Model/SpatialGrid.hpp"
 #include "Model/Monster.hpp"
 #include "Model/TowerDefense.hpp"
+#include "Model/VecTowerDefense.hpp"
 #include "Model/Towers/Combinations/ModifierParser.hpp"
+#include "util/EventQueue.hpp"
+#include "util/Logger.hpp"
+#include "util/NameRegistry.hpp"
+#include "util/RandomUtility.hpp"
+#include "util/SPSCEventQueue.hpp"
 #include "util/TowerModifiers.hpp"
 #include "util/Types.hpp"
 
 #include "utils/Frontend.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <thread>
 
-#include <list>
+#include <map>
 #include <memory>
+#include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include <poll.h>
+
+// the TowerLogic internals that the tests get at (it's a friend of TowerLogic)
+struct TowerLogicTestAccess {
+  static bool remove_tower(TowerLogic &backend, const float x_coord,
+                           const float y_coord) {
+    return backend.remove_tower(x_coord, y_coord);
+  }
+
+  static MobHandle add_mob(TowerLogic &backend, const uint32_t mob_id,
+                           const Coordinate<float> &position) {
+    MonsterStats stats(100, 0.05, Elements::CHAOS, 1, 0.1, 0);
+    auto mob = backend.live_mobs.add_mob(CharacterModels::ModelIDs::ogre_S,
+                                         mob_id, stats, position);
+    backend.mob_grid.rebuild(backend.live_mobs);
+    return mob;
+  }
+
+  static bool get_targets(TowerLogic &backend, Tower *tower, const int t_col,
+                          const int t_row) {
+    return backend.get_targets(tower, t_col, t_row);
+  }
+};
+
 // breakpoint on failure:
 // gdb --args ./bin/GameMechanicsTest --gtest_break_on_failure
 namespace {
@@ -25,13 +65,14 @@ protected:
   using TDBackendType = TowerLogic;
   using TDType = TowerDefense<TestStubs::FrontStub, TDBackendType>;
 
-  DTDBackendTest() : attack_id("T0_atk") {
+  DTDBackendTest() : attack_id(0) {
     int test_seed = 42;
     td = std::make_shared<TDType>(test_seed);
     view = td->get_td_frontend();
 
-    tower_xcoord = 0;
-    tower_ycoord = 0;
+    // NOTE: not on the mobs' spawn or destination, or it'd block their path
+    tower_xcoord = 0.5;
+    tower_ycoord = 0.5;
     mob_xcoord = 1;
     mob_ycoord = 1;
     tid = 0;
@@ -66,18 +107,36 @@ protected:
     // td->stop_game();
   }
 
-  std::shared_ptr<Monster> make_mob_from_cfg(const std::string &mob_cfg) {
+  // adds the mob to the (test's) live mobs
+  MobHandle make_mob_from_cfg(const std::string &mob_cfg) {
     std::vector<std::shared_ptr<Monster>> mobs =
         parse_monster(mob_cfg, "TEST_", 1);
-    auto mob = mobs[0];
-    mob->set_position(Coordinate<float>(mob_xcoord, mob_ycoord));
-    return mob;
+    return live_mobs.add_mob(CharacterModels::ModelIDs::ogre_S, 0,
+                             mobs[0]->get_attributes(),
+                             Coordinate<float>(mob_xcoord, mob_ycoord));
+  }
+
+  // the attack hitting its target, the same as in the backend's attack phase
+  void hit_mob(const TowerAttackBase &attack) {
+    const uint32_t mob_idx = live_mobs.index_of(attack.get_target_handle());
+    AttackHitQueue hits;
+    ASSERT_TRUE(queue_attackhit(
+        hits, live_mobs,
+        SpatialGrid<GameMap>::CellRange(&mob_idx, &mob_idx + 1), attack,
+        td->get_td_backend()->get_random_engine()));
+    resolve_attackhits(hits, live_mobs);
+  }
+
+  MonsterStats get_mob_stats(const MobHandle mob) const {
+    return live_mobs.get_stats(live_mobs.index_of(mob));
   }
 
   std::shared_ptr<Tower> make_tower_from_cfg(const std::string &tower_cfg) {}
 
   TestStubs::FrontStub<TDBackendType> *view;
   std::shared_ptr<TDType> td;
+  MobTable live_mobs;
+  AttackPool attacks;
 
   // common game mechanics state values
   float tower_xcoord;
@@ -91,7 +150,7 @@ protected:
   std::string tmod_basepath;
   std::string tower_basepath;
 
-  const std::string attack_id;
+  const uint32_t attack_id;
 };
 
 void assert_tower_properties_almost_equals(
@@ -124,10 +183,10 @@ TEST_F(DTDBackendTest, BasicTower) {
 
   auto basic_tower = td_backend->get_tower(tower_xcoord, tower_ycoord);
   basic_tower->set_target(mob);
-  const std::string basic_attack_id{"fundamental_atk"};
-  auto basic_attack = basic_tower->generate_attack(basic_attack_id, 0);
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = basic_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
   // this is the default (fundamental) tower stats, without any boosts
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 }
 
@@ -145,10 +204,10 @@ TEST_F(DTDBackendTest, Basic_FlatDMG) {
   td_backend->make_tower(tid, tier, tower_xcoord, tower_ycoord);
   auto test_tower = td_backend->get_tower(tower_xcoord, tower_ycoord);
   test_tower->set_target(mob);
-  const std::string basic_attack_id{"flat_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
   // this is the default (fundamental) tower stats, without any boosts
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -160,8 +219,8 @@ TEST_F(DTDBackendTest, Basic_FlatDMG) {
   expected_props.apply_property_modifier(tmod);
 
   test_tower->add_modifier(std::move(tmod));
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
 
   tower_properties expected_handprops = expected_base_props;
@@ -172,14 +231,12 @@ TEST_F(DTDBackendTest, Basic_FlatDMG) {
   }
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  // attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  // attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
+  MonsterStats mob_stats = get_mob_stats(mob);
   EXPECT_FLOAT_EQ(mob_stats.health, 889);
 }
 
@@ -200,9 +257,9 @@ TEST_F(DTDBackendTest, Basic_PctDMG) {
 
   // make the (unmodified) basic tower attack.
   // this is the default (fundamental) tower stats, without any boosts
-  const std::string basic_attack_id{"pct_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -217,8 +274,8 @@ TEST_F(DTDBackendTest, Basic_PctDMG) {
   // auto tdamage = tower->compute_attack_damage();
 
   test_tower->set_target(mob);
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
   for (size_t dmg_idx = 0; dmg_idx < tower_property_modifier::NUM_ELEM;
@@ -227,15 +284,13 @@ TEST_F(DTDBackendTest, Basic_PctDMG) {
   }
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 996);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 995);
 }
 
 TEST_F(DTDBackendTest, Basic_flat_crit_multiplier) {
@@ -252,10 +307,10 @@ TEST_F(DTDBackendTest, Basic_flat_crit_multiplier) {
   td_backend->make_tower(tid, tier, tower_xcoord, tower_ycoord);
   auto test_tower = td_backend->get_tower(tower_xcoord, tower_ycoord);
   test_tower->set_target(mob);
-  const std::string basic_attack_id{"flatcrit_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
   // this is the default (fundamental) tower stats, without any boosts
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -268,22 +323,20 @@ TEST_F(DTDBackendTest, Basic_flat_crit_multiplier) {
   expected_props.apply_property_modifier(tmod);
   test_tower->add_modifier(std::move(tmod));
 
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
   expected_handprops.modifier.crit_multiplier_value += 25;
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 996);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 997);
 }
 
 TEST_F(DTDBackendTest, Basic_critpct) {
@@ -303,9 +356,9 @@ TEST_F(DTDBackendTest, Basic_critpct) {
 
   // make the (unmodified) basic tower attack.
   // this is the default (fundamental) tower stats, without any boosts
-  const std::string basic_attack_id{"critpct_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -321,22 +374,20 @@ TEST_F(DTDBackendTest, Basic_critpct) {
   // auto tdamage = tower->compute_attack_damage();
 
   test_tower->set_target(mob);
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
   expected_handprops.modifier.crit_chance_value += 1.0;
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 754);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 774);
 }
 
 TEST_F(DTDBackendTest, Basic_range) {
@@ -356,9 +407,9 @@ TEST_F(DTDBackendTest, Basic_range) {
 
   // make the (unmodified) basic tower attack.
   // this is the default (fundamental) tower stats, without any boosts
-  const std::string basic_attack_id{"range_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -372,22 +423,20 @@ TEST_F(DTDBackendTest, Basic_range) {
   test_tower->add_modifier(std::move(tmod));
 
   test_tower->set_target(mob);
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
   expected_handprops.modifier.attack_range_value += 5;
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 998);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 997);
 }
 
 TEST_F(DTDBackendTest, Basic_spd) {
@@ -407,9 +456,9 @@ TEST_F(DTDBackendTest, Basic_spd) {
 
   // make the (unmodified) basic tower attack.
   // this is the default (fundamental) tower stats, without any boosts
-  const std::string basic_attack_id{"spd_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -425,23 +474,21 @@ TEST_F(DTDBackendTest, Basic_spd) {
   // auto tdamage = tower->compute_attack_damage();
 
   test_tower->set_target(mob);
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
   expected_handprops.modifier.attack_speed_value += 0.15;
 
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 996);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 997);
 }
 
 TEST_F(DTDBackendTest, Basic_type_FED) {
@@ -461,9 +508,9 @@ TEST_F(DTDBackendTest, Basic_type_FED) {
 
   // make the (unmodified) basic tower attack.
   // this is the default (fundamental) tower stats, without any boosts
-  const std::string basic_attack_id{"typeflatED_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -479,8 +526,8 @@ TEST_F(DTDBackendTest, Basic_type_FED) {
   // auto tdamage = tower->compute_attack_damage();
 
   test_tower->set_target(mob);
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
 
@@ -489,15 +536,13 @@ TEST_F(DTDBackendTest, Basic_type_FED) {
   expected_handprops.modifier.damage_value[water_index].high += 30;
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 964);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 963);
 }
 
 TEST_F(DTDBackendTest, Basic_type_PCTED) {
@@ -517,9 +562,9 @@ TEST_F(DTDBackendTest, Basic_type_PCTED) {
 
   // make the (unmodified) basic tower attack.
   // this is the default (fundamental) tower stats, without any boosts
-  const std::string basic_attack_id{"typepctED_atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
   assert_tower_properties_almost_equals(basic_attack_vals, expected_base_props);
 
   // load the tower modifiers, apply them to the base tower
@@ -535,8 +580,8 @@ TEST_F(DTDBackendTest, Basic_type_PCTED) {
   // auto tdamage = tower->compute_attack_damage();
 
   test_tower->set_target(mob);
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
 
@@ -544,15 +589,13 @@ TEST_F(DTDBackendTest, Basic_type_PCTED) {
   expected_handprops.modifier.enhanced_damage_value[chaos_index] += 0.5;
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist;
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   // check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 993);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 995);
 }
 
 TEST_F (DTDBackendTest, Compound_F_ED) {
@@ -568,10 +611,10 @@ TEST_F (DTDBackendTest, Compound_F_ED) {
   td_backend->make_tower(tid, tier, tower_xcoord,tower_ycoord);
   auto test_tower = td_backend->get_tower(tower_xcoord, tower_ycoord);
   test_tower->set_target(mob);
-  const std::string basic_attack_id{"atk"};
-  auto basic_attack = test_tower->generate_attack(basic_attack_id, 0);
+  const uint32_t basic_attack_id{1};
+  auto &basic_attack = test_tower->generate_attack(attacks, basic_attack_id, 0, &live_mobs);
   // this is the default (fundamental) tower stats, without any boosts
-  auto basic_attack_vals = basic_attack->get_attack_attributes();
+  auto basic_attack_vals = basic_attack.get_attack_attributes();
 
   std::vector<std::string> tmods {"basic_flatED.yaml", "basic_pctED.yaml"};
   // load the tower modifiers, apply them to the base tower
@@ -588,8 +631,8 @@ TEST_F (DTDBackendTest, Compound_F_ED) {
   //auto tdamage = tower->compute_attack_damage();
   
 	test_tower->set_target(mob);
-  auto attack = test_tower->generate_attack(attack_id, 0);
-  auto attack_vals = attack->get_attack_attributes();
+  auto &attack = test_tower->generate_attack(attacks, attack_id, 0, &live_mobs);
+  auto attack_vals = attack.get_attack_attributes();
   assert_tower_properties_almost_equals(attack_vals, expected_props);
   tower_properties expected_handprops = expected_base_props;
   for (size_t dmg_idx = 0; dmg_idx < tower_property_modifier::NUM_ELEM; dmg_idx++) {
@@ -599,18 +642,1839 @@ TEST_F (DTDBackendTest, Compound_F_ED) {
   }
   assert_tower_properties_almost_equals(attack_vals, expected_handprops);
 
-  attack->set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
+  attack.set_target(Coordinate<float>(mob_xcoord, mob_ycoord));
 
-  std::list<std::weak_ptr<Monster>> moblist; 
-  moblist.emplace_back(mob);
-  compute_attackhit(moblist, std::move(attack));
+  hit_mob(attack);
 
   //check the mob state, make sure the correct damage was done
-  MonsterStats mob_stats = mob->get_attributes();
-  EXPECT_FLOAT_EQ(mob_stats.health, 853);
+  MonsterStats mob_stats = get_mob_stats(mob);
+  EXPECT_FLOAT_EQ(mob_stats.health, 854);
 }
 
 //TODO: have different compound tower tests
 //TODO: have different monster stats
 
+TEST(DTDHeadlessTest, FastForwardWave) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+
+  EXPECT_EQ(td->run_ticks(10), 10);
+  EXPECT_EQ(td->get_game_state(), GAME_STATE::IDLE);
+
+  // the build phase alone would take 15 seconds of wall-clock time
+  auto start_time = std::chrono::steady_clock::now();
+  const uint64_t num_ticks = td->run_until_wave_end();
+  auto wave_time = std::chrono::steady_clock::now() - start_time;
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::seconds>(wave_time).count(),
+            15);
+
+  EXPECT_GT(num_ticks, 0);
+  EXPECT_GT(td->get_timestamp(), 0);
+  EXPECT_EQ(td->get_game_state(), GAME_STATE::IDLE);
+  // nothing was defending, so every mob in the wave made it through
+  EXPECT_EQ(td->get_td_backend()->get_player_state().get_num_lives(), 10);
+}
+
+TEST(DTDMobTableTest, HandlesSurviveRemoval) {
+  MobTable mobs;
+  MonsterStats stats(100, 0.05, Elements::CHAOS, 1, 0.1, 0);
+  auto mob_a = mobs.add_mob(CharacterModels::ModelIDs::ogre_S, 0, stats,
+                            Coordinate<float>(0.1f, 0.1f));
+  auto mob_b = mobs.add_mob(CharacterModels::ModelIDs::ogre_S, 1, stats,
+                            Coordinate<float>(0.2f, 0.2f));
+  auto mob_c = mobs.add_mob(CharacterModels::ModelIDs::ogre_S, 2, stats,
+                            Coordinate<float>(0.3f, 0.3f));
+  EXPECT_EQ(mobs.size(), 3);
+
+  // removing the first mob swaps the last one into its place
+  mobs.remove(mob_a);
+  EXPECT_EQ(mobs.size(), 2);
+  EXPECT_FALSE(mobs.contains(mob_a));
+  ASSERT_TRUE(mobs.contains(mob_c));
+  EXPECT_EQ(mobs.index_of(mob_c), 0);
+  EXPECT_EQ(mobs.ids[mobs.index_of(mob_c)], 2);
+  EXPECT_FLOAT_EQ(mobs.get_position(mobs.index_of(mob_b)).col, 0.2f);
+
+  // the freed slot gets reused, but the stale handle stays stale
+  auto mob_d = mobs.add_mob(CharacterModels::ModelIDs::ogre_S, 3, stats,
+                            Coordinate<float>(0.4f, 0.4f));
+  EXPECT_EQ(mob_d.slot, mob_a.slot);
+  EXPECT_FALSE(mobs.contains(mob_a));
+  EXPECT_TRUE(mobs.contains(mob_d));
+
+  EXPECT_FALSE(mobs.recieve_damage(mobs.index_of(mob_b), 100));
+  mobs.clear();
+  EXPECT_TRUE(mobs.empty());
+  EXPECT_FALSE(mobs.contains(mob_b));
+}
+
+TEST(DTDSpatialGridTest, CellAndRangeQueries) {
+  MobTable mobs;
+  MonsterStats stats(100, 0.05, Elements::CHAOS, 1, 0.1, 0);
+  // 2 mobs in the same tile, 1 nearby, and 1 (out of bounds) in the far corner
+  const std::vector<Coordinate<float>> positions{
+      {0.501f, 0.501f}, {0.505f, 0.505f}, {0.53f, 0.5f}, {1.05f, 1.05f}};
+  for (size_t idx = 0; idx < positions.size(); ++idx) {
+    mobs.add_mob(CharacterModels::ModelIDs::ogre_S, static_cast<uint32_t>(idx),
+                 stats, positions[idx]);
+  }
+
+  SpatialGrid<GameMap> grid;
+  grid.rebuild(mobs);
+  EXPECT_EQ(grid.size(), 4);
+
+  auto cell = grid.get_cell(0.501f, 0.501f);
+  auto cell_mobs = grid.get_cell_mobs(cell.col, cell.row);
+  ASSERT_EQ(cell_mobs.size(), 2);
+  EXPECT_EQ(*cell_mobs.begin(), 0);
+  EXPECT_EQ(*(cell_mobs.begin() + 1), 1);
+  EXPECT_EQ(grid.get_cell_mobs(Coordinate<float>(0.999f, 0.999f)).size(), 1);
+
+  std::vector<uint32_t> found;
+  grid.query_radius(Coordinate<float>(0.5f, 0.5f), 0.02f, found);
+  EXPECT_EQ(found.size(), 2);
+
+  found.clear();
+  grid.query_rect(Coordinate<float>(0.49f, 0.49f),
+                  Coordinate<float>(0.55f, 0.51f), found);
+  EXPECT_EQ(found.size(), 3);
+
+  // the grid is rebuilt from scratch -- removed mobs just disappear
+  mobs.remove(mobs.handle_of(0));
+  grid.rebuild(mobs);
+  EXPECT_EQ(grid.get_cell_mobs(cell.col, cell.row).size(), 1);
+}
+
+TEST(DTDPathfinderTest, FlowFieldAroundWall) {
+  // NOTE: these are too big for the stack
+  std::unique_ptr<GameMap> map(new GameMap());
+  std::unique_ptr<Pathfinder<GameMap>> path_finder(new Pathfinder<GameMap>());
+
+  // wall off the top row of tower blocks, except for the right-most one
+  for (int block_col = 0; block_col < 7; ++block_col) {
+    const int col = block_col * GameMap::TowerTileWidth;
+    map->set_obstructed(
+        GameMap::TowerCoordinate(
+            std::make_tuple(col, col + GameMap::TowerTileWidth),
+            std::make_tuple(GameMap::TowerTileHeight,
+                            2 * GameMap::TowerTileHeight)),
+        true);
+  }
+
+  const GameMap::IndexCoordinate spawn(GameMap::MAP_WIDTH - 1,
+                                       GameMap::MAP_HEIGHT - 1);
+  const GameMap::IndexCoordinate dest(0, 0);
+  ASSERT_TRUE((*path_finder)(*map, spawn, dest));
+  EXPECT_EQ(path_finder->get_destination(), map->get_tile(dest));
+
+  // any tile can follow the field to the destination, 1 step at a time
+  const MapTile *tile = map->get_tile(5, 40);
+  int distance = path_finder->get_distance(tile);
+  // has to go around the wall
+  EXPECT_GT(distance, 5 + 40);
+  while (tile != map->get_tile(dest)) {
+    auto next_tile = path_finder->get_next_tile(tile);
+    ASSERT_NE(next_tile, nullptr);
+    EXPECT_FALSE(map->is_obstructed(next_tile->idx_location.col,
+                                    next_tile->idx_location.row));
+    EXPECT_EQ(path_finder->get_distance(next_tile), distance - 1);
+    distance--;
+    tile = next_tile;
+  }
+  EXPECT_EQ(path_finder->get_path(map->get_tile(spawn)).size(),
+            path_finder->get_distance(map->get_tile(spawn)) + 1);
+
+  // the wall tiles can't reach anything
+  EXPECT_FALSE(path_finder->is_reachable(map->get_tile(0, 20)));
+}
+
+TEST(DTDPathfinderTest, IncrementalRepairMatchesRecompute) {
+  std::unique_ptr<GameMap> map(new GameMap());
+  std::unique_ptr<Pathfinder<GameMap>> path_finder(new Pathfinder<GameMap>());
+  std::unique_ptr<Pathfinder<GameMap>> full_finder(new Pathfinder<GameMap>());
+
+  const GameMap::IndexCoordinate spawn(GameMap::MAP_WIDTH - 1,
+                                       GameMap::MAP_HEIGHT - 1);
+  const GameMap::IndexCoordinate dest(0, 0);
+  ASSERT_TRUE((*path_finder)(*map, spawn, dest));
+
+  auto check_distances = [&]() {
+    const bool has_path = (*full_finder)(*map, spawn, dest);
+    EXPECT_EQ(path_finder->is_reachable(map->get_tile(spawn)), has_path);
+    for (int row = 0; row < GameMap::MAP_HEIGHT; ++row) {
+      for (int col = 0; col < GameMap::MAP_WIDTH; ++col) {
+        ASSERT_EQ(path_finder->get_distance(map->get_tile(col, row)),
+                  full_finder->get_distance(map->get_tile(col, row)))
+            << "at [" << col << ", " << row << "]";
+      }
+    }
+  };
+
+  // build a zig-zag maze, 1 tower block at a time
+  std::vector<GameMap::TowerCoordinate> blocks;
+  for (int block_row = 1; block_row < 7; block_row += 2) {
+    for (int block_col = 0; block_col < 7; ++block_col) {
+      const int col = (block_row % 4 == 1 ? block_col : block_col + 1) *
+                      GameMap::TowerTileWidth;
+      const int row = block_row * GameMap::TowerTileHeight;
+      blocks.emplace_back(
+          std::make_tuple(col, col + GameMap::TowerTileWidth),
+          std::make_tuple(row, row + GameMap::TowerTileHeight));
+      map->set_obstructed(blocks.back(), true);
+      path_finder->obstruct_region(*map, blocks.back());
+    }
+  }
+  check_distances();
+
+  // then sell some of them
+  for (size_t block_idx = 0; block_idx < blocks.size(); block_idx += 3) {
+    map->set_obstructed(blocks[block_idx], false);
+    path_finder->clear_region(*map, blocks[block_idx]);
+  }
+  check_distances();
+}
+
+TEST(DTDPathfinderTest, BlockingBuildsMatchBruteForce) {
+  std::unique_ptr<GameMap> map(new GameMap());
+  std::unique_ptr<Pathfinder<GameMap>> path_finder(new Pathfinder<GameMap>());
+  BlockConnectivity<GameMap> connectivity;
+
+  const GameMap::IndexCoordinate spawn(GameMap::MAP_WIDTH - 1,
+                                       GameMap::MAP_HEIGHT - 1);
+  const GameMap::IndexCoordinate dest(0, 0);
+  auto make_block = [](const int block_col, const int block_row) {
+    const int col = block_col * GameMap::TowerTileWidth;
+    const int row = block_row * GameMap::TowerTileHeight;
+    return GameMap::TowerCoordinate(
+        std::make_tuple(col, col + GameMap::TowerTileWidth),
+        std::make_tuple(row, row + GameMap::TowerTileHeight));
+  };
+
+  // a wall across the map with a 1-block gap, plus a few scattered blocks
+  for (int block_col = 0; block_col < 7; ++block_col) {
+    map->set_obstructed(make_block(block_col, 4), true);
+  }
+  map->set_obstructed(make_block(6, 6), true);
+  map->set_obstructed(make_block(2, 1), true);
+  connectivity.rebuild(*map, spawn, dest);
+  ASSERT_TRUE(connectivity.is_connected());
+
+  int num_blocking = 0;
+  for (int block_row = 0; block_row < TowerLogic::TLIST_HEIGHT; ++block_row) {
+    for (int block_col = 0; block_col < TowerLogic::TLIST_WIDTH; ++block_col) {
+      auto block = make_block(block_col, block_row);
+      if (map->is_obstructed(block)) {
+        continue;
+      }
+      // try building there for real
+      map->set_obstructed(block, true);
+      const bool has_path = (*path_finder)(*map, spawn, dest);
+      map->set_obstructed(block, false);
+
+      EXPECT_EQ(connectivity.blocks_path(block), !has_path)
+          << "at block [" << block_col << ", " << block_row << "]";
+      num_blocking += !has_path;
+    }
+  }
+  // the gap, the spawn and the destination at the least
+  EXPECT_GE(num_blocking, 3);
+}
+
+TEST(DTDPathfinderTest, RemovedTowersReopenThePath) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  TowerLogic *backend = td->get_td_backend();
+  auto block_center = [](const int block_col, const int block_row) {
+    return std::make_pair((block_col + 0.5f) / TowerLogic::TLIST_WIDTH,
+                          (block_row + 0.5f) / TowerLogic::TLIST_HEIGHT);
+  };
+
+  // a wall across the map, with a 1-block gap at the end
+  for (int block_col = 0; block_col < TowerLogic::TLIST_WIDTH - 1; ++block_col) {
+    const auto center = block_center(block_col, 4);
+    ASSERT_TRUE(backend->make_tower(block_col, 1, center.first, center.second));
+  }
+  const auto gap = block_center(TowerLogic::TLIST_WIDTH - 1, 4);
+  EXPECT_TRUE(backend->blocks_path(gap.first, gap.second));
+
+  // taking a tower out of the wall makes for a 2nd way through
+  const auto removed = block_center(2, 4);
+  EXPECT_TRUE(TowerLogicTestAccess::remove_tower(*backend, removed.first,
+                                                 removed.second));
+  EXPECT_EQ(backend->get_tower(removed.first, removed.second), nullptr);
+  EXPECT_FALSE(backend->is_obstructed(2 * GameMap::TowerTileWidth,
+                                      4 * GameMap::TowerTileHeight));
+  EXPECT_FALSE(backend->blocks_path(gap.first, gap.second));
+  EXPECT_FALSE(TowerLogicTestAccess::remove_tower(*backend, removed.first,
+                                                  removed.second));
+
+  // every mob still makes it to the end (or gets killed on the way)
+  td->run_until_wave_end();
+  EXPECT_EQ(backend->get_num_live_mobs(), 0);
+  EXPECT_EQ(backend->get_player_state().get_num_lives(),
+            10 + static_cast<int>(backend->get_num_mobs_killed()));
+}
+
+TEST(DTDPathfinderTest, PathBlockingBuildsAreRejected) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  using UserTowerEvents::tower_command;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  TowerLogic *backend = td->get_td_backend();
+  auto block_col_center = [](const int block_col) {
+    return (block_col + 0.5f) / TowerLogic::TLIST_WIDTH;
+  };
+  const float wall_row = 4.5f / TowerLogic::TLIST_HEIGHT;
+
+  // a wall across the map, with a 2-block gap at the end
+  uint32_t tower_id = 0;
+  for (int block_col = 0; block_col < TowerLogic::TLIST_WIDTH - 2; ++block_col) {
+    ASSERT_TRUE(backend->make_tower(tower_id++, 1, block_col_center(block_col),
+                                    wall_row));
+  }
+
+  // building on the destination would wall off the mobs...
+  EXPECT_FALSE(backend->make_tower(tower_id, 1, 0.01f, 0.01f));
+  EXPECT_FALSE(backend->is_obstructed(0, 0));
+  EXPECT_EQ(backend->get_tower(0.01f, 0.01f), nullptr);
+
+  // ... as would closing the wall, even from within a batch
+  const std::vector<tower_command> commands{
+      tower_command::build(tower_id, 1,
+                           block_col_center(TowerLogic::TLIST_WIDTH - 2),
+                           wall_row),
+      tower_command::build(tower_id + 1, 1,
+                           block_col_center(TowerLogic::TLIST_WIDTH - 1),
+                           wall_row)};
+  EXPECT_EQ(backend->apply_commands(commands, std::vector<tower_properties>()),
+            1);
+  const float last_col = block_col_center(TowerLogic::TLIST_WIDTH - 1);
+  EXPECT_EQ(backend->get_tower(last_col, wall_row), nullptr);
+  EXPECT_FALSE(backend->is_obstructed((TowerLogic::TLIST_WIDTH - 1) *
+                                          GameMap::TowerTileWidth,
+                                      4 * GameMap::TowerTileHeight));
+  EXPECT_TRUE(backend->blocks_path(last_col, wall_row));
+  EXPECT_FALSE(backend->make_tower(tower_id + 2, 1, last_col, wall_row));
+
+  // so every mob still has a way through (NOTE: the cap is s.t. a walled in
+  // wave fails the test rather than hanging it)
+  td->run_until_wave_end(5000);
+  EXPECT_EQ(backend->get_num_live_mobs(), 0);
+  EXPECT_EQ(backend->get_player_state().get_num_lives(),
+            10 + static_cast<int>(backend->get_num_mobs_killed()));
+}
+
+TEST(DTDTargetingTest, StencilIsClosestFirst) {
+  RangeStencil<GameMap> stencil;
+
+  // every tile offset around the block center, minus the tower's own block
+  const size_t num_tiles = std::distance(stencil.begin(), stencil.end());
+  EXPECT_EQ(num_tiles, 4 * GameMap::MAP_WIDTH * GameMap::MAP_HEIGHT -
+                           GameMap::TowerTileWidth * GameMap::TowerTileHeight);
+
+  // closest first, and the distances are from the block center
+  float prev_distance_sq = 0;
+  for (const auto &tile : stencil) {
+    ASSERT_GE(tile.distance_sq, prev_distance_sq);
+    prev_distance_sq = tile.distance_sq;
+
+    const float col_dist = (tile.col_offset + 0.5f) * GameMap::NormFactorWidth;
+    const float row_dist = (tile.row_offset + 0.5f) * GameMap::NormFactorHeight;
+    ASSERT_FLOAT_EQ(tile.distance_sq, col_dist * col_dist + row_dist * row_dist);
+  }
+
+  // the closest tiles are the ones bordering the tower's block
+  const float border_dist = (GameMap::TowerTileWidth / 2 + 0.5f) *
+                            GameMap::NormFactorWidth;
+  const float min_dist = 0.5f * GameMap::NormFactorHeight;
+  EXPECT_FLOAT_EQ(stencil.begin()->distance_sq,
+                  border_dist * border_dist + min_dist * min_dist);
+}
+
+TEST(DTDTargetingTest, ManualTargetsAreColRow) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  using UserTowerEvents::tower_command;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  TowerLogic *backend = td->get_td_backend();
+
+  // a wall with the gap at the far end, so the mobs come down well off the
+  // diagonal -- i.e. their (row, col) is nowhere near their (col, row)
+  const float wall_row = 4.5f / TowerLogic::TLIST_HEIGHT;
+  for (int block_col = 0; block_col < TowerLogic::TLIST_WIDTH - 2; ++block_col) {
+    ASSERT_TRUE(backend->make_tower(
+        block_col, 1, (block_col + 0.5f) / TowerLogic::TLIST_WIDTH, wall_row));
+  }
+  const float tower_col = 0.5f / TowerLogic::TLIST_WIDTH;
+  Tower *tower = backend->get_tower(tower_col, wall_row);
+  ASSERT_NE(tower, nullptr);
+
+  // nothing to pick out before the wave
+  EXPECT_FALSE(backend->tower_target(tower_col, wall_row, 0.9f, 0.9f));
+
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+  const MobTable &live_mobs = backend->get_live_mobs();
+  auto mobs_near = [&live_mobs](const float col, const float row) {
+    const float radius = 1.0f / TowerLogic::TLIST_WIDTH;
+    for (size_t mob_idx = 0; mob_idx < live_mobs.size(); ++mob_idx) {
+      const float col_diff = live_mobs.pos_col[mob_idx] - col;
+      const float row_diff = live_mobs.pos_row[mob_idx] - row;
+      if (col_diff * col_diff + row_diff * row_diff < radius * radius) {
+        return true;
+      }
+    }
+    return false;
+  };
+  int mob_idx = -1;
+  for (int tick = 0; tick < 400 && mob_idx < 0; ++tick) {
+    td->run_ticks(1);
+    for (size_t idx = 0; idx < live_mobs.size(); ++idx) {
+      if (!mobs_near(live_mobs.pos_row[idx], live_mobs.pos_col[idx])) {
+        mob_idx = static_cast<int>(idx);
+        break;
+      }
+    }
+  }
+  ASSERT_GE(mob_idx, 0);
+  const MobHandle mob = live_mobs.handle_of(mob_idx);
+  const float mob_col = live_mobs.pos_col[mob_idx];
+  const float mob_row = live_mobs.pos_row[mob_idx];
+
+  // the location is (col, row), same as the tower's
+  EXPECT_FALSE(backend->tower_target(tower_col, wall_row, mob_row, mob_col));
+  EXPECT_TRUE(backend->tower_target(tower_col, wall_row, mob_col, mob_row));
+  EXPECT_EQ(tower->get_target_handle(), mob);
+
+  // the commands too, while the events are given as (row, col)
+  tower->reset_target();
+  const std::vector<tower_command> commands{
+      tower_command::target(tower_col, wall_row, mob_col, mob_row)};
+  EXPECT_EQ(backend->apply_commands(commands, std::vector<tower_properties>()),
+            1);
+  EXPECT_EQ(tower->get_target_handle(), mob);
+
+  tower->reset_target();
+  UserTowerEvents::tower_target_event<TowerLogic> target_event(
+      wall_row, tower_col, mob_row, mob_col);
+  target_event.apply(backend);
+  EXPECT_EQ(tower->get_target_handle(), mob);
+}
+
+TEST(DTDTargetingTest, TargetsAreWithinRange) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  TowerLogic *backend = td->get_td_backend();
+
+  const int t_col = 3;
+  const int t_row = 3;
+  const float block_center = (t_col + 0.5f) / TowerLogic::TLIST_WIDTH;
+  ASSERT_TRUE(backend->make_tower(0, 1, block_center, block_center));
+  Tower *tower = backend->get_tower(block_center, block_center);
+  ASSERT_NE(tower, nullptr);
+  // bring the range down to a few tiles past the tower's block
+  tower_properties range_props;
+  range_props.modifier.attack_range_value = 0.15f - tower->get_attack_range();
+  tower->set_properties(std::move(range_props));
+  const auto tower_center = tower->get_position();
+  const float range = tower->get_attack_range();
+
+  // the tower's block center is on a tile corner, so the tile that's
+  // [col, col + 1) x [row, row + 1) tiles out is centered at (col + 0.5, row +
+  // 0.5) tiles out, whichever direction we go in
+  const float tile_width = GameMap::NormFactorWidth;
+  auto tile_dist = [tile_width](const float col, const float row) {
+    return std::hypot(col * tile_width, row * tile_width);
+  };
+  // find a tile (outside of the tower's block) with its center in range but
+  // its far corner out of range, and one the other way around
+  int out_col = -1, out_row = -1, in_col = -1, in_row = -1;
+  for (int row = GameMap::TowerTileHeight / 2; row < GameMap::MAP_HEIGHT / 2;
+       ++row) {
+    for (int col = 0; col < GameMap::MAP_WIDTH / 2; ++col) {
+      const float center_dist = tile_dist(col + 0.5f, row + 0.5f);
+      if (center_dist < range && tile_dist(col + 0.99f, row + 0.99f) > range) {
+        out_col = col;
+        out_row = row;
+      }
+      if (center_dist > range && tile_dist(col + 0.01f, row + 0.01f) < range) {
+        in_col = col;
+        in_row = row;
+      }
+    }
+  }
+  ASSERT_GE(out_col, 0);
+  ASSERT_GE(in_col, 0);
+
+  // a mob out of range, in a tile whose center is in range...
+  TowerLogicTestAccess::add_mob(
+      *backend, 0,
+      Coordinate<float>(tower_center.col + (out_col + 0.99f) * tile_width,
+                        tower_center.row + (out_row + 0.99f) * tile_width));
+  EXPECT_FALSE(
+      TowerLogicTestAccess::get_targets(*backend, tower, t_col, t_row));
+
+  // ... doesn't hide one in range, in a tile whose center isn't
+  auto in_range_mob = TowerLogicTestAccess::add_mob(
+      *backend, 1,
+      Coordinate<float>(tower_center.col - (in_col + 0.01f) * tile_width,
+                        tower_center.row - (in_row + 0.01f) * tile_width));
+  EXPECT_TRUE(
+      TowerLogicTestAccess::get_targets(*backend, tower, t_col, t_row));
+  EXPECT_EQ(tower->get_target_handle(), in_range_mob);
+}
+
+TEST(DTDDamageTest, BatchMatchesScalar) {
+  // the affinity lookup is <attacker, defender>
+  using ElementInfo::get_damage_coeff;
+  EXPECT_EQ(get_damage_coeff(Elements::CHAOS, Elements::FIRE), 1.0);
+  EXPECT_EQ(get_damage_coeff(Elements::WATER, Elements::FIRE), 1.2);
+  EXPECT_EQ(get_damage_coeff(Elements::FIRE, Elements::WATER), 0.75);
+  EXPECT_EQ(get_damage_coeff(Elements::AIR, Elements::FIRE), 0.8);
+  EXPECT_EQ(get_damage_coeff(Elements::EARTH, Elements::AIR), 0.9);
+
+  // a spread of attacks and mobs, s.t. we get crits, non-crits, and all of the
+  // mitigation cases
+  std::vector<tower_properties> attacks;
+  std::vector<MonsterStats> mobs;
+  for (int hit_idx = 0; hit_idx < 64; hit_idx++) {
+    tower_properties props;
+    for (int elem_idx = 0; elem_idx < tower_properties::NUM_ELEM; elem_idx++) {
+      props.modifier.damage_value[elem_idx] =
+          tower_properties::dmg_dist(hit_idx + elem_idx, 3 * hit_idx + 10);
+      props.modifier.enhanced_damage_value[elem_idx] = 0.05f * elem_idx;
+      props.modifier.enhanced_damage_affinity[elem_idx] = 0.1f * (hit_idx % 3);
+      props.modifier.added_damage_value[elem_idx] = 1.5f * (hit_idx % 4);
+    }
+    props.modifier.crit_chance_value = 0.3f;
+    props.modifier.crit_multiplier_value = 1.25f;
+    attacks.push_back(props);
+
+    const Elements armor = static_cast<Elements>(hit_idx % 5);
+    mobs.emplace_back(100, 1, armor, hit_idx % 7, 0.02f * (hit_idx % 5),
+                      (hit_idx % 4 == 0) ? 20.0f : 0.0f);
+  }
+
+  // both have to see the same random rolls
+  Randomize::EngineType engine(42);
+  const auto engine_state = engine;
+
+  std::vector<float> scalar_damage;
+  for (size_t hit_idx = 0; hit_idx < attacks.size(); hit_idx++) {
+    scalar_damage.push_back(
+        compute_damage(attacks[hit_idx], mobs[hit_idx], engine));
+  }
+
+  engine = engine_state;
+  DamageBatch batch;
+  for (size_t hit_idx = 0; hit_idx < attacks.size(); hit_idx++) {
+    EXPECT_EQ(batch.add_hit(attacks[hit_idx], mobs[hit_idx], engine), hit_idx);
+  }
+  compute_damage(batch);
+
+  ASSERT_EQ(batch.hit_damage.size(), scalar_damage.size());
+  for (size_t hit_idx = 0; hit_idx < scalar_damage.size(); hit_idx++) {
+    EXPECT_EQ(batch.hit_damage[hit_idx], scalar_damage[hit_idx])
+        << "hit " << hit_idx;
+  }
+
+  // and it should be reusable
+  batch.clear();
+  EXPECT_TRUE(batch.empty());
+  compute_damage(batch);
+  EXPECT_TRUE(batch.hit_damage.empty());
+}
+
+TEST(DTDAttackPoolTest, SwapRemoveAcrossPolicies) {
+  AttackPool attacks;
+  MobTable live_mobs;
+  auto make_params = [](const uint32_t attack_id) {
+    TowerAttackParams params(tower_properties(), nullptr, attack_id);
+    params.move_speed = 0.15;
+    params.origin_timestamp = 0;
+    params.origin_position = Coordinate<float>(0.5f, 0.5f);
+    params.target_position = Coordinate<float>(0.5f, 0.5f);
+    return params;
+  };
+
+  for (int attack_idx = 0; attack_idx < 4; attack_idx++) {
+    attacks.add_attack(make_params(attack_idx),
+                       FixedAttackMovement());
+  }
+  for (int attack_idx = 0; attack_idx < 3; attack_idx++) {
+    attacks.add_attack(make_params(10 + attack_idx),
+                       HomingAttackMovement(&live_mobs, MobHandle()));
+  }
+  EXPECT_EQ(attacks.size(), 7);
+  EXPECT_EQ(attacks.get_attacks<FixedAttackMovement>().size(), 4);
+  EXPECT_EQ(attacks.get_attacks<HomingAttackMovement>().size(), 3);
+
+  // drop every other attack from both policies
+  attacks.remove_if([](const TowerAttackBase &attack) {
+    return attack.get_id() % 2 == 0;
+  });
+  EXPECT_EQ(attacks.get_attacks<FixedAttackMovement>().size(), 2);
+  EXPECT_EQ(attacks.get_attacks<HomingAttackMovement>().size(), 1);
+
+  std::vector<uint32_t> remaining;
+  attacks.for_each([&remaining](auto &attack) {
+    // all of the attacks are already at their target
+    attack.move_update(0);
+    EXPECT_TRUE(attack.hit_target());
+    remaining.push_back(attack.get_id());
+  });
+  std::sort(remaining.begin(), remaining.end());
+  EXPECT_EQ(remaining, std::vector<uint32_t>({1, 3, 11}));
+
+  attacks.clear();
+  EXPECT_TRUE(attacks.empty());
+}
+
+TEST(DTDParallelTest, TowerPhaseMatchesSerial) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto make_game = [](const size_t parallel_threshold) {
+    auto td = std::make_shared<TDType>(
+        42, std::unique_ptr<GameClock>(new VirtualClock()));
+    td->init_game();
+    TestStubs::add_tower_displayinfo(td);
+    td->get_td_backend()->set_parallel_tower_threshold(parallel_threshold);
+    // NOTE: regardless of how many cores the test machine has
+    td->get_td_backend()->set_num_tower_threads(4);
+
+    // a few walls of towers, leaving a winding path through them
+    uint32_t tower_id = 0;
+    for (int block_col = 0; block_col < 6; ++block_col) {
+      const float col = (block_col + 0.5f) / TowerLogic::TLIST_WIDTH;
+      const float gap_col = (block_col + 2.5f) / TowerLogic::TLIST_WIDTH;
+      td->get_td_backend()->make_tower(tower_id++, 1, col, 2.5f / 8);
+      td->get_td_backend()->make_tower(tower_id++, 1, gap_col, 4.5f / 8);
+      td->get_td_backend()->make_tower(tower_id++, 1, col, 6.5f / 8);
+    }
+    return td;
+  };
+
+  // the mob health every few ticks throughout the wave
+  auto run_wave = [](std::shared_ptr<TDType> &td) {
+    std::vector<std::vector<float>> wave_health;
+    while (td->get_game_state() != GAME_STATE::ACTIVE) {
+      td->run_ticks(1);
+    }
+    while (td->get_game_state() == GAME_STATE::ACTIVE) {
+      td->run_ticks(10);
+      wave_health.push_back(td->get_td_backend()->get_live_mobs().health);
+    }
+    return wave_health;
+  };
+
+  // NOTE: both games have the same seed, so they see the same random rolls
+  auto serial_td = make_game(std::numeric_limits<size_t>::max());
+  const auto serial_health = run_wave(serial_td);
+
+  auto parallel_td = make_game(0);
+  const auto parallel_health = run_wave(parallel_td);
+
+  EXPECT_FALSE(serial_health.empty());
+  EXPECT_EQ(parallel_health, serial_health);
+  EXPECT_EQ(parallel_td->get_timestamp(), serial_td->get_timestamp());
+  EXPECT_EQ(parallel_td->get_td_backend()->get_player_state().get_num_lives(),
+            serial_td->get_td_backend()->get_player_state().get_num_lives());
+}
+
+TEST(DTDEventQueueTest, SPSCKeepsOrderAcrossThreads) {
+  SPSCEventQueue<int> evt_queue(100);
+  EXPECT_EQ(evt_queue.capacity(), 128);
+
+  // a full queue drops the new events
+  for (int evt_idx = 0; evt_idx < 130; evt_idx++) {
+    EXPECT_EQ(evt_queue.push(std::unique_ptr<int>(new int(evt_idx))),
+              evt_idx < 128);
+  }
+  EXPECT_EQ(evt_queue.size(), 128);
+  bool got_evt = false;
+  for (int evt_idx = 0; evt_idx < 128; evt_idx++) {
+    auto evt = evt_queue.pop(got_evt);
+    ASSERT_TRUE(got_evt);
+    EXPECT_EQ(*evt, evt_idx);
+  }
+  EXPECT_EQ(evt_queue.pop(got_evt), nullptr);
+  EXPECT_FALSE(got_evt);
+
+  // the consumer should see every event, in order (the producer retries
+  // rather than dropping)
+  const int num_events = 20000;
+  std::thread producer([&evt_queue, num_events]() {
+    for (int evt_idx = 0; evt_idx < num_events; evt_idx++) {
+      std::unique_ptr<int> evt(new int(evt_idx));
+      while (evt_queue.size() == evt_queue.capacity()) {
+        std::this_thread::yield();
+      }
+      evt_queue.push(std::move(evt));
+    }
+  });
+
+  int expected_evt = 0;
+  while (expected_evt < num_events) {
+    auto evt = evt_queue.pop(got_evt);
+    if (got_evt) {
+      ASSERT_EQ(*evt, expected_evt);
+      expected_evt++;
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(evt_queue.empty());
+}
+
+TEST(DTDEventQueueTest, OneFramePerTick) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  ViewEvents *game_events = td->get_td_backend()->get_frontend_eventqueue();
+
+  // get the wave going
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+  td->run_ticks(1);
+
+  // the mobs are all spawned on the same tick, along with the state transition
+  size_t num_frames = 0;
+  uint64_t last_tick = 0;
+  const RenderFrame *spawn_frame = nullptr;
+  std::vector<std::unique_ptr<RenderFrame>> frames;
+  for (auto frame = game_events->pop_frame(); frame;
+       frame = game_events->pop_frame()) {
+    EXPECT_FALSE(frame->empty());
+    EXPECT_GT(frame->tick, last_tick);
+    last_tick = frame->tick;
+    if (!frame->mob_builds.empty()) {
+      spawn_frame = frame.get();
+    }
+    num_frames++;
+    frames.push_back(std::move(frame));
+  }
+  ASSERT_NE(spawn_frame, nullptr);
+  EXPECT_EQ(spawn_frame->mob_builds.size(),
+            td->get_td_backend()->get_num_live_mobs());
+  ASSERT_EQ(spawn_frame->state_transitions.size(), 1);
+  EXPECT_EQ(spawn_frame->state_transitions[0].new_state, GAME_STATE::ACTIVE);
+  // and the following tick has their paths
+  EXPECT_EQ(frames.back()->mob_paths.size(),
+            td->get_td_backend()->get_num_live_mobs());
+  for (auto &frame : frames) {
+    game_events->release_frame(std::move(frame));
+  }
+
+  // the paths still hold, so there's nothing more to send for the mobs
+  td->run_ticks(3);
+  size_t num_paths = 0;
+  auto count_paths = [&num_paths](
+                         std::unique_ptr<RenderEvents::mob_path> evt,
+                         const RenderEvents::waypoint *) {
+    EXPECT_NE(evt, nullptr);
+    num_paths++;
+  };
+  game_events->apply_mobpath_events(count_paths);
+  EXPECT_EQ(num_paths, 0);
+  EXPECT_EQ(game_events->pop_frame(), nullptr);
+}
+
+TEST(DTDNameRegistryTest, InternedIDsResolveAtTheFrontend) {
+  NameRegistry names;
+  const uint32_t ogre_id = names.intern("ogre_w0_mob_0");
+  const uint32_t tower_id = names.intern("tower_0_0");
+  EXPECT_NE(ogre_id, tower_id);
+  // interning again gives back the same ID
+  EXPECT_EQ(names.intern("ogre_w0_mob_0"), ogre_id);
+  EXPECT_EQ(names.size(), 2);
+  EXPECT_EQ(names.find("tower_0_0"), tower_id);
+  EXPECT_EQ(names.find("tower_1_1"), NameRegistry::INVALID_ID);
+  EXPECT_EQ(names.get_name(ogre_id), "ogre_w0_mob_0");
+  EXPECT_THROW(names.get_name(tower_id + 1), std::logic_error);
+
+  // the events carry the IDs, which the frontend resolves via the backend's
+  // registry
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  ViewEvents *game_events = td->get_td_backend()->get_frontend_eventqueue();
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+
+  std::vector<uint32_t> mob_ids;
+  auto get_ids = [&mob_ids](std::unique_ptr<RenderEvents::create_mob> evt) {
+    mob_ids.push_back(evt->m_id);
+  };
+  game_events->apply_mobbuild_events(get_ids);
+  ASSERT_EQ(mob_ids.size(), td->get_td_backend()->get_num_live_mobs());
+  std::set<std::string> mob_names;
+  for (const auto mob_id : mob_ids) {
+    mob_names.insert(game_events->get_entity_name(mob_id));
+  }
+  EXPECT_EQ(mob_names.size(), mob_ids.size());
+  EXPECT_EQ(mob_ids, td->get_td_backend()->get_live_mobs().ids);
+}
+
+TEST(DTDEventQueueTest, FramesAreRecycledWithoutReallocating) {
+  ViewEvents game_events;
+  // NOTE: the waypoints are {mob id, waypoint index}, to tell them apart
+  auto add_path = [&game_events](const uint32_t mob_id,
+                                 const int num_waypoints) {
+    game_events.add_mobpath_event(
+        RenderEvents::mob_path(mob_id, 0.5f, 0.5f, 0.05f, 1));
+    for (int waypoint_idx = 0; waypoint_idx < num_waypoints; ++waypoint_idx) {
+      game_events.add_mobpath_waypoint(mob_id, waypoint_idx);
+    }
+  };
+
+  add_path(0, 3);
+  add_path(1, 2);
+  EXPECT_TRUE(game_events.publish_frame(1));
+  auto frame = game_events.pop_frame();
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ(frame->mob_paths.size(), 2);
+  EXPECT_EQ(frame->waypoints.size(), 5);
+  EXPECT_EQ(frame->mob_paths[1].num_waypoints, 2);
+  EXPECT_FLOAT_EQ(frame->get_waypoints(frame->mob_paths[1])[1].col, 1.0f);
+  EXPECT_FLOAT_EQ(frame->get_waypoints(frame->mob_paths[1])[1].row, 1.0f);
+
+  // once released, the frame (and its storage) gets used for a later tick
+  const RenderFrame *frame_ptr = frame.get();
+  const RenderEvents::waypoint *waypoints_ptr = frame->waypoints.data();
+  game_events.release_frame(std::move(frame));
+  add_path(2, 1);
+  game_events.publish_frame(2);
+  add_path(3, 4);
+  game_events.publish_frame(3);
+  auto next_frame = game_events.pop_frame();
+  ASSERT_NE(next_frame, nullptr);
+  auto recycled_frame = game_events.pop_frame();
+  ASSERT_NE(recycled_frame, nullptr);
+  EXPECT_EQ(recycled_frame.get(), frame_ptr);
+  EXPECT_EQ(recycled_frame->waypoints.data(), waypoints_ptr);
+  EXPECT_EQ(recycled_frame->timestamp, 3);
+  game_events.release_frame(std::move(next_frame));
+  game_events.release_frame(std::move(recycled_frame));
+
+  // the per-type helpers keep the waypoints with their paths across frames
+  add_path(4, 2);
+  game_events.publish_frame(4);
+  add_path(5, 3);
+  game_events.publish_frame(5);
+  std::vector<uint32_t> path_mobs;
+  auto check_path = [&path_mobs](std::unique_ptr<RenderEvents::mob_path> evt,
+                                 const RenderEvents::waypoint *waypoints) {
+    path_mobs.push_back(evt->id);
+    for (uint32_t waypoint_idx = 0; waypoint_idx < evt->num_waypoints;
+         ++waypoint_idx) {
+      EXPECT_FLOAT_EQ(waypoints[waypoint_idx].col, evt->id);
+      EXPECT_FLOAT_EQ(waypoints[waypoint_idx].row, waypoint_idx);
+    }
+  };
+  game_events.apply_mobpath_events(check_path);
+  EXPECT_EQ(path_mobs, std::vector<uint32_t>({4, 5}));
+}
+
+TEST(DTDMotionTest, MobPathsOnlySentOnChange) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  auto td_backend = td->get_td_backend();
+  for (int tower_idx = 0; tower_idx < 2; tower_idx++) {
+    td_backend->make_tower(tower_idx, 3, 0.5f + 0.13f * tower_idx, 0.3f);
+  }
+  ViewEvents *game_events = td_backend->get_frontend_eventqueue();
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+
+  // what the frontend knows of the mobs
+  struct known_path {
+    RenderEvents::mob_path path;
+    std::vector<RenderEvents::waypoint> waypoints;
+  };
+  std::map<uint32_t, known_path> mob_paths;
+  size_t num_mob_paths = 0;
+  size_t num_attack_builds = 0;
+  size_t num_attack_paths = 0;
+  auto follow_tick = [&]() {
+    td->run_ticks(1);
+    for (auto frame = game_events->pop_frame(); frame;
+         frame = game_events->pop_frame()) {
+      for (const auto &path : frame->mob_paths) {
+        const auto *waypoints = frame->get_waypoints(path);
+        mob_paths.insert_or_assign(
+            path.id, known_path{path, std::vector<RenderEvents::waypoint>(
+                                          waypoints,
+                                          waypoints + path.num_waypoints)});
+      }
+      num_mob_paths += frame->mob_paths.size();
+      num_attack_builds += frame->attack_builds.size();
+      num_attack_paths += frame->attack_paths.size();
+      game_events->release_frame(std::move(frame));
+    }
+
+    // the frontend's extrapolated positions match the backend's
+    const MobTable &live_mobs = td_backend->get_live_mobs();
+    for (size_t mob_idx = 0; mob_idx < live_mobs.size(); ++mob_idx) {
+      auto path_it = mob_paths.find(live_mobs.ids[mob_idx]);
+      ASSERT_NE(path_it, mob_paths.end());
+      auto position =
+          RenderEvents::extrapolate_mob(path_it->second.path,
+                                        path_it->second.waypoints.data(),
+                                        td->get_timestamp());
+      EXPECT_FLOAT_EQ(position.col, live_mobs.pos_col[mob_idx]);
+      EXPECT_FLOAT_EQ(position.row, live_mobs.pos_row[mob_idx]);
+    }
+  };
+
+  for (int tick = 0; tick < 40; tick++) {
+    follow_tick();
+  }
+  // 1 path per mob, rather than 1 move per mob per tick
+  EXPECT_EQ(num_mob_paths, mob_paths.size());
+  EXPECT_GT(num_attack_builds, 0);
+  EXPECT_GE(num_attack_paths, num_attack_builds);
+
+  // building a tower changes the flow field, so all of the paths get re-sent
+  const size_t num_live_mobs = td_backend->get_num_live_mobs();
+  ASSERT_GT(num_live_mobs, 0);
+  num_mob_paths = 0;
+  td_backend->make_tower(2, 3, 0.5f, 0.5f);
+  for (int tick = 0; tick < 40 && td->get_game_state() == GAME_STATE::ACTIVE;
+       tick++) {
+    follow_tick();
+  }
+  EXPECT_EQ(num_mob_paths, num_live_mobs);
+}
+
+TEST(DTDEventQueueTest, DrainAndWaitForEvents) {
+  EventQueue<int> evt_queue(10);
+  for (int evt_idx = 0; evt_idx < 5; evt_idx++) {
+    evt_queue.push(std::unique_ptr<int>(new int(evt_idx)));
+  }
+
+  // draining takes the oldest events first, and at most max_events of them
+  std::vector<std::unique_ptr<int>> events;
+  EXPECT_EQ(evt_queue.drain_into(events, 3), 3);
+  EXPECT_EQ(evt_queue.drain_into(events), 2);
+  EXPECT_EQ(evt_queue.drain_into(events), 0);
+  ASSERT_EQ(events.size(), 5);
+  for (int evt_idx = 0; evt_idx < 5; evt_idx++) {
+    EXPECT_EQ(*events[evt_idx], evt_idx);
+  }
+  EXPECT_TRUE(evt_queue.empty());
+
+  // an empty queue waits out the deadline...
+  bool got_evt = true;
+  const auto wait_start = std::chrono::steady_clock::now();
+  EXPECT_EQ(evt_queue.wait_pop(got_evt, wait_start +
+                                            std::chrono::milliseconds(20)),
+            nullptr);
+  EXPECT_FALSE(got_evt);
+  EXPECT_GE(std::chrono::steady_clock::now() - wait_start,
+            std::chrono::milliseconds(20));
+
+  //... but wakes up as soon as something gets pushed
+  std::thread producer([&evt_queue]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    evt_queue.push(std::unique_ptr<int>(new int(42)));
+  });
+  auto evt = evt_queue.wait_pop(got_evt, std::chrono::steady_clock::now() +
+                                             std::chrono::seconds(10));
+  producer.join();
+  ASSERT_TRUE(got_evt);
+  EXPECT_EQ(*evt, 42);
+
+  // same goes for the frontend waiting on the backend's frames
+  ViewEvents view_events;
+  EXPECT_FALSE(view_events.wait_for_frames(std::chrono::steady_clock::now() +
+                                           std::chrono::milliseconds(10)));
+  std::thread backend([&view_events]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    view_events.add_removemob_event(RenderEvents::remove_mob(3));
+    view_events.publish_frame(1);
+  });
+  EXPECT_TRUE(view_events.wait_for_frames(std::chrono::steady_clock::now() +
+                                          std::chrono::seconds(10)));
+  backend.join();
+  auto frame = view_events.pop_frame();
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ(frame->mob_removes.size(), 1);
+  EXPECT_EQ(frame->mob_removes[0].id, 3);
+}
+
+TEST(DTDEventQueueTest, OverflowPoliciesAndStats) {
+  auto fill_queue = [](EventQueue<int> &evt_queue) {
+    int num_accepted = 0;
+    for (int evt_idx = 0; evt_idx < 6; evt_idx++) {
+      num_accepted += evt_queue.push(std::unique_ptr<int>(new int(evt_idx)));
+    }
+    return num_accepted;
+  };
+  auto drain_queue = [](EventQueue<int> &evt_queue) {
+    std::vector<std::unique_ptr<int>> events;
+    evt_queue.drain_into(events);
+    std::vector<int> values;
+    for (auto &evt : events) {
+      values.push_back(*evt);
+    }
+    return values;
+  };
+
+  EventQueue<int> oldest_queue(4, 0, OverflowPolicy::DropOldest);
+  EXPECT_EQ(fill_queue(oldest_queue), 6);
+  auto stats = oldest_queue.get_stats();
+  EXPECT_EQ(stats.depth, 4);
+  EXPECT_EQ(stats.high_water, 4);
+  EXPECT_EQ(stats.num_pushed, 6);
+  EXPECT_EQ(stats.num_dropped, 2);
+  EXPECT_EQ(stats.num_full, 2);
+  EXPECT_EQ(drain_queue(oldest_queue), std::vector<int>({2, 3, 4, 5}));
+  EXPECT_EQ(oldest_queue.get_stats().depth, 0);
+  EXPECT_EQ(oldest_queue.get_stats().high_water, 4);
+
+  EventQueue<int> newest_queue(4, 0, OverflowPolicy::DropNewest);
+  EXPECT_EQ(fill_queue(newest_queue), 4);
+  EXPECT_EQ(newest_queue.get_stats().num_dropped, 2);
+  EXPECT_EQ(drain_queue(newest_queue), std::vector<int>({0, 1, 2, 3}));
+
+  // the newer events replace a queued one with the same parity
+  EventQueue<int> coalesce_queue(4, 0, OverflowPolicy::Coalesce);
+  coalesce_queue.set_coalesce_fn(
+      [](const int &queued, const int &incoming) {
+        return queued % 2 == incoming % 2;
+      });
+  EXPECT_EQ(fill_queue(coalesce_queue), 6);
+  stats = coalesce_queue.get_stats();
+  EXPECT_EQ(stats.num_coalesced, 2);
+  EXPECT_EQ(stats.num_dropped, 0);
+  EXPECT_EQ(drain_queue(coalesce_queue), std::vector<int>({0, 1, 4, 5}));
+
+  // the producer waits until there's room
+  EventQueue<int> block_queue(4, 0, OverflowPolicy::Block);
+  std::thread producer([&block_queue, &fill_queue]() {
+    EXPECT_EQ(fill_queue(block_queue), 6);
+  });
+  std::vector<int> values;
+  while (values.size() < 6) {
+    bool got_evt = false;
+    auto evt = block_queue.wait_pop(got_evt, std::chrono::steady_clock::now() +
+                                                 std::chrono::seconds(10));
+    ASSERT_TRUE(got_evt);
+    values.push_back(*evt);
+  }
+  producer.join();
+  EXPECT_EQ(values, std::vector<int>({0, 1, 2, 3, 4, 5}));
+  EXPECT_EQ(block_queue.get_stats().num_dropped, 0);
+  EXPECT_LE(block_queue.get_stats().high_water, 4);
+
+  // a frontend that falls behind doesn't lose any frames' lifecycle events --
+  // they get held back and merged into the next frame
+  ViewEvents view_events;
+  const uint32_t num_frames = 600;
+  for (uint32_t frame_idx = 0; frame_idx < num_frames; frame_idx++) {
+    view_events.add_removemob_event(RenderEvents::remove_mob(frame_idx));
+    view_events.publish_frame(frame_idx);
+  }
+  auto frame_stats = view_events.get_frame_stats();
+  EXPECT_GT(frame_stats.num_coalesced, 0);
+  EXPECT_EQ(frame_stats.num_dropped, 0);
+  EXPECT_EQ(frame_stats.depth, frame_stats.high_water);
+  EXPECT_EQ(frame_stats.num_pushed + frame_stats.num_coalesced, num_frames);
+
+  // NOTE: the held frame goes out once there's room again
+  auto frame = view_events.pop_frame();
+  view_events.release_frame(std::move(frame));
+  view_events.publish_frame(num_frames);
+  std::vector<uint32_t> removed_ids;
+  while ((frame = view_events.pop_frame())) {
+    for (const auto &evt : frame->mob_removes) {
+      removed_ids.push_back(evt.id);
+    }
+  }
+  EXPECT_EQ(removed_ids.size() + 1, num_frames);
+  for (size_t evt_idx = 0; evt_idx < removed_ids.size(); evt_idx++) {
+    EXPECT_EQ(removed_ids[evt_idx], evt_idx + 1);
+  }
+}
+
+TEST(DTDEventQueueTest, SupersededEventsAreCoalesced) {
+  RenderFrame frame;
+  auto add_path = [&frame](const uint32_t mob_id, const uint64_t start_ts,
+                           const int num_waypoints) {
+    frame.add_mob_path(RenderEvents::mob_path(mob_id, 0.5f, 0.5f, 0.05f,
+                                              start_ts));
+    for (int waypoint_idx = 0; waypoint_idx < num_waypoints; ++waypoint_idx) {
+      frame.add_mob_waypoint(RenderEvents::waypoint{
+          static_cast<float>(mob_id), static_cast<float>(waypoint_idx)});
+    }
+  };
+
+  // mob 1's newer path replaces its older one
+  frame.add_mob_build(
+      RenderEvents::create_mob(CharacterModels::ModelIDs::ogre_S, 1, 0, 0, 0));
+  add_path(1, 1, 2);
+  add_path(2, 1, 4);
+  add_path(1, 2, 3);
+  // mob 2 never gets seen, so its remove goes too...
+  frame.add_mob_build(
+      RenderEvents::create_mob(CharacterModels::ModelIDs::ogre_S, 2, 0, 0, 0));
+  frame.add_mob_remove(RenderEvents::remove_mob(2));
+  //... whereas mob 3's create went out already
+  add_path(3, 1, 1);
+  frame.add_mob_remove(RenderEvents::remove_mob(3));
+  frame.compact();
+
+  ASSERT_EQ(frame.mob_builds.size(), 1);
+  EXPECT_EQ(frame.mob_builds[0].m_id, 1);
+  ASSERT_EQ(frame.mob_paths.size(), 1);
+  EXPECT_EQ(frame.mob_paths[0].id, 1);
+  EXPECT_EQ(frame.mob_paths[0].start_timestamp, 2);
+  ASSERT_EQ(frame.mob_paths[0].num_waypoints, 3);
+  ASSERT_EQ(frame.waypoints.size(), 3);
+  for (int waypoint_idx = 0; waypoint_idx < 3; ++waypoint_idx) {
+    EXPECT_EQ(frame.get_waypoints(frame.mob_paths[0])[waypoint_idx].row,
+              waypoint_idx);
+  }
+  ASSERT_EQ(frame.mob_removes.size(), 1);
+  EXPECT_EQ(frame.mob_removes[0].id, 3);
+
+  // same for the attacks
+  frame.add_attack_build(RenderEvents::create_attack(7, 0, 0, 0, 0));
+  for (uint64_t start_ts = 0; start_ts < 5; start_ts++) {
+    frame.add_attack_path(RenderEvents::attack_path(
+        7, 0, 0, 0, 1, 1, NameRegistry::INVALID_ID, 0.1f, start_ts, 5));
+    frame.add_attack_path(RenderEvents::attack_path(
+        8, 0, 0, 0, 1, 1, NameRegistry::INVALID_ID, 0.1f, start_ts, 5));
+  }
+  frame.add_attack_remove(RenderEvents::remove_attack(8));
+  frame.compact();
+  ASSERT_EQ(frame.attack_paths.size(), 1);
+  EXPECT_EQ(frame.attack_paths[0].id, 7);
+  EXPECT_EQ(frame.attack_paths[0].start_timestamp, 4);
+  ASSERT_EQ(frame.attack_removes.size(), 1);
+  EXPECT_EQ(frame.attack_removes[0].id, 8);
+
+  // a frontend that's far behind only gets the latest path, whether the updates
+  // piled up in the published frames or in the held back one
+  ViewEvents view_events;
+  const uint64_t num_ticks = 700;
+  for (uint64_t tick_idx = 0; tick_idx < num_ticks; tick_idx++) {
+    view_events.add_mobpath_event(
+        RenderEvents::mob_path(5, 0.5f, 0.5f, 0.05f, tick_idx));
+    view_events.add_mobpath_waypoint(5, tick_idx);
+    view_events.publish_frame(tick_idx);
+  }
+  EXPECT_GT(view_events.get_frame_stats().num_coalesced, 0);
+  std::vector<uint64_t> path_timestamps;
+  auto path_fn = [&path_timestamps](
+                     std::unique_ptr<RenderEvents::mob_path> path,
+                     const RenderEvents::waypoint *path_waypoints) {
+    path_timestamps.push_back(path->start_timestamp);
+    ASSERT_EQ(path->num_waypoints, 1);
+    EXPECT_EQ(path_waypoints[0].row, path->start_timestamp);
+  };
+  // NOTE: the 1st gather gets all of the published frames, which makes room
+  // for the held one
+  const uint64_t num_published = view_events.get_frame_stats().num_pushed;
+  view_events.apply_mobpath_events(path_fn);
+  view_events.publish_frame(num_ticks);
+  view_events.apply_mobpath_events(path_fn);
+  EXPECT_EQ(path_timestamps,
+            std::vector<uint64_t>({num_published - 1, num_ticks - 1}));
+}
+
+TEST(DTDLoggerTest, StructuredRecordsFromAllThreads) {
+  Logging::Logger &logger = Logging::Logger::get();
+  std::ostringstream log_stream;
+  logger.flush();
+  logger.set_sink(&log_stream);
+  const Logging::Level prev_level = logger.get_level();
+
+  // below the runtime level, nothing gets recorded
+  logger.set_level(Logging::Level::Info);
+  TD_LOG(Debug, "hidden_event", Logging::kv("value", 1));
+  // ... and below the compile-time level, the fields don't even get evaluated
+  logger.set_level(Logging::Level::Trace);
+  int num_evaluated = 0;
+  TD_LOG(Trace, "stripped_event", Logging::kv("value", ++num_evaluated));
+  EXPECT_EQ(num_evaluated, TD_LOG_MIN_LEVEL == 0 ? 1 : 0);
+
+  logger.set_level(Logging::Level::Debug);
+  TD_LOG(Debug, "debug_event", Logging::kv("value", 2));
+  TD_LOG(Info, "main_event", Logging::kv("mob_id", 3u),
+         Logging::kv("health", 2.5f), Logging::kv("offset", -4),
+         Logging::kv("alive", true), Logging::kv("mob", std::string("ogre 1")));
+  std::thread worker([]() {
+    for (int evt_idx = 0; evt_idx < 100; evt_idx++) {
+      TD_LOG(Info, "worker_event", Logging::kv("idx", evt_idx));
+    }
+  });
+  worker.join();
+  logger.flush();
+
+  logger.set_sink(&std::cout);
+  logger.set_level(prev_level);
+
+  const std::string log_output = log_stream.str();
+  EXPECT_EQ(log_output.find("hidden_event"), std::string::npos);
+  // NOTE: Debug is compiled out in release builds
+#if TD_LOG_MIN_LEVEL <= 1
+  const size_t debug_pos = log_output.find("event=debug_event value=2\n");
+  ASSERT_NE(debug_pos, std::string::npos);
+  const size_t line_start = log_output.rfind('\n', debug_pos) + 1;
+  EXPECT_NE(log_output.substr(line_start, debug_pos - line_start)
+                .find("level=debug"),
+            std::string::npos);
+#else
+  EXPECT_EQ(log_output.find("debug_event"), std::string::npos);
+#endif
+  EXPECT_NE(log_output.find("event=main_event mob_id=3 health=2.5 offset=-4 "
+                            "alive=true mob=\"ogre 1\"\n"),
+            std::string::npos);
+
+  // each thread's records stay in order
+  std::istringstream log_lines(log_output);
+  std::string log_line;
+  int expected_idx = 0;
+  while (std::getline(log_lines, log_line)) {
+    if (log_line.find("event=worker_event") != std::string::npos) {
+      EXPECT_NE(log_line.find("level=info"), std::string::npos);
+      EXPECT_NE(log_line.find("idx=" + std::to_string(expected_idx)),
+                std::string::npos);
+      expected_idx++;
+    }
+  }
+  EXPECT_EQ(expected_idx, 100);
+  EXPECT_EQ(logger.get_num_dropped(), 0);
+}
+
+TEST(DTDSnapshotTest, SnapshotMatchesGameState) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  auto td_backend = td->get_td_backend();
+  for (int tower_idx = 0; tower_idx < 2; tower_idx++) {
+    td_backend->make_tower(tower_idx, 3, 0.5f + 0.13f * tower_idx, 0.3f);
+  }
+
+  // there's a snapshot before anything has been run, too
+  auto snapshot = td->get_snapshot();
+  EXPECT_EQ(Snapshot::SnapshotView(snapshot.data(), snapshot.size())
+                .num_towers(),
+            2);
+
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+  td->run_ticks(40);
+  snapshot = td->get_snapshot();
+  Snapshot::SnapshotView snapshot_view(snapshot.data(), snapshot.size());
+
+  const Snapshot::Header &header = snapshot_view.header();
+  EXPECT_EQ(header.total_size, snapshot.size());
+  EXPECT_EQ(snapshot_view.get_timestamp(), td->get_timestamp());
+  EXPECT_EQ(header.game_state, static_cast<uint32_t>(GAME_STATE::ACTIVE));
+  const auto player_state = td_backend->get_player_state();
+  EXPECT_EQ(header.num_lives, player_state.num_lives);
+  EXPECT_EQ(header.num_gold, player_state.num_gold);
+
+  ASSERT_EQ(snapshot_view.num_towers(), 2);
+  for (size_t tower_idx = 0; tower_idx < 2; tower_idx++) {
+    const Snapshot::Tower &snapshot_tower = snapshot_view.towers()[tower_idx];
+    Tower *tower =
+        td_backend->get_tower(0.5f + 0.13f * snapshot_tower.id, 0.3f);
+    ASSERT_NE(tower, nullptr);
+    EXPECT_EQ(snapshot_tower.id, tower->get_id());
+    EXPECT_EQ(snapshot_tower.name_id,
+              td_backend->get_entity_names().find(tower->get_name()));
+    EXPECT_FLOAT_EQ(snapshot_tower.col, tower->get_position().col);
+    EXPECT_FLOAT_EQ(snapshot_tower.attack_range, tower->get_attack_range());
+    EXPECT_EQ(snapshot_tower.num_attacks, tower->get_num_attacks());
+  }
+
+  const MobTable &live_mobs = td_backend->get_live_mobs();
+  ASSERT_EQ(snapshot_view.num_mobs(), live_mobs.size());
+  ASSERT_GT(live_mobs.size(), 0);
+  for (size_t mob_idx = 0; mob_idx < live_mobs.size(); mob_idx++) {
+    const Snapshot::Mob &mob = snapshot_view.mobs()[mob_idx];
+    EXPECT_EQ(mob.name_id, live_mobs.ids[mob_idx]);
+    EXPECT_FLOAT_EQ(mob.col, live_mobs.pos_col[mob_idx]);
+    EXPECT_FLOAT_EQ(mob.row, live_mobs.pos_row[mob_idx]);
+    EXPECT_FLOAT_EQ(mob.health, live_mobs.health[mob_idx]);
+  }
+
+  // every attack came from one of the towers
+  EXPECT_GT(snapshot_view.num_attacks(), 0);
+  for (size_t attack_idx = 0; attack_idx < snapshot_view.num_attacks();
+       attack_idx++) {
+    const Snapshot::Attack &attack = snapshot_view.attacks()[attack_idx];
+    bool has_origin = false;
+    for (size_t tower_idx = 0; tower_idx < 2; tower_idx++) {
+      const Snapshot::Tower &tower = snapshot_view.towers()[tower_idx];
+      has_origin |= tower.slot_row == attack.origin_row &&
+                    tower.slot_col == attack.origin_col;
+    }
+    EXPECT_TRUE(has_origin);
+  }
+
+  // the default inventory
+  ASSERT_EQ(snapshot_view.num_items(), 3);
+  EXPECT_STREQ(snapshot_view.items()[0].letter, "a");
+  EXPECT_STREQ(snapshot_view.items()[2].letter, "e");
+
+  size_t num_obstructed = 0;
+  for (int row_idx = 0; row_idx < GameMap::MAP_HEIGHT; row_idx++) {
+    for (int col_idx = 0; col_idx < GameMap::MAP_WIDTH; col_idx++) {
+      EXPECT_EQ(snapshot_view.is_obstructed(col_idx, row_idx),
+                td_backend->is_obstructed(col_idx, row_idx));
+      num_obstructed += snapshot_view.is_obstructed(col_idx, row_idx);
+    }
+  }
+  EXPECT_EQ(num_obstructed,
+            2 * GameMap::TowerTileWidth * GameMap::TowerTileHeight);
+
+  // the saved snapshot reads back the same, in place
+  const std::string snapshot_path = testing::TempDir() + "dtd_snapshot.bin";
+  Snapshot::save_snapshot(snapshot_path, snapshot);
+  {
+    Snapshot::MappedSnapshot mapped_snapshot(snapshot_path);
+    const Snapshot::SnapshotView &mapped_view = mapped_snapshot.view();
+    EXPECT_EQ(mapped_view.get_timestamp(), snapshot_view.get_timestamp());
+    ASSERT_EQ(mapped_view.num_mobs(), snapshot_view.num_mobs());
+    EXPECT_EQ(std::memcmp(&mapped_view.header(), snapshot.data(),
+                          snapshot.size()),
+              0);
+  }
+  std::remove(snapshot_path.c_str());
+
+  // and anything that isn't a complete snapshot gets rejected
+  EXPECT_THROW(Snapshot::SnapshotView(snapshot.data(), snapshot.size() - 8),
+               std::runtime_error);
+  snapshot[0] = 0;
+  EXPECT_THROW(Snapshot::SnapshotView(snapshot.data(), snapshot.size()),
+               std::runtime_error);
+}
+
+TEST(DTDSnapshotTest, AttackColumnsMatchAttacks) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  auto td_backend = td->get_td_backend();
+  for (int tower_idx = 0; tower_idx < 2; tower_idx++) {
+    td_backend->make_tower(tower_idx, 3, 0.5f + 0.13f * tower_idx, 0.3f);
+  }
+  EXPECT_EQ(td_backend->export_attack_columns().size(), 0);
+
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+  td->run_ticks(40);
+
+  // the columns have the same attacks (in the same order) as the snapshot
+  const AttackColumns &attacks = td_backend->export_attack_columns();
+  auto snapshot = td->get_snapshot();
+  Snapshot::SnapshotView snapshot_view(snapshot.data(), snapshot.size());
+  ASSERT_GT(attacks.size(), 0);
+  ASSERT_EQ(attacks.size(), snapshot_view.num_attacks());
+  for (size_t attack_idx = 0; attack_idx < attacks.size(); attack_idx++) {
+    const Snapshot::Attack &attack = snapshot_view.attacks()[attack_idx];
+    EXPECT_EQ(attacks.ids[attack_idx], attack.id);
+    EXPECT_FLOAT_EQ(attacks.pos_col[attack_idx], attack.col);
+    EXPECT_FLOAT_EQ(attacks.pos_row[attack_idx], attack.row);
+    EXPECT_FLOAT_EQ(attacks.target_col[attack_idx], attack.target_col);
+    EXPECT_EQ(attacks.target_ids[attack_idx], attack.target_name_id);
+    EXPECT_EQ(attacks.is_homing[attack_idx], attack.is_homing);
+  }
+  for (const auto *column : {&attacks.pos_col, &attacks.pos_row,
+                             &attacks.target_col, &attacks.target_row,
+                             &attacks.move_speed}) {
+    EXPECT_EQ(column->size(), attacks.size());
+  }
+
+  // re-exporting reuses the columns
+  const float *pos_data = attacks.pos_col.data();
+  EXPECT_EQ(&td_backend->export_attack_columns(), &attacks);
+  EXPECT_EQ(attacks.pos_col.data(), pos_data);
+}
+
+TEST(DTDGameLoopTest, StatePolledWhileLoopRuns) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  td->get_td_backend()->make_tower(0, 3, 0.5f, 0.3f);
+  EXPECT_THROW(td->stop_game(), std::logic_error);
+
+  td->start_game();
+  EXPECT_TRUE(td->is_running());
+  // everything here is read from this thread while the gameloop thread ticks
+  uint64_t last_timestamp = 0;
+  uint64_t snapshot_timestamp = 0;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(20);
+  while (std::chrono::steady_clock::now() < deadline) {
+    const uint64_t timestamp = td->get_timestamp();
+    EXPECT_GE(timestamp, last_timestamp);
+    last_timestamp = timestamp;
+
+    auto snapshot = td->get_snapshot();
+    if (snapshot.empty()) {
+      continue;
+    }
+    Snapshot::SnapshotView snapshot_view(snapshot.data(), snapshot.size());
+    EXPECT_GE(snapshot_view.get_timestamp(), snapshot_timestamp);
+    EXPECT_LE(snapshot_view.get_timestamp(), td->get_timestamp());
+    snapshot_timestamp = snapshot_view.get_timestamp();
+    EXPECT_EQ(snapshot_view.num_towers(), 1);
+    EXPECT_EQ(td->get_player_state().num_lives,
+              snapshot_view.header().num_lives);
+    if (td->get_game_state() == GAME_STATE::ACTIVE &&
+        snapshot_timestamp > 20) {
+      break;
+    }
+  }
+  td->stop_game();
+  EXPECT_FALSE(td->is_running());
+  EXPECT_GT(snapshot_timestamp, 20);
+}
+
+TEST(DTDGameLoopTest, StateGuardedWhileStepping) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  // s.t. get_snapshot has to take the snapshot itself
+  td->set_snapshots_enabled(false);
+  { auto state_lock = td->lock_game_state(); }
+
+  // step the game on another thread, well past the start of the first wave
+  constexpr uint64_t num_ticks = 10000;
+  std::thread stepping_thread([td]() { td->run_ticks(num_ticks); });
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    std::this_thread::yield();
+  }
+  EXPECT_THROW(td->lock_game_state(), std::logic_error);
+  // ... whereas the snapshot waits for the stepping to finish
+  const std::vector<uint8_t> snapshot = td->get_snapshot();
+  stepping_thread.join();
+
+  Snapshot::SnapshotView snapshot_view(snapshot.data(), snapshot.size());
+  EXPECT_EQ(snapshot_view.get_timestamp(), td->get_timestamp());
+  EXPECT_EQ(snapshot, td->get_snapshot());
+  { auto state_lock = td->lock_game_state(); }
+
+  td->start_game();
+  EXPECT_THROW(td->lock_game_state(), std::logic_error);
+  td->stop_game();
+}
+
+TEST(DTDVecEnvTest, StepsIndependentGames) {
+  using VecTDType = VecTowerDefense<TowerLogic>;
+  constexpr size_t num_envs = 4;
+  constexpr size_t obs_size = VecTDType::OBSERVATION_SIZE;
+  VecTDType vec_td(num_envs, 42, 2);
+
+  std::vector<float> observations(num_envs * obs_size);
+  std::vector<float> rewards(num_envs);
+  std::vector<uint8_t> dones(num_envs);
+  vec_td.reset(observations.data());
+  for (size_t env_idx = 0; env_idx < num_envs; env_idx++) {
+    EXPECT_EQ(observations[env_idx * obs_size], 20);
+  }
+
+  // only the first 2 games get towers -- 2 per game, plus 1 that's off the map
+  // and 1 on an already occupied block (neither of which do anything)
+  constexpr size_t actions_per_env = 4;
+  std::vector<float> actions(num_envs * actions_per_env *
+                                 VecTDType::ACTION_SIZE,
+                             0.0f);
+  const float build = static_cast<float>(VecEnv::ActionKind::Build);
+  for (size_t env_idx = 0; env_idx < 2; env_idx++) {
+    float *env_actions =
+        actions.data() + env_idx * actions_per_env * VecTDType::ACTION_SIZE;
+    const std::vector<float> env_builds{build, 0.5f,  0.3f, 10,
+                                        build, 0.63f, 0.3f, 10,
+                                        build, 1.5f,  0.3f, 10,
+                                        build, 0.5f,  0.3f, 10};
+    std::copy(env_builds.begin(), env_builds.end(), env_actions);
+  }
+  vec_td.step(actions.data(), actions_per_env, 1, observations.data(),
+              rewards.data(), dones.data());
+  for (size_t env_idx = 0; env_idx < num_envs; env_idx++) {
+    const float *tower_tiers =
+        observations.data() + env_idx * obs_size + VecTDType::NUM_SCALARS;
+    const float num_towers = std::count_if(
+        tower_tiers, tower_tiers + VecTDType::NUM_SLOTS,
+        [](const float tier) { return tier > 0; });
+    EXPECT_EQ(num_towers, env_idx < 2 ? 2 : 0);
+    // slot [row 2, col 4]
+    EXPECT_EQ(tower_tiers[2 * TowerLogic::TLIST_WIDTH + 4], env_idx < 2 ? 10 : 0);
+  }
+
+  // run until all of the games are lost (the mobs have too much health for the
+  // towers to kill them in time) -- the rewards add up to the leaks
+  std::fill(actions.begin(), actions.end(), 0.0f);
+  std::vector<float> total_rewards(num_envs, 0.0f);
+  std::vector<int> num_done(num_envs, 0);
+  auto all_done = [&num_done]() {
+    return std::all_of(num_done.begin(), num_done.end(),
+                       [](const int done) { return done > 0; });
+  };
+  for (int step_idx = 0; step_idx < 500 && !all_done(); step_idx++) {
+    vec_td.step(actions.data(), actions_per_env, 10, observations.data(),
+                rewards.data(), dones.data());
+    for (size_t env_idx = 0; env_idx < num_envs; env_idx++) {
+      total_rewards[env_idx] += rewards[env_idx];
+      num_done[env_idx] += dones[env_idx];
+      const float *env_obs = observations.data() + env_idx * obs_size;
+      // the mob counts per slot add up to the #mobs
+      const float *mob_counts = env_obs + VecTDType::NUM_SCALARS +
+                                VecTDType::NUM_SLOTS;
+      EXPECT_EQ(std::accumulate(mob_counts, mob_counts + VecTDType::NUM_SLOTS,
+                                0.0f),
+                env_obs[4]);
+      if (dones[env_idx]) {
+        // the game got reset, towers and all
+        EXPECT_EQ(env_obs[0], 20);
+        EXPECT_EQ(std::accumulate(env_obs + VecTDType::NUM_SCALARS,
+                                  env_obs + VecTDType::NUM_SCALARS +
+                                      VecTDType::NUM_SLOTS,
+                                  0.0f),
+                  0);
+      }
+    }
+  }
+  ASSERT_TRUE(all_done());
+  for (size_t env_idx = 0; env_idx < num_envs; env_idx++) {
+    EXPECT_EQ(num_done[env_idx], 1);
+    // 20 lives, so 20 mobs made it through
+    EXPECT_FLOAT_EQ(total_rewards[env_idx], -20.0f);
+    EXPECT_EQ(vec_td.get_env(env_idx)->get_td_backend()->get_num_mobs_leaked(),
+              0);
+  }
+}
+
+TEST(DTDVecEnvTest, SeededRunsAreReproducible) {
+  using VecTDType = VecTowerDefense<TowerLogic>;
+  constexpr size_t num_envs = 4;
+  constexpr size_t actions_per_env = 2;
+
+  // the observations and rewards over a few waves, along with the mob health
+  // (which is where the random rolls show up)
+  struct VecRun {
+    std::vector<float> observations;
+    std::vector<float> rewards;
+    std::vector<float> mob_health;
+  };
+  auto run_games = [](const int32_t seed, const size_t num_threads) {
+    VecTDType vec_td(num_envs, seed, num_threads);
+    std::vector<float> observations(num_envs * VecTDType::OBSERVATION_SIZE);
+    std::vector<float> rewards(num_envs);
+    std::vector<uint8_t> dones(num_envs);
+    vec_td.reset(observations.data());
+
+    // a couple of towers by the exit, s.t. the mobs get shot at
+    std::vector<float> actions(
+        num_envs * actions_per_env * VecTDType::ACTION_SIZE, 0.0f);
+    for (size_t env_idx = 0; env_idx < num_envs; env_idx++) {
+      float *env_actions =
+          actions.data() + env_idx * actions_per_env * VecTDType::ACTION_SIZE;
+      const float build = static_cast<float>(VecEnv::ActionKind::Build);
+      const std::vector<float> env_builds{build, 0.19f, 0.06f, 10,
+                                          build, 0.19f, 0.19f, 10};
+      std::copy(env_builds.begin(), env_builds.end(), env_actions);
+    }
+
+    VecRun run;
+    for (int step_idx = 0; step_idx < 100; step_idx++) {
+      vec_td.step(actions.data(), actions_per_env, 10, observations.data(),
+                  rewards.data(), dones.data());
+      std::fill(actions.begin(), actions.end(), 0.0f);
+      run.observations.insert(run.observations.end(), observations.begin(),
+                              observations.end());
+      run.rewards.insert(run.rewards.end(), rewards.begin(), rewards.end());
+      for (size_t env_idx = 0; env_idx < num_envs; env_idx++) {
+        const auto &health =
+            vec_td.get_env(env_idx)->get_td_backend()->get_live_mobs().health;
+        run.mob_health.insert(run.mob_health.end(), health.begin(),
+                              health.end());
+      }
+    }
+    return run;
+  };
+
+  const VecRun first_run = run_games(7, 2);
+  // the same seed gives the same games, whichever worker steps which game
+  for (const size_t num_threads : {size_t(2), size_t(1), num_envs}) {
+    const VecRun seeded_run = run_games(7, num_threads);
+    EXPECT_EQ(seeded_run.observations, first_run.observations);
+    EXPECT_EQ(seeded_run.rewards, first_run.rewards);
+    EXPECT_EQ(seeded_run.mob_health, first_run.mob_health);
+  }
+
+  // ... and the seed does make a difference
+  ASSERT_FALSE(first_run.mob_health.empty());
+  EXPECT_NE(run_games(8, 2).mob_health, first_run.mob_health);
+}
+
+TEST(DTDVecEnvTest, ResetGameMatchesNewGame) {
+  using GameType = VecTowerDefense<TowerLogic>::GameType;
+  auto make_game = [](const int32_t seed) {
+    std::unique_ptr<GameType> game(
+        new GameType(seed, std::unique_ptr<GameClock>(new VirtualClock())));
+    game->set_snapshots_enabled(false);
+    game->init_game();
+    return game;
+  };
+  // builds a couple of towers by the exit, then runs the game into the first
+  // wave -- returns the #lives and the mob health after each tick
+  auto play_game = [](GameType *game) {
+    TowerLogic *backend = game->get_td_backend();
+    EXPECT_TRUE(backend->make_tower(0, 10, 0.19f, 0.06f));
+    EXPECT_TRUE(backend->make_tower(1, 10, 0.19f, 0.19f));
+    std::vector<float> game_trace;
+    for (int tick = 0; tick < 600; tick++) {
+      game->run_ticks(1);
+      game_trace.push_back(backend->get_player_info().num_lives);
+      const auto &health = backend->get_live_mobs().health;
+      game_trace.insert(game_trace.end(), health.begin(), health.end());
+    }
+    return game_trace;
+  };
+
+  auto new_game = make_game(7);
+  const std::vector<float> new_trace = play_game(new_game.get());
+
+  // reset a game that's part-way through a wave, and play it out again
+  auto reset_game = make_game(3);
+  play_game(reset_game.get());
+  ASSERT_GT(reset_game->get_td_backend()->get_num_live_mobs(), 0);
+  reset_game->reset_game(7);
+
+  TowerLogic *backend = reset_game->get_td_backend();
+  EXPECT_EQ(reset_game->get_game_state(), GAME_STATE::PAUSED);
+  EXPECT_EQ(reset_game->get_timestamp(), 0);
+  EXPECT_EQ(backend->get_num_live_mobs(), 0);
+  EXPECT_EQ(backend->get_player_info().num_lives, 20);
+  std::vector<float> tower_tiers(TowerLogic::TLIST_HEIGHT *
+                                 TowerLogic::TLIST_WIDTH);
+  backend->get_tower_tiers(tower_tiers.data());
+  EXPECT_TRUE(std::all_of(tower_tiers.begin(), tower_tiers.end(),
+                          [](const float tier) { return tier == 0; }));
+  // i.e. a map tile within the first tower's block
+  EXPECT_FALSE(backend->is_obstructed(24, 7));
+
+  EXPECT_EQ(play_game(reset_game.get()), new_trace);
+}
+
+TEST(DTDVecEnvTest, ModifyActionsIndexTheModifiers) {
+  using VecTDType = VecTowerDefense<TowerLogic>;
+  constexpr size_t num_envs = 2;
+  constexpr size_t actions_per_env = 3;
+  VecTDType vec_td(num_envs, 42, 1);
+
+  std::vector<float> observations(num_envs * VecTDType::OBSERVATION_SIZE);
+  std::vector<float> rewards(num_envs);
+  std::vector<uint8_t> dones(num_envs);
+  vec_td.reset(observations.data());
+
+  std::vector<tower_properties> modifiers(2);
+  modifiers[0].modifier.attack_range_value = 5;
+  modifiers[1].modifier.attack_range_value = 20;
+
+  // both games get a tower -- the first game modifies it with the 2nd
+  // modifier, the second game tries a modifier that doesn't exist and then
+  // modifies an empty block (neither of which do anything)
+  const float build = static_cast<float>(VecEnv::ActionKind::Build);
+  const float modify = static_cast<float>(VecEnv::ActionKind::Modify);
+  const std::vector<float> actions{build,  0.5f, 0.3f, 10,
+                                   modify, 0.5f, 0.3f, 1,
+                                   modify, 0.5f, 0.3f, -1,
+                                   build,  0.5f, 0.3f, 10,
+                                   modify, 0.5f, 0.3f, 2,
+                                   modify, 0.7f, 0.7f, 0};
+  vec_td.step(actions.data(), actions_per_env, 1, observations.data(),
+              rewards.data(), dones.data(), modifiers);
+
+  const Tower *modified_tower =
+      vec_td.get_env(0)->get_td_backend()->get_tower(0.5f, 0.3f);
+  const Tower *unmodified_tower =
+      vec_td.get_env(1)->get_td_backend()->get_tower(0.5f, 0.3f);
+  ASSERT_NE(modified_tower, nullptr);
+  ASSERT_NE(unmodified_tower, nullptr);
+  EXPECT_EQ(modified_tower->get_base_attributes().modifier.attack_range_value,
+            unmodified_tower->get_base_attributes().modifier.attack_range_value +
+                20);
+}
+
+TEST(DTDPathfinderTest, BuildsOverLiveMobsAreRejected) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  TestStubs::add_tower_displayinfo(td);
+  TowerLogic *backend = td->get_td_backend();
+
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+  td->run_ticks(200);
+  const MobTable &live_mobs = backend->get_live_mobs();
+  ASSERT_GT(live_mobs.size(), 0);
+
+  // building over a mob would leave it with nowhere to go
+  const float mob_col = live_mobs.pos_col[0];
+  const float mob_row = live_mobs.pos_row[0];
+  EXPECT_FALSE(backend->make_tower(0, 1, mob_col, mob_row));
+  EXPECT_EQ(backend->get_tower(mob_col, mob_row), nullptr);
+  EXPECT_FALSE(backend->is_obstructed(
+      static_cast<int>(mob_col * GameMap::MAP_WIDTH),
+      static_cast<int>(mob_row * GameMap::MAP_HEIGHT)));
+
+  // so the wave still plays out (NOTE: the cap is s.t. a stuck mob fails the
+  // test rather than hanging it)
+  td->run_until_wave_end(5000);
+  EXPECT_EQ(backend->get_num_live_mobs(), 0);
+}
+
+TEST(DTDCommandBatchTest, BatchMatchesSingleEvents) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  using UserTowerEvents::tower_command;
+  auto batch_td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  auto single_td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  batch_td->init_game();
+  single_td->init_game();
+  TestStubs::add_tower_displayinfo(batch_td);
+  TestStubs::add_tower_displayinfo(single_td);
+
+  const float tower_rows[] = {0.3f, 0.43f, 0.56f};
+  std::vector<tower_command> commands;
+  for (int tower_idx = 0; tower_idx < 3; tower_idx++) {
+    commands.push_back(
+        tower_command::build(tower_idx, 2, 0.5f, tower_rows[tower_idx]));
+    single_td->get_td_backend()->make_tower(tower_idx, 2, 0.5f,
+                                           tower_rows[tower_idx]);
+  }
+  // there's no mob out yet to target, nor a tower to target with, nor a
+  // modifier to apply
+  commands.push_back(tower_command::target(0.5f, 0.3f, 0.1f, 0.1f));
+  commands.push_back(tower_command::target(0.9f, 0.9f, 0.1f, 0.1f));
+  commands.push_back(tower_command::modify(3, 0.5f, 0.3f));
+
+  auto batch_backend = batch_td->get_td_backend();
+  EXPECT_EQ(batch_backend->apply_commands(commands,
+                                          std::vector<tower_properties>()),
+            3);
+
+  // the same batch as an event -- the builds are now on occupied blocks
+  UserTowerEvents::command_batch_event<tower_properties, TowerLogic> batch_event(
+      commands, std::vector<tower_properties>());
+  batch_event.apply(batch_backend);
+
+  // the deferred path updates should end up the same as the per-tower ones
+  auto single_backend = single_td->get_td_backend();
+  for (int tower_idx = 0; tower_idx < 3; tower_idx++) {
+    Tower *tower = batch_backend->get_tower(0.5f, tower_rows[tower_idx]);
+    ASSERT_NE(tower, nullptr);
+    EXPECT_EQ(tower->get_id(), tower_idx);
+  }
+  for (int slot_row = 0; slot_row < TowerLogic::TLIST_HEIGHT; slot_row++) {
+    for (int slot_col = 0; slot_col < TowerLogic::TLIST_WIDTH; slot_col++) {
+      const float col = (slot_col + 0.5f) / TowerLogic::TLIST_WIDTH;
+      const float row = (slot_row + 0.5f) / TowerLogic::TLIST_HEIGHT;
+      EXPECT_EQ(batch_backend->blocks_path(col, row),
+                single_backend->blocks_path(col, row));
+    }
+  }
+
+  while (batch_td->get_game_state() != GAME_STATE::ACTIVE) {
+    batch_td->run_ticks(1);
+    single_td->run_ticks(1);
+  }
+  batch_td->run_ticks(40);
+  single_td->run_ticks(40);
+  const MobTable &batch_mobs = batch_backend->get_live_mobs();
+  const MobTable &single_mobs = single_backend->get_live_mobs();
+  ASSERT_EQ(batch_mobs.size(), single_mobs.size());
+  for (size_t mob_idx = 0; mob_idx < batch_mobs.size(); mob_idx++) {
+    EXPECT_FLOAT_EQ(batch_mobs.pos_col[mob_idx], single_mobs.pos_col[mob_idx]);
+    EXPECT_FLOAT_EQ(batch_mobs.pos_row[mob_idx], single_mobs.pos_row[mob_idx]);
+  }
+}
+
+TEST(DTDFrameNotifierTest, FdSignalsPublishedFrames) {
+  using TDType = TowerDefense<TestStubs::FrontStub, TowerLogic>;
+  auto td = std::make_shared<TDType>(
+      42, std::unique_ptr<GameClock>(new VirtualClock()));
+  td->init_game();
+  ViewEvents *game_events = td->get_td_backend()->get_frontend_eventqueue();
+  auto is_readable = [](const int fd) {
+    pollfd poll_fd{fd, POLLIN, 0};
+    return poll(&poll_fd, 1, 0) == 1 && (poll_fd.revents & POLLIN);
+  };
+
+  // the init's frames were published before there was a fd
+  const int frame_fd = game_events->get_frame_fd();
+  ASSERT_GE(frame_fd, 0);
+  EXPECT_EQ(game_events->get_frame_fd(), frame_fd);
+  RenderFrame frames;
+  if (is_readable(frame_fd)) {
+    EXPECT_TRUE(game_events->take_frames(frames));
+  }
+  EXPECT_FALSE(is_readable(frame_fd));
+  EXPECT_FALSE(game_events->take_frames(frames));
+
+  size_t num_mobs_built = 0;
+  uint64_t last_tick = 0;
+  while (td->get_game_state() != GAME_STATE::ACTIVE) {
+    td->run_ticks(1);
+  }
+  for (int tick = 0; tick < 200; tick++) {
+    td->run_ticks(1);
+    if (!is_readable(frame_fd)) {
+      continue;
+    }
+    // several ticks' frames come out together
+    if (tick % 3 != 0) {
+      continue;
+    }
+    ASSERT_TRUE(game_events->take_frames(frames));
+    EXPECT_FALSE(is_readable(frame_fd));
+    EXPECT_GT(frames.tick, last_tick);
+    last_tick = frames.tick;
+    num_mobs_built += frames.mob_builds.size();
+  }
+  if (game_events->take_frames(frames)) {
+    num_mobs_built += frames.mob_builds.size();
+  }
+  EXPECT_FALSE(is_readable(frame_fd));
+  EXPECT_EQ(num_mobs_built, 10);
+}
+
 } // namespace
@@ -1,6 +1,7 @@
+import asyncio
 import logging
 
-from fastapi import FastAPI
+from fastapi import FastAPI, HTTPException, Response, WebSocket, WebSocketDisconnect
 
 import deitytd
 
@@ -19,18 +20,115 @@ def startup():
 def shutdown():
     logging.warning(f"shutting down... {deitytd.__version__}")
 
+app.state.gamestate = None
+app.state.broadcaster = None
+
+# how many ticks' worth of events a websocket client can fall behind by before it gets dropped
+MAX_PENDING_FRAMES = 64
+
+def frames_to_json(frames):
+    # the per-tick events come over as structured numpy arrays, one per event type
+    return {name: ({field: events[field].tolist() for field in events.dtype.names}
+                   if hasattr(events, "dtype") else events)
+            for name, events in frames.items()}
+
+class FrameBroadcaster:
+    """
+    Pushes the game's render events out to the websocket clients. The backend's frame fd
+    wakes the event loop when a tick's events are published, and they all get taken in
+    1 call -- so there's no polling thread. NOTE: only ever touched from the event loop
+    """
+    def __init__(self, gamestate):
+        self.loop = asyncio.get_running_loop()
+        self.gamestate = gamestate
+        self.frontend = gamestate.get_td_frontend()
+        self.frame_fd = self.frontend.get_frame_fd()
+        self.subscribers = set()
+        self.loop.add_reader(self.frame_fd, self.on_frames)
+
+    def on_frames(self):
+        frames = self.frontend.take_frames()
+        if frames is None:
+            return
+        message = frames_to_json(frames)
+        for queue in list(self.subscribers):
+            try:
+                queue.put_nowait(message)
+            except asyncio.QueueFull:
+                # the client's too far behind to be brought up to date
+                self.drop(queue)
+
+    def subscribe(self):
+        queue = asyncio.Queue(maxsize=MAX_PENDING_FRAMES)
+        self.subscribers.add(queue)
+        return queue
+
+    def drop(self, queue):
+        self.subscribers.discard(queue)
+        # the client's pending events are moot, it only needs to be told it's done
+        while not queue.empty():
+            queue.get_nowait()
+        queue.put_nowait(None)
+
+    def close(self):
+        self.loop.remove_reader(self.frame_fd)
+        for queue in list(self.subscribers):
+            self.drop(queue)
+
+def get_running_game():
+    gamestate = app.state.gamestate
+    if gamestate is None:
+        raise HTTPException(status_code=409, detail="no game has been started")
+    return gamestate
+
+# NOTE: these are plain (non-async) endpoints, so they're run on the threadpool --
+# and the bindings release the GIL for anything slow (initializing, stopping the
+# game), so the other requests keep being served in the meantime
 @app.post("/start")
 def start_game(seed: int = 1337):
-    app.state.gamestate = deitytd.dtdcore.TowerDefense(seed)
-    app.state.gamestate.init_game()
-    app.state.gamestate.start_game()
+    # the game is only made visible to the other endpoints once it's running
+    gamestate = deitytd.dtdcore.TowerDefense(seed)
+    gamestate.init_game()
+    gamestate.start_game()
+    app.state.gamestate = gamestate
 
 @app.post("/stop")
-def stop_game():
-    app.state.gamestate.stop_game()
+async def stop_game():
+    gamestate = get_running_game()
+    # the broadcaster lives on the event loop, so it's shut down from here
+    if app.state.broadcaster is not None:
+        app.state.broadcaster.close()
+        app.state.broadcaster = None
+    await asyncio.to_thread(gamestate.stop_game)
 
 @app.get("/state")
 def get_state():
-    gamestate_snapshot = app.state.gamestate
-    #TODO: package into appropriate data format to return with... or just pickle it or something
+    # the binary snapshot from the end of the latest tick (see
+    # lib/core/Model/GameSnapshot.hpp for the layout)
+    gamestate_snapshot = get_running_game().get_snapshot()
+    return Response(content=gamestate_snapshot, media_type="application/octet-stream")
+
+
+@app.websocket("/events")
+async def stream_events(websocket: WebSocket):
+    # each message is (at least) 1 tick's render events, the same as take_frames returns
+    gamestate = app.state.gamestate
+    if gamestate is None:
+        await websocket.close(code=1013)
+        return
+    broadcaster = app.state.broadcaster
+    if broadcaster is None or broadcaster.gamestate is not gamestate:
+        if broadcaster is not None:
+            broadcaster.close()
+        broadcaster = app.state.broadcaster = FrameBroadcaster(gamestate)
 
+    await websocket.accept()
+    frame_queue = broadcaster.subscribe()
+    try:
+        while (message := await frame_queue.get()) is not None:
+            await websocket.send_json(message)
+        await websocket.close()
+    except WebSocketDisconnect:
+        pass
+    finally:
+        broadcaster.subscribers.discard(frame_queue)